@@ -0,0 +1,61 @@
+/*
+Subsumption arbiter (see arbiter.h).
+*/
+
+#include "arbiter.h"
+#include <string.h> // memset
+
+void arbiter_init(arbiter *arb)
+{
+	memset(arb, 0, sizeof(*arb));
+}
+
+void arbiter_define(arbiter *arb, int type, arbiter_trigger trigger, arbiter_action action)
+{
+	if (type < 0 || type >= ARBITER_MAX_BEHAVIORS) {
+		return;
+	}
+	arb->type_trigger[type] = trigger;
+	arb->type_action[type] = action;
+}
+
+void arbiter_compile(arbiter *arb, const int *types, const bool *active, int count)
+{
+	if (count > ARBITER_MAX_BEHAVIORS) {
+		count = ARBITER_MAX_BEHAVIORS;
+	}
+	arb->count = count;
+	arb->active = 0;
+	for (int slot = 0; slot < count; slot++) {
+		int type = types[slot];
+		bool known = type >= 0 && type < ARBITER_MAX_BEHAVIORS && arb->type_action[type];
+		arb->type[slot] = type;
+		arb->trigger[slot] = known ? arb->type_trigger[type] : NULL;
+		arb->action[slot] = known ? arb->type_action[type] : NULL;
+		if (known && active[slot]) {
+			arb->active |= 1u << slot; // a type with nothing to do never wins
+		}
+	}
+}
+
+int arbiter_select(const arbiter *arb)
+{
+	// Lowest set bit first is highest rank first, so the predicates run in rank order and stop at the winner
+	for (unsigned int pending = arb->active; pending; pending &= pending - 1) {
+		int slot = __builtin_ctz(pending);
+		if (!arb->trigger[slot] || arb->trigger[slot]()) {
+			return slot;
+		}
+	}
+	return ARBITER_NONE;
+}
+
+int arbiter_run(const arbiter *arb)
+{
+	int slot = arbiter_select(arb);
+	if (slot == ARBITER_NONE) {
+		return ARBITER_NONE;
+	}
+	arb->action[slot]();
+	return arb->type[slot];
+}
@@ -0,0 +1,46 @@
+/*
+Subsumption arbiter for the ethology robots.
+
+The behavior list (subsumption_hierarchy[]) is compiled once into a table in rank order: slot 0 is the top of the
+hierarchy, and bit i of a mask stands for slot i. Every tick the arbiter walks the active slots with find-first-set,
+calling each trigger predicate in rank order until one is satisfied, so a bump at the top costs one predicate call and
+nothing below it is ever evaluated. Only an edit of the hierarchy (the GUI reordering or toggling behaviors) needs a
+new compile.
+*/
+
+#ifndef ARBITER_H
+#define ARBITER_H
+
+#include <stdbool.h> // Boolean support
+
+#define ARBITER_MAX_BEHAVIORS 32 // one bit per behavior
+#define ARBITER_NONE -1          // no active behavior was triggered
+
+typedef bool (*arbiter_trigger)(); // true if the behavior wants control this tick
+typedef void (*arbiter_action)();  // one tick of the behavior (usually a drive command)
+
+typedef struct arbiter {
+	int count;                                   // compiled slots
+	unsigned int active;                         // bit i set if slot i is active
+	int type[ARBITER_MAX_BEHAVIORS];             // behavior type of each slot, in rank order
+	arbiter_trigger trigger[ARBITER_MAX_BEHAVIORS];
+	arbiter_action action[ARBITER_MAX_BEHAVIORS];
+	arbiter_trigger type_trigger[ARBITER_MAX_BEHAVIORS]; // by behavior type, set once with arbiter_define
+	arbiter_action type_action[ARBITER_MAX_BEHAVIORS];
+} arbiter;
+
+void arbiter_init(arbiter *arb);
+
+// Define: what behavior type "type" (0 .. ARBITER_MAX_BEHAVIORS-1) checks and does; a NULL trigger always fires
+void arbiter_define(arbiter *arb, int type, arbiter_trigger trigger, arbiter_action action);
+
+// Compile: build the slots from behavior types in rank order (top first) and whether each is active
+void arbiter_compile(arbiter *arb, const int *types, const bool *active, int count);
+
+// Select: slot of the highest-ranked active behavior whose trigger holds, ARBITER_NONE if none does
+int arbiter_select(const arbiter *arb);
+
+// Run: select and run the winning behavior; its type, or ARBITER_NONE
+int arbiter_run(const arbiter *arb);
+
+#endif
@@ -0,0 +1,159 @@
+/*
+Benchmark for blob extraction: run-length union-find labeller (blob-label.c) against the naive flood fill.
+
+Frames are segmented once with the default red/blue colors, then both labellers run over the same masks. Every frame
+is checked to give the same blobs from both. With no arguments synthetic frames are used at 160x120 and 320x240;
+recorded frames can be given as binary PPM (P6) files, all of the same size.
+
+Build and run on any Linux box:
+    gcc -O2 -o bench-blobs bench-blobs.c color-segment.c blob-label.c synthetic-frame.c frame-file.c
+    ./bench-blobs [frame.ppm ...]
+*/
+
+#include "color-segment.h"
+#include "synthetic-frame.h"
+#include "frame-file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define SYNTHETIC_FRAMES 200
+#define REPEATS 5 // passes over the frame set per measurement
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Same Blobs: true if both results hold the same blobs (ties in area may come out in either order)
+static bool same_blobs(const seg_channel *a, const seg_channel *b)
+{
+	if (a->count != b->count) {
+		return false;
+	}
+	int kept = a->count < SEG_MAX_BLOBS ? a->count : SEG_MAX_BLOBS;
+	for (int i = 0; i < kept; i++) {
+		if (a->blobs[i].area != b->blobs[i].area) {
+			return false;
+		}
+		bool found = false;
+		for (int j = 0; j < kept && !found; j++) {
+			found = memcmp(&a->blobs[i], &b->blobs[j], sizeof(seg_blob)) == 0;
+		}
+		if (!found && a->blobs[i].area > a->blobs[kept - 1].area) {
+			return false; // blobs tied with the smallest kept one may legitimately differ
+		}
+	}
+	return true;
+}
+
+static int bench(int width, int height, unsigned char **frames, int frame_count, const char *source)
+{
+	segmenter seg;
+	if (!seg_init(&seg, width, height)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	seg_default_colors(&seg);
+
+	// segment every frame once; both labellers then work on the stored masks
+	int pixels = width * height;
+	unsigned char *masks = malloc((size_t)pixels * frame_count);
+	if (!masks) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int f = 0; f < frame_count; f++) {
+		seg_load_bgr(&seg, frames[f]);
+		for (int channel = 0; channel < seg.channel_count; channel++) {
+			seg_classify(&seg, channel);
+		}
+		memcpy(masks + (size_t)f * pixels, seg.mask, pixels);
+
+		for (int channel = 0; channel < seg.channel_count; channel++) {
+			seg_channel flood;
+			seg_find_blobs_flood(&seg, channel);
+			flood = seg.channels[channel];
+			seg_find_blobs(&seg, channel);
+			if (!same_blobs(&flood, &seg.channels[channel])) {
+				fprintf(stderr, "labellers disagree on frame %d channel %d\n", f, channel);
+				return 1;
+			}
+		}
+	}
+
+	double flood_time = 0, runs_time = 0;
+	long blobs = 0;
+	for (int rep = 0; rep < REPEATS; rep++) {
+		for (int f = 0; f < frame_count; f++) {
+			memcpy(seg.mask, masks + (size_t)f * pixels, pixels);
+			double t0 = now_seconds();
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seg_find_blobs_flood(&seg, channel);
+			}
+			double t1 = now_seconds();
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seg_find_blobs(&seg, channel);
+				blobs += seg_object_count(&seg, channel);
+			}
+			double t2 = now_seconds();
+			flood_time += t1 - t0;
+			runs_time += t2 - t1;
+		}
+	}
+
+	int passes = frame_count * REPEATS;
+	printf("%dx%d, %d %s frames x %d passes, %.1f blobs/frame\n", width, height, frame_count, source, REPEATS,
+		   (double)blobs / passes);
+	printf("  %-20s %9.1f us/frame\n", "flood fill", flood_time * 1e6 / passes);
+	printf("  %-20s %9.1f us/frame  %5.2fx faster\n", "run-length labeller", runs_time * 1e6 / passes,
+		   flood_time / runs_time);
+
+	free(masks);
+	seg_free(&seg);
+	return 0;
+}
+
+static int bench_synthetic(int width, int height)
+{
+	unsigned char *frames[SYNTHETIC_FRAMES];
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		frames[f] = malloc(3 * width * height);
+		synth_frame(frames[f], width, height, f);
+	}
+	int status = bench(width, height, frames, SYNTHETIC_FRAMES, "synthetic");
+	for (int f = 0; f < SYNTHETIC_FRAMES; f++) {
+		free(frames[f]);
+	}
+	return status;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 1) {
+		return bench_synthetic(160, 120) || bench_synthetic(320, 240);
+	}
+
+	int frame_count = argc - 1;
+	unsigned char **frames = calloc(frame_count, sizeof(unsigned char *));
+	int width = 0, height = 0;
+	for (int f = 0; f < frame_count; f++) {
+		int w, h;
+		frames[f] = frame_load_ppm(argv[f + 1], &w, &h);
+		if (!frames[f] || (f > 0 && (w != width || h != height))) {
+			fprintf(stderr, "%s: not a binary PPM of the same size as the first frame\n", argv[f + 1]);
+			return 2;
+		}
+		width = w;
+		height = h;
+	}
+	int status = bench(width, height, frames, frame_count, "recorded");
+	for (int f = 0; f < frame_count; f++) {
+		free(frames[f]);
+	}
+	free(frames);
+	return status;
+}
@@ -0,0 +1,160 @@
+/*
+Benchmark for lookup-table classification (color-lut.c) against the threshold paths it replaces, on synthetic frames.
+
+Compares per-pixel cost of:
+    hsv       per-pixel RGB to HSV conversion and range tests, what the blockz.conf channels cost
+    scalar    our RGB thresholds, one channel at a time through the planes (seg_load_bgr + seg_classify_scalar)
+    fused     our RGB thresholds, all channels in one vector pass (seg_classify_all)
+    table     one table load per pixel (seg_classify_all with seg_set_lut)
+and reports how many pixels the tables classify differently from the thresholds they were built from (cells on a
+class boundary), how long building a table takes and how long mapping a saved one takes.
+
+Build and run on any Linux box:
+    gcc -O2 -o bench-lut bench-lut.c color-lut.c color-segment.c blob-label.c synthetic-frame.c
+    ./bench-lut [width height frames]
+*/
+
+#include "color-lut.h"
+#include "synthetic-frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_FRAMES 200
+#define REPEATS 5 // passes over the frame set per measurement
+#define TABLE_FILE "/tmp/bench-lut.lut"
+
+// HSV channels like a blockz.conf for our flowers: red wraps around hue 0, blue sits around hue 115
+static const lut_hsv_range hsv_channels[2] = {
+	{{170, 120, 100}, {10, 255, 255}},
+	{{100, 120, 80}, {130, 255, 255}},
+};
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Report: print the cost of one stage per pixel and as throughput
+static void report(const char *stage, double seconds, long pixels)
+{
+	printf("  %-22s %8.2f ns/pixel %10.1f Mpixel/s\n", stage, seconds * 1e9 / pixels, pixels / seconds / 1e6);
+}
+
+// Classify HSV: mask of a frame by per-pixel HSV range tests
+static void classify_hsv(const unsigned char *bgr, unsigned char *mask, int pixels)
+{
+	for (int i = 0; i < pixels; i++) {
+		unsigned char rgb[3] = {bgr[3 * i + 2], bgr[3 * i + 1], bgr[3 * i]};
+		mask[i] = lut_hsv_matches(&hsv_channels[0], rgb) | lut_hsv_matches(&hsv_channels[1], rgb) << 1;
+	}
+}
+
+static int bench(int width, int height, int frames)
+{
+	int pixels = width * height;
+	int frame_bytes = 3 * pixels;
+	segmenter seg;
+	unsigned char *video = malloc((size_t)frame_bytes * frames);
+	unsigned char *expected = malloc(pixels);
+	if (!video || !expected || !seg_init(&seg, width, height)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	seg_default_colors(&seg);
+	for (int f = 0; f < frames; f++) {
+		synth_frame(video + (size_t)f * frame_bytes, width, height, f + 1);
+	}
+
+	static unsigned char color_table[LUT_SIZE], hsv_table[LUT_SIZE];
+	double t0 = now_seconds();
+	lut_from_colors(color_table, seg.colors, seg.channel_count);
+	double t1 = now_seconds();
+	lut_from_hsv(hsv_table, hsv_channels, 2);
+	double t2 = now_seconds();
+	if (!lut_save(TABLE_FILE, color_table, seg.channel_count)) {
+		fprintf(stderr, "cannot write %s\n", TABLE_FILE);
+		return 1;
+	}
+	double t3 = now_seconds();
+	int mapped_channels;
+	const unsigned char *mapped = lut_map(TABLE_FILE, &mapped_channels);
+	double t4 = now_seconds();
+	if (!mapped || memcmp(mapped, color_table, LUT_SIZE) != 0) {
+		fprintf(stderr, "mapped table differs from the saved one\n");
+		return 1;
+	}
+
+	double hsv = 0, scalar = 0, fused = 0, table = 0;
+	long color_differences = 0, hsv_differences = 0;
+	for (int rep = 0; rep < REPEATS; rep++) {
+		for (int f = 0; f < frames; f++) {
+			const unsigned char *bgr = video + (size_t)f * frame_bytes;
+
+			double a = now_seconds();
+			classify_hsv(bgr, expected, pixels);
+			double b = now_seconds();
+			seg_set_lut(&seg, hsv_table, 2);
+			seg_classify_all(&seg, bgr);
+			for (int i = 0; i < pixels; i++) {
+				hsv_differences += seg.mask[i] != expected[i];
+			}
+
+			seg_set_lut(&seg, NULL, 0);
+			double c = now_seconds();
+			seg_load_bgr(&seg, bgr);
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seg_classify_scalar(&seg, channel);
+			}
+			double d = now_seconds();
+			seg_classify_all(&seg, bgr);
+			double e = now_seconds();
+			memcpy(expected, seg.mask, pixels);
+
+			seg_set_lut(&seg, mapped, mapped_channels);
+			double g = now_seconds();
+			seg_classify_all(&seg, bgr);
+			double h = now_seconds();
+			for (int i = 0; i < pixels; i++) {
+				color_differences += seg.mask[i] != expected[i];
+			}
+			seg_set_lut(&seg, NULL, 0);
+
+			hsv += b - a;
+			scalar += d - c;
+			fused += e - d;
+			table += h - g;
+		}
+	}
+
+	long total = (long)pixels * frames * REPEATS;
+	printf("%dx%d, %d frames, %s kernels\n", width, height, frames, seg_kernel_name());
+	report("hsv (blockz.conf)", hsv, total);
+	report("thresholds scalar", scalar, total);
+	report("thresholds fused", fused, total);
+	report("table", table, total);
+	printf("                                  %.2fx faster than hsv, %.2fx faster than scalar, %.2fx vs fused\n",
+		   hsv / table, scalar / table, fused / table);
+	printf("  %-22s %8.4f%% of pixels differ from the thresholds, %.4f%% from the hsv ranges\n", "table accuracy",
+		   100.0 * color_differences / total, 100.0 * hsv_differences / total);
+	printf("  %-22s %8.1f ms from thresholds, %.1f ms from hsv ranges, %.1f us to map a saved table\n", "table build",
+		   (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t4 - t3) * 1e6);
+
+	lut_unmap(mapped);
+	remove(TABLE_FILE);
+	free(video);
+	free(expected);
+	seg_free(&seg);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 4) {
+		return bench(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]));
+	}
+	return bench(160, 120, DEFAULT_FRAMES) || bench(320, 240, DEFAULT_FRAMES);
+}
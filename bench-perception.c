@@ -0,0 +1,429 @@
+/*
+Benchmark for the whole perception stack behind search_snapshot() / is_pollinated(), stage by stage.
+
+Every frame goes through the stages the robot runs and each stage is timed on its own:
+    capture        copy the frame into the camera buffer (what camera_update() hands us)
+    presence       sampled presence check that gates the rest while searching (ethology profile only)
+    classify       mark the pixels of every color channel
+    label          run-length union-find scan (blob_scan)
+    rank           regions to blobs, largest first (blob_rank)
+    pollination    the red/blue proximity test
+Each robot program variant does these differently, so they are benchmarked as profiles:
+    ethology       ethology-code.c: presence gate, fused classify, all-pairs grid test over every blob
+    simple         pollination-simple.c / is_pollinated.c: every frame in full, largest red against largest blue
+    table          the ethology profile classifying through a lookup table (-l color.lut)
+For every stage and the whole frame the p50 and p99 latency and the mean are reported, plus frames/s, on the
+terminal and with -j as JSON for comparing runs.
+
+Frames come from run logs (-r run.log, see run-log.h), binary PPM files, or by default a synthetic spin-search mix
+(three empty frames for every frame with flowers).
+
+Build and run on any Linux box:
+    gcc -O2 -o bench-perception bench-perception.c color-segment.c color-lut.c blob-label.c pollination.c \
+        run-log.c synthetic-frame.c frame-file.c -lm -pthread
+    ./bench-perception [-j results.json] [-l color.lut] [-p profile] [-r run.log | frame.ppm ... | width height frames]
+*/
+
+#include "color-segment.h"
+#include "color-lut.h"
+#include "blob-label.h"
+#include "pollination.h"
+#include "run-log.h"
+#include "synthetic-frame.h"
+#include "frame-file.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_FRAMES 400
+#define REPEATS 5               // passes over the frame set
+#define POLLINATION_DISTANCE 30 // same as ethology-code.c
+
+enum stage { CAPTURE, PRESENCE, CLASSIFY, LABEL, RANK, POLLINATION, TOTAL, STAGES };
+static const char *stage_names[STAGES] = {"capture", "presence", "classify", "label", "rank", "pollination", "total"};
+
+enum profile { ETHOLOGY, SIMPLE, TABLE, PROFILES };
+static const char *profile_names[PROFILES] = {"ethology", "simple", "table"};
+
+typedef struct frame_set {
+	int width, height;
+	int count;
+	unsigned char **frames;      // BGR
+} frame_set;
+
+typedef struct stage_result {
+	double p50, p99, mean;       // microseconds
+} stage_result;
+
+typedef struct profile_result {
+	const char *name;
+	double fps;
+	int pollinated;              // frames the test called pollinated (a sanity check between profiles)
+	stage_result stages[STAGES];
+} profile_result;
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// Summarize: percentiles and mean of one stage's per-frame times (sorts the samples)
+static stage_result summarize(double *samples, int count)
+{
+	qsort(samples, count, sizeof(double), compare_doubles);
+	double sum = 0;
+	for (int i = 0; i < count; i++) {
+		sum += samples[i];
+	}
+	stage_result result;
+	result.p50 = samples[count / 2] * 1e6;
+	result.p99 = samples[(int)(count * 0.99) < count ? (int)(count * 0.99) : count - 1] * 1e6;
+	result.mean = sum / count * 1e6;
+	return result;
+}
+
+// Simple Pollinated: the test of pollination-simple.c, largest red against largest blue
+static bool simple_pollinated(const segmenter *seg)
+{
+	if (seg_object_count(seg, 0) < 1 || seg_object_count(seg, 1) < 1) {
+		return false;
+	}
+	seg_point red = seg_object_centroid(seg, 0, 0);
+	seg_point blue = seg_object_centroid(seg, 1, 0);
+	float dist = sqrt(pow(red.x - blue.x, 2) + pow(red.y - blue.y, 2));
+	return dist < POLLINATION_DISTANCE;
+}
+
+// Ethology Pollinated: the test of ethology-code.c, every red blob against every blue blob
+static bool ethology_pollinated(const segmenter *seg)
+{
+	const seg_channel *red = &seg->channels[0], *blue = &seg->channels[1];
+	int red_count = red->count < SEG_MAX_BLOBS ? red->count : SEG_MAX_BLOBS;
+	int blue_count = blue->count < SEG_MAX_BLOBS ? blue->count : SEG_MAX_BLOBS;
+	if (red_count < 1 || blue_count < 1) {
+		return false;
+	}
+	seg_point red_points[SEG_MAX_BLOBS], blue_points[SEG_MAX_BLOBS];
+	for (int i = 0; i < red_count; i++) {
+		red_points[i] = red->blobs[i].centroid;
+	}
+	for (int i = 0; i < blue_count; i++) {
+		blue_points[i] = blue->blobs[i].centroid;
+	}
+	pollination_result flowers;
+	find_pollinated(red_points, red_count, blue_points, blue_count, POLLINATION_DISTANCE, seg->width, seg->height,
+					&flowers);
+	return first_unpollinated(&flowers) < 0;
+}
+
+// Run Profile: push every frame through one profile's stages and collect the per-stage latencies
+static int run_profile(enum profile profile, const frame_set *set, const unsigned char *table, int table_channels,
+					   profile_result *result)
+{
+	segmenter seg;
+	int pixels = set->width * set->height;
+	int samples = set->count * REPEATS;
+	unsigned char *camera = malloc(3 * pixels);
+	double *times[STAGES];
+	for (int stage = 0; stage < STAGES; stage++) {
+		times[stage] = calloc(samples, sizeof(double));
+		if (!times[stage]) {
+			camera = NULL;
+		}
+	}
+	if (!camera || !seg_init(&seg, set->width, set->height)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	seg_default_colors(&seg);
+	seg_set_lut(&seg, profile == TABLE ? table : NULL, table_channels);
+
+	result->name = profile_names[profile];
+	result->pollinated = 0;
+	int step = seg_presence_step(&seg, SEG_PRESENCE_HITS);
+	double start = now_seconds();
+	for (int sample = 0; sample < samples; sample++) {
+		const unsigned char *frame = set->frames[sample % set->count];
+		double stage_time[STAGES] = {0};
+		double t0 = now_seconds();
+		memcpy(camera, frame, 3 * pixels);
+		double t1 = now_seconds();
+		bool present = profile == SIMPLE || seg_presence(&seg, camera, step, SEG_PRESENCE_HITS, ~0u) != 0;
+		double t2 = now_seconds();
+		if (present) {
+			if (profile == SIMPLE) {
+				seg_load_bgr(&seg, camera); // one channel at a time through the planes
+				for (int channel = 0; channel < seg.channel_count; channel++) {
+					seg_classify(&seg, channel);
+				}
+			} else {
+				seg_classify_all(&seg, camera);
+			}
+		}
+		double t3 = now_seconds();
+		stage_time[CAPTURE] = t1 - t0;
+		stage_time[PRESENCE] = t2 - t1;
+		stage_time[CLASSIFY] = t3 - t2;
+
+		// the labeller holds one channel's regions at a time, so scan and rank alternate per channel
+		seg_rect whole = {0, 0, set->width, set->height};
+		for (int channel = 0; channel < seg.channel_count; channel++) {
+			if (!present) {
+				seg.channels[channel].count = 0;
+				continue;
+			}
+			double s0 = now_seconds();
+			int runs = blob_scan(seg.labeller, seg.mask, 1 << channel, whole);
+			double s1 = now_seconds();
+			blob_rank(seg.labeller, runs, seg.min_area, &seg.channels[channel]);
+			double s2 = now_seconds();
+			stage_time[LABEL] += s1 - s0;
+			stage_time[RANK] += s2 - s1;
+		}
+
+		double p0 = now_seconds();
+		result->pollinated += profile == SIMPLE ? simple_pollinated(&seg) : ethology_pollinated(&seg);
+		double p1 = now_seconds();
+		stage_time[POLLINATION] = p1 - p0;
+		stage_time[TOTAL] = p1 - t0;
+		for (int stage = 0; stage < STAGES; stage++) {
+			times[stage][sample] = stage_time[stage];
+		}
+	}
+	result->fps = samples / (now_seconds() - start);
+	for (int stage = 0; stage < STAGES; stage++) {
+		result->stages[stage] = summarize(times[stage], samples);
+		free(times[stage]);
+	}
+	free(camera);
+	seg_free(&seg);
+	return 0;
+}
+
+// Write String: "text" as a JSON string, quotes, backslashes and control characters escaped
+static void write_string(FILE *out, const char *text)
+{
+	fputc('"', out);
+	for (const unsigned char *c = (const unsigned char *)text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(out, "\\%c", *c);
+		} else if (*c < 0x20) {
+			fprintf(out, "\\u%04x", *c);
+		} else {
+			fputc(*c, out);
+		}
+	}
+	fputc('"', out);
+}
+
+// Write JSON: every profile's results as one JSON document
+static void write_json(FILE *out, const frame_set *set, const char *source, const profile_result *results, int count)
+{
+	fprintf(out, "{\n  \"source\": ");
+	write_string(out, source);
+	fprintf(out, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %d,\n", set->width, set->height,
+			set->count);
+	fprintf(out, "  \"repeats\": %d,\n  \"kernel\": \"%s\",\n  \"profiles\": [\n", REPEATS, seg_kernel_name());
+	for (int p = 0; p < count; p++) {
+		const profile_result *result = &results[p];
+		fprintf(out, "    {\n      \"name\": \"%s\",\n      \"fps\": %.1f,\n      \"pollinated_frames\": %d,\n",
+				result->name, result->fps, result->pollinated);
+		fprintf(out, "      \"stages\": {\n");
+		for (int stage = 0; stage < STAGES; stage++) {
+			const stage_result *s = &result->stages[stage];
+			fprintf(out, "        \"%s\": {\"p50_us\": %.2f, \"p99_us\": %.2f, \"mean_us\": %.2f}%s\n",
+					stage_names[stage], s->p50, s->p99, s->mean, stage + 1 < STAGES ? "," : "");
+		}
+		fprintf(out, "      }\n    }%s\n", p + 1 < count ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+static void print_results(const frame_set *set, const char *source, const profile_result *results, int count)
+{
+	printf("%s: %d frames of %dx%d x %d passes, %s kernels\n", source, set->count, set->width, set->height, REPEATS,
+		   seg_kernel_name());
+	for (int p = 0; p < count; p++) {
+		const profile_result *result = &results[p];
+		printf("  %-10s %10.1f frames/s, %d frames pollinated\n", result->name, result->fps, result->pollinated);
+		for (int stage = 0; stage < STAGES; stage++) {
+			const stage_result *s = &result->stages[stage];
+			printf("    %-12s p50 %9.2f us   p99 %9.2f us   mean %9.2f us\n", stage_names[stage], s->p50, s->p99,
+				   s->mean);
+		}
+	}
+}
+
+// Holds: the record's payload is at least "bytes" long, so a damaged record is skipped rather than read past
+static bool holds(const run_record *record, unsigned long long bytes)
+{
+	return record->size >= bytes;
+}
+
+// Load Log: every frame of a run log, copied out of the mapping
+static bool load_log(const char *path, frame_set *set)
+{
+	run_log_reader reader;
+	if (!run_log_open(&reader, path)) {
+		return false;
+	}
+	set->frames = malloc(reader.record_count * sizeof(unsigned char *));
+	set->count = 0;
+	const void *payload;
+	const run_record *record;
+	while (set->frames && (record = run_log_next(&reader, &payload))) {
+		const run_frame_header *frame = payload;
+		if (record->type != RUN_FRAME || !holds(record, sizeof(run_frame_header)) || !frame->width || !frame->height
+			|| !holds(record, sizeof(run_frame_header) + 3ull * frame->width * frame->height)) {
+			continue; // not a frame, or a damaged one
+		}
+		if (set->count > 0 && ((int)frame->width != set->width || (int)frame->height != set->height)) {
+			continue; // keep to the first frame size
+		}
+		set->width = frame->width;
+		set->height = frame->height;
+		size_t bytes = (size_t)3 * set->width * set->height;
+		unsigned char *copy = malloc(bytes);
+		if (!copy) {
+			break;
+		}
+		memcpy(copy, frame + 1, bytes);
+		set->frames[set->count++] = copy;
+	}
+	run_log_close(&reader);
+	return set->count > 0;
+}
+
+// Synthetic Set: the spin-search mix, three empty frames for every frame with flowers
+static bool synthetic_set(int width, int height, int count, frame_set *set)
+{
+	set->width = width;
+	set->height = height;
+	set->count = count;
+	set->frames = malloc(count * sizeof(unsigned char *));
+	for (int f = 0; set->frames && f < count; f++) {
+		set->frames[f] = malloc((size_t)3 * width * height);
+		if (!set->frames[f]) {
+			return false;
+		}
+		if (f % 4 == 0) {
+			synth_frame(set->frames[f], width, height, f + 1);
+		} else {
+			synth_empty_frame(set->frames[f], width, height, f + 1);
+		}
+	}
+	return set->frames != NULL;
+}
+
+int main(int argc, char **argv)
+{
+	const char *json_path = NULL, *table_path = NULL, *log_path = NULL, *only = NULL;
+	int arg = 1;
+	for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+		switch (argv[arg][1]) {
+		case 'j': json_path = argv[arg + 1]; break;
+		case 'l': table_path = argv[arg + 1]; break;
+		case 'r': log_path = argv[arg + 1]; break;
+		case 'p': only = argv[arg + 1]; break;
+		default:
+			fprintf(stderr, "usage: %s [-j results.json] [-l color.lut] [-p profile] "
+							"[-r run.log | frame.ppm ... | width height frames]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (only) {
+		int profile = 0;
+		while (profile < PROFILES && strcmp(only, profile_names[profile]) != 0) {
+			profile++;
+		}
+		if (profile == PROFILES) {
+			fprintf(stderr, "no profile %s\n", only);
+			return 2;
+		}
+		if (profile == TABLE && !table_path) {
+			fprintf(stderr, "the table profile needs a lookup table (-l color.lut)\n");
+			return 2;
+		}
+	}
+
+	frame_set set = {0, 0, 0, NULL};
+	char source[256] = "synthetic";
+	if (log_path) {
+		if (!load_log(log_path, &set)) {
+			fprintf(stderr, "no frames in %s\n", log_path);
+			return 1;
+		}
+		snprintf(source, sizeof(source), "%s", log_path);
+	} else if (argc - arg == 3 && atoi(argv[arg]) > 0) {
+		if (!synthetic_set(atoi(argv[arg]), atoi(argv[arg + 1]), atoi(argv[arg + 2]), &set)) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+	} else if (arg < argc) {
+		set.frames = malloc((argc - arg) * sizeof(unsigned char *));
+		for (; arg < argc; arg++) {
+			int width, height;
+			unsigned char *frame = frame_load_ppm(argv[arg], &width, &height);
+			if (!frame || (set.count > 0 && (width != set.width || height != set.height))) {
+				fprintf(stderr, "cannot use %s\n", argv[arg]);
+				return 1;
+			}
+			set.width = width;
+			set.height = height;
+			set.frames[set.count++] = frame;
+		}
+		snprintf(source, sizeof(source), "%d recorded frames", set.count);
+	} else if (!synthetic_set(160, 120, DEFAULT_FRAMES, &set)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	const unsigned char *table = NULL;
+	int table_channels = 0;
+	if (table_path && !(table = lut_map(table_path, &table_channels))) {
+		fprintf(stderr, "cannot map %s\n", table_path);
+		return 1;
+	}
+
+	profile_result results[PROFILES];
+	int count = 0;
+	for (int profile = 0; profile < PROFILES; profile++) {
+		if (only ? strcmp(only, profile_names[profile]) != 0 : profile == TABLE && !table) {
+			continue; // the table profile needs -l
+		}
+		if (run_profile(profile, &set, table, table_channels, &results[count])) {
+			return 1;
+		}
+		count++;
+	}
+	print_results(&set, source, results, count);
+	if (json_path) {
+		FILE *out = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+		if (!out) {
+			fprintf(stderr, "cannot write %s\n", json_path);
+			return 1;
+		}
+		write_json(out, &set, source, results, count);
+		if (out != stdout) {
+			fclose(out);
+		}
+	}
+
+	for (int f = 0; f < set.count; f++) {
+		free(set.frames[f]);
+	}
+	free(set.frames);
+	lut_unmap(table);
+	return 0;
+}
@@ -0,0 +1,241 @@
+/*
+Benchmark for the color segmentation stage (color-segment.c) on synthetic frames.
+
+Reports the per-pixel cost of deinterleaving, classifying (scalar and vector kernels, one channel at a time and fused
+over all channels) and blob extraction, and checks that every kernel marks exactly the same pixels as the scalar one. A second run over an approach sequence compares
+whole-frame processing with tracking mode (seg_process_tracked), and a third compares the presence check
+(seg_presence) with the full pipeline on a spin-search mix of empty frames and frames with flowers.
+
+Build and run on any Linux box:
+    gcc -O2 -o bench-segment bench-segment.c color-segment.c blob-label.c synthetic-frame.c
+    ./bench-segment [width height frames]
+*/
+
+#include "color-segment.h"
+#include "synthetic-frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_FRAMES 200
+#define REPEATS 5 // passes over the frame set per measurement
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Report: print the cost of one stage per pixel and as throughput
+static void report(const char *stage, double seconds, long pixels)
+{
+	printf("  %-22s %8.2f ns/pixel %10.1f Mpixel/s\n", stage, seconds * 1e9 / pixels, pixels / seconds / 1e6);
+}
+
+// Bench Tracking: frames per second of the whole pipeline with and without tracking mode over an approach sequence
+static int bench_tracking(int width, int height, int frames)
+{
+	segmenter seg;
+	seg_tracker tracker;
+	if (!seg_init(&seg, width, height)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	seg_default_colors(&seg);
+	int frame_bytes = 3 * width * height;
+	unsigned char *video = malloc((size_t)frame_bytes * frames);
+	if (!video) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int f = 0; f < frames; f++) {
+		synth_approach_frame(video + (size_t)f * frame_bytes, width, height, f);
+	}
+
+	double full = 0, tracked = 0;
+	int windowed = 0, mismatches = 0;
+	for (int rep = 0; rep < REPEATS; rep++) {
+		seg_track_start(&tracker, 0, width / 10);
+		for (int f = 0; f < frames; f++) {
+			const unsigned char *bgr = video + (size_t)f * frame_bytes;
+			double t0 = now_seconds();
+			seg_process(&seg, bgr);
+			double t1 = now_seconds();
+			seg_point expected = seg_object_centroid(&seg, 0, 0);
+			double t2 = now_seconds();
+			windowed += seg_process_tracked(&seg, &tracker, bgr);
+			double t3 = now_seconds();
+			seg_point found = seg_object_centroid(&seg, 0, 0);
+			mismatches += found.x != expected.x || found.y != expected.y;
+			full += t1 - t0;
+			tracked += t3 - t2;
+		}
+	}
+	printf("  %-22s %8.1f frames/s whole frame, %.1f frames/s tracked (%.2fx), %.0f%% windowed, %d centroid mismatches\n",
+		   "tracking mode", frames * REPEATS / full, frames * REPEATS / tracked, full / tracked,
+		   100.0 * windowed / (frames * REPEATS), mismatches);
+	free(video);
+	seg_free(&seg);
+	return 0;
+}
+
+// Bench Presence: cost per frame of the presence check against the full pipeline, and how often it misses a blob
+static int bench_presence(int width, int height, int frames)
+{
+	segmenter seg;
+	if (!seg_init(&seg, width, height)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	seg_default_colors(&seg);
+	int frame_bytes = 3 * width * height;
+	unsigned char *video = malloc((size_t)frame_bytes * frames);
+	if (!video) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int f = 0; f < frames; f++) {
+		// three out of four frames during a spin show nothing but floor
+		if (f % 4 == 0) {
+			synth_frame(video + (size_t)f * frame_bytes, width, height, f);
+		} else {
+			synth_empty_frame(video + (size_t)f * frame_bytes, width, height, f);
+		}
+	}
+
+	double full = 0, presence = 0, gated = 0;
+	int misses = 0, step = seg_presence_step(&seg, SEG_PRESENCE_HITS);
+	for (int rep = 0; rep < REPEATS; rep++) {
+		for (int f = 0; f < frames; f++) {
+			const unsigned char *bgr = video + (size_t)f * frame_bytes;
+			double t0 = now_seconds();
+			seg_process(&seg, bgr);
+			double t1 = now_seconds();
+			unsigned int present = seg_presence(&seg, bgr, step, SEG_PRESENCE_HITS, ~0u); // any channel, as while searching
+			double t2 = now_seconds();
+			if (present) {
+				seg_process(&seg, bgr);
+			}
+			double t3 = now_seconds();
+			seg_process(&seg, bgr);
+			bool seen = false;
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seen |= seg_object_count(&seg, channel) > 0;
+			}
+			misses += seen && !present;
+			full += t1 - t0;
+			presence += t2 - t1;
+			gated += t3 - t1;
+		}
+	}
+	int passes = frames * REPEATS;
+	printf("  %-22s %8.1f us/frame presence, %.1f us/frame full; search %.1f frames/s gated vs %.1f (%.2fx), %d missed\n",
+		   "presence check", presence * 1e6 / passes, full * 1e6 / passes, passes / gated, passes / full, full / gated,
+		   misses);
+	free(video);
+	seg_free(&seg);
+	return 0;
+}
+
+static int bench(int width, int height, int frames)
+{
+	segmenter seg;
+	if (!seg_init(&seg, width, height)) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	seg_default_colors(&seg);
+
+	int frame_bytes = 3 * width * height;
+	unsigned char *video = malloc((size_t)frame_bytes * frames);
+	unsigned char *reference = malloc(width * height);
+	if (!video || !reference) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (int f = 0; f < frames; f++) {
+		synth_frame(video + (size_t)f * frame_bytes, width, height, f);
+	}
+
+	// the vector kernel has to agree with the scalar one on every pixel
+	for (int f = 0; f < frames; f++) {
+		seg_load_bgr(&seg, video + (size_t)f * frame_bytes);
+		for (int channel = 0; channel < seg.channel_count; channel++) {
+			seg_classify_scalar(&seg, channel);
+		}
+		memcpy(reference, seg.mask, width * height);
+		for (int channel = 0; channel < seg.channel_count; channel++) {
+			seg_classify(&seg, channel);
+		}
+		if (memcmp(reference, seg.mask, width * height) != 0) {
+			fprintf(stderr, "%s kernel disagrees with scalar kernel on frame %d\n", seg_kernel_name(), f);
+			return 1;
+		}
+		seg_classify_all(&seg, video + (size_t)f * frame_bytes);
+		if (memcmp(reference, seg.mask, width * height) != 0) {
+			fprintf(stderr, "fused kernel disagrees with scalar kernel on frame %d\n", f);
+			return 1;
+		}
+	}
+
+	long pixels = (long)width * height * frames * REPEATS;
+	double load = 0, scalar = 0, vector = 0, fused = 0, blobs = 0;
+	int found = 0;
+	for (int rep = 0; rep < REPEATS; rep++) {
+		for (int f = 0; f < frames; f++) {
+			double t0 = now_seconds();
+			seg_load_bgr(&seg, video + (size_t)f * frame_bytes);
+			double t1 = now_seconds();
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seg_classify_scalar(&seg, channel);
+			}
+			double t2 = now_seconds();
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seg_classify(&seg, channel);
+			}
+			double t3 = now_seconds();
+			seg_classify_all(&seg, video + (size_t)f * frame_bytes);
+			double t4 = now_seconds();
+			for (int channel = 0; channel < seg.channel_count; channel++) {
+				seg_find_blobs(&seg, channel);
+				found += seg_object_count(&seg, channel);
+			}
+			double t5 = now_seconds();
+			load += t1 - t0;
+			scalar += t2 - t1;
+			vector += t3 - t2;
+			fused += t4 - t3;
+			blobs += t5 - t4;
+		}
+	}
+
+	printf("%dx%d, %d frames x %d passes, %d channels, %.1f blobs/frame\n", width, height, frames, REPEATS,
+		   seg.channel_count, (double)found / (frames * REPEATS));
+	report("deinterleave", load, pixels);
+	report("classify (scalar)", scalar, pixels);
+	report("classify (vector)", vector, pixels);
+	printf("  %-22s %8s %6.2fx faster than scalar\n", seg_kernel_name(), "", scalar / vector);
+	report("fused (all channels)", fused, pixels);
+	printf("  %-22s %8s %6.2fx faster than deinterleave + per-channel classify\n", "", "", (load + vector) / fused);
+	report("blobs (run labeller)", blobs, pixels);
+	printf("  %-22s %8.1f frames/s\n", "whole pipeline", frames * REPEATS / (fused + blobs));
+
+	free(video);
+	free(reference);
+	seg_free(&seg);
+	return bench_tracking(width, height, frames) || bench_presence(width, height, frames);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc == 4) {
+		return bench(atoi(argv[1]), atoi(argv[2]), atoi(argv[3]));
+	}
+	if (argc != 1) {
+		fprintf(stderr, "usage: %s [width height frames]\n", argv[0]);
+		return 2;
+	}
+	return bench(160, 120, DEFAULT_FRAMES) || bench(320, 240, DEFAULT_FRAMES);
+}
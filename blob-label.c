@@ -0,0 +1,169 @@
+/*
+Run-length connected-components labelling (see blob-label.h).
+*/
+
+#include "blob-label.h"
+#include <stdint.h> // uint64_t
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy
+
+bool blob_labeller_init(blob_labeller *labeller, int width, int height)
+{
+	labeller->width = width;
+	labeller->height = height;
+	labeller->max_runs = (width + 1) / 2 * height;
+	labeller->runs = malloc(labeller->max_runs * sizeof(blob_run));
+	labeller->parent = malloc(labeller->max_runs * sizeof(int));
+	labeller->stats = malloc(labeller->max_runs * sizeof(blob_stats));
+	if (!labeller->runs || !labeller->parent || !labeller->stats) {
+		blob_labeller_free(labeller);
+		return false;
+	}
+	return true;
+}
+
+void blob_labeller_free(blob_labeller *labeller)
+{
+	free(labeller->runs);
+	free(labeller->parent);
+	free(labeller->stats);
+	labeller->runs = NULL;
+	labeller->parent = NULL;
+	labeller->stats = NULL;
+}
+
+// Find Root: union-find lookup with path halving
+static int find_root(int *parent, int run)
+{
+	while (parent[run] != run) {
+		parent[run] = parent[parent[run]];
+		run = parent[run];
+	}
+	return run;
+}
+
+// Unite: merge the regions of two runs, folding the statistics into the surviving root
+static void unite(blob_labeller *labeller, int a, int b)
+{
+	a = find_root(labeller->parent, a);
+	b = find_root(labeller->parent, b);
+	if (a == b) {
+		return;
+	}
+	blob_stats *sa = &labeller->stats[a];
+	blob_stats *sb = &labeller->stats[b];
+	if (sa->area < sb->area) {
+		// the larger region stays the root, keeping the trees shallow
+		int t = a; a = b; b = t;
+		blob_stats *ts = sa; sa = sb; sb = ts;
+	}
+	labeller->parent[b] = a;
+	sa->area += sb->area;
+	sa->sum_x += sb->sum_x;
+	sa->sum_y += sb->sum_y;
+	if (sb->min_x < sa->min_x) sa->min_x = sb->min_x;
+	if (sb->max_x > sa->max_x) sa->max_x = sb->max_x;
+	if (sb->min_y < sa->min_y) sa->min_y = sb->min_y;
+	if (sb->max_y > sa->max_y) sa->max_y = sb->max_y;
+}
+
+// Next Marked: first column in [x, end) whose mask byte has the bit set (end if none), skipping 8 bytes at a time
+static int next_marked(const unsigned char *row, int x, int end, unsigned char bit)
+{
+	const uint64_t bits = 0x0101010101010101ull * bit;
+	while (x < end && (row[x] & bit) == 0) {
+		if (x + 8 <= end) {
+			uint64_t word;
+			memcpy(&word, row + x, 8);
+			if ((word & bits) == 0) {
+				x += 8;
+				continue;
+			}
+		}
+		x++;
+	}
+	return x;
+}
+
+int blob_label(blob_labeller *labeller, const unsigned char *mask, unsigned char bit, int min_area, seg_channel *result)
+{
+	seg_rect frame = {0, 0, labeller->width, labeller->height};
+	return blob_label_window(labeller, mask, bit, frame, min_area, result);
+}
+
+int blob_label_window(blob_labeller *labeller, const unsigned char *mask, unsigned char bit, seg_rect window,
+					  int min_area, seg_channel *result)
+{
+	int count = blob_scan(labeller, mask, bit, window);
+	blob_rank(labeller, count, min_area, result);
+	return count;
+}
+
+int blob_scan(blob_labeller *labeller, const unsigned char *mask, unsigned char bit, seg_rect window)
+{
+	int width = labeller->width;
+	int left = window.ulx;
+	int right = window.ulx + window.width; // one past the last column
+	int count = 0;           // runs so far
+	int previous_start = 0;  // runs of the row above are [previous_start, row_start)
+
+	for (int y = window.uly; y < window.uly + window.height; y++) {
+		const unsigned char *row = mask + y * width;
+		int row_start = count;
+		int above = previous_start;
+
+		int x = next_marked(row, left, right, bit);
+		while (x < right) {
+			int x_start = x;
+			while (x < right && (row[x] & bit)) {
+				x++;
+			}
+			int x_end = x - 1;
+
+			int run = count++;
+			int length = x_end - x_start + 1;
+			labeller->runs[run].x_start = x_start;
+			labeller->runs[run].x_end = x_end;
+			labeller->parent[run] = run;
+			blob_stats *s = &labeller->stats[run];
+			s->area = length;
+			s->sum_x = (long)(x_start + x_end) * length / 2;
+			s->sum_y = (long)y * length;
+			s->min_x = x_start;
+			s->max_x = x_end;
+			s->min_y = s->max_y = y;
+
+			// join every run of the row above that shares a column with this one
+			while (above < row_start && labeller->runs[above].x_end < x_start) {
+				above++;
+			}
+			for (int k = above; k < row_start && labeller->runs[k].x_start <= x_end; k++) {
+				unite(labeller, k, run);
+			}
+
+			x = next_marked(row, x, right, bit);
+		}
+		previous_start = row_start;
+	}
+	return count;
+}
+
+void blob_rank(const blob_labeller *labeller, int count, int min_area, seg_channel *result)
+{
+	result->count = 0;
+	for (int run = 0; run < count; run++) {
+		if (labeller->parent[run] != run || labeller->stats[run].area < min_area) {
+			continue;
+		}
+		const blob_stats *s = &labeller->stats[run];
+		seg_blob blob;
+		blob.area = s->area;
+		blob.bbox.ulx = s->min_x;
+		blob.bbox.uly = s->min_y;
+		blob.bbox.width = s->max_x - s->min_x + 1;
+		blob.bbox.height = s->max_y - s->min_y + 1;
+		blob.centroid.x = (int)(s->sum_x / s->area);
+		blob.centroid.y = (int)(s->sum_y / s->area);
+		seg_keep_blob(result, &blob);
+	}
+}
@@ -0,0 +1,52 @@
+/*
+Run-length connected-components labelling for the pollinator robots.
+
+Turns one channel of a segmentation mask into blobs (area, bounding box, centroid) in a single raster scan: each row
+is cut into runs of marked pixels, runs that overlap a run of the row above are merged with union-find, and the
+statistics are merged along with them. There is no per-pixel label image and nothing is allocated per frame; the run
+and label pools are sized for the worst case once, in blob_labeller_init.
+*/
+
+#ifndef BLOB_LABEL_H
+#define BLOB_LABEL_H
+
+#include "color-segment.h" // seg_channel, seg_blob
+#include <stdbool.h>       // Boolean support
+
+typedef struct blob_run {
+	short x_start, x_end;    // inclusive pixel columns
+} blob_run;
+
+// Statistics of one connected region, kept at its union-find root
+typedef struct blob_stats {
+	int area;
+	long sum_x, sum_y;
+	short min_x, max_x, min_y, max_y;
+} blob_stats;
+
+typedef struct blob_labeller {
+	int width, height;
+	int max_runs;            // worst case: every other pixel of every row starts a run
+	blob_run *runs;          // run pool for the whole frame
+	int *parent;             // union-find parent of each run
+	blob_stats *stats;       // valid at root runs only
+} blob_labeller;
+
+bool blob_labeller_init(blob_labeller *labeller, int width, int height); // false if out of memory
+void blob_labeller_free(blob_labeller *labeller);
+
+// Label: find the 4-connected blobs of the pixels whose mask byte has "bit" set, keep those of at least
+// "min_area" pixels in "result" (largest first); returns the number of runs the frame had
+int blob_label(blob_labeller *labeller, const unsigned char *mask, unsigned char bit, int min_area, seg_channel *result);
+
+// Label Window: same as blob_label but only looks at the pixels inside "window"; blob coordinates stay full-frame
+int blob_label_window(blob_labeller *labeller, const unsigned char *mask, unsigned char bit, seg_rect window,
+					  int min_area, seg_channel *result);
+
+// The two halves of blob_label_window, separate so they can be profiled on their own:
+// Scan: build the runs and merge them into regions; returns the number of runs
+int blob_scan(blob_labeller *labeller, const unsigned char *mask, unsigned char bit, seg_rect window);
+// Rank: turn the regions of the last scan ("count" runs) into blobs, largest first
+void blob_rank(const blob_labeller *labeller, int count, int min_area, seg_channel *result);
+
+#endif
@@ -0,0 +1,176 @@
+/*
+Multi-target blob tracker (see blob-track.h).
+
+With at most TRACK_MAX_TARGETS targets and blobs per frame, association simply ranks every target/blob pair by
+squared distance and takes them greedily, nearest first.
+*/
+
+#include "blob-track.h"
+#include <string.h> // memset
+
+void blob_tracker_init(blob_tracker *tracker, float alpha, float beta, int gate, int max_missed)
+{
+	tracker->alpha = alpha;
+	tracker->beta = beta;
+	tracker->gate = gate;
+	tracker->max_missed = max_missed;
+	blob_tracker_reset(tracker);
+}
+
+void blob_tracker_reset(blob_tracker *tracker)
+{
+	memset(tracker->targets, 0, sizeof(tracker->targets));
+	memset(tracker->blob_id, 0, sizeof(tracker->blob_id));
+	tracker->next_id = 1;
+}
+
+// Predicted: position of a target "dt" milliseconds after its last update
+static void predicted(const track_target *target, float dt, float *x, float *y)
+{
+	*x = target->x + target->vx * dt;
+	*y = target->y + target->vy * dt;
+}
+
+void blob_tracker_update(blob_tracker *tracker, const seg_point *centroids, int count, unsigned long time)
+{
+	if (count > TRACK_MAX_TARGETS) count = TRACK_MAX_TARGETS;
+	float gate_sq = (float)tracker->gate * tracker->gate;
+
+	// distance from every live target's prediction to every blob, inside the gate only
+	float distance[TRACK_MAX_TARGETS][TRACK_MAX_TARGETS];
+	for (int t = 0; t < TRACK_MAX_TARGETS; t++) {
+		const track_target *target = &tracker->targets[t];
+		for (int b = 0; b < count; b++) {
+			distance[t][b] = -1.0f;
+			if (target->id == 0) {
+				continue;
+			}
+			float x, y;
+			predicted(target, (float)(long)(time - target->time), &x, &y);
+			float dx = centroids[b].x - x;
+			float dy = centroids[b].y - y;
+			float d = dx * dx + dy * dy;
+			if (d <= gate_sq) {
+				distance[t][b] = d;
+			}
+		}
+	}
+
+	// greedy association, nearest pair first
+	int target_blob[TRACK_MAX_TARGETS];
+	int blob_target[TRACK_MAX_TARGETS];
+	for (int i = 0; i < TRACK_MAX_TARGETS; i++) {
+		target_blob[i] = -1;
+		blob_target[i] = -1;
+	}
+	while (true) {
+		int best_t = -1, best_b = -1;
+		for (int t = 0; t < TRACK_MAX_TARGETS; t++) {
+			if (target_blob[t] >= 0) {
+				continue;
+			}
+			for (int b = 0; b < count; b++) {
+				if (blob_target[b] >= 0 || distance[t][b] < 0) {
+					continue;
+				}
+				if (best_t < 0 || distance[t][b] < distance[best_t][best_b]) {
+					best_t = t;
+					best_b = b;
+				}
+			}
+		}
+		if (best_t < 0) {
+			break;
+		}
+		target_blob[best_t] = best_b;
+		blob_target[best_b] = best_t;
+	}
+
+	// alpha-beta correction of matched targets, aging of unmatched ones
+	for (int t = 0; t < TRACK_MAX_TARGETS; t++) {
+		track_target *target = &tracker->targets[t];
+		if (target->id == 0) {
+			continue;
+		}
+		if (target_blob[t] < 0) {
+			if (++target->missed > tracker->max_missed) {
+				target->id = 0;
+			}
+			continue;
+		}
+		const seg_point *measured = &centroids[target_blob[t]];
+		float dt = (float)(long)(time - target->time);
+		float x, y;
+		predicted(target, dt, &x, &y);
+		float rx = measured->x - x;
+		float ry = measured->y - y;
+		target->x = x + tracker->alpha * rx;
+		target->y = y + tracker->alpha * ry;
+		if (dt > 0) {
+			target->vx += tracker->beta * rx / dt;
+			target->vy += tracker->beta * ry / dt;
+		}
+		target->time = time;
+		target->missed = 0;
+	}
+
+	// new targets for blobs nobody claimed
+	for (int b = 0; b < count; b++) {
+		if (blob_target[b] >= 0) {
+			continue;
+		}
+		for (int t = 0; t < TRACK_MAX_TARGETS; t++) {
+			track_target *target = &tracker->targets[t];
+			if (target->id == 0) {
+				target->id = tracker->next_id++;
+				target->x = (float)centroids[b].x;
+				target->y = (float)centroids[b].y;
+				target->vx = 0.0f;
+				target->vy = 0.0f;
+				target->time = time;
+				target->missed = 0;
+				blob_target[b] = t;
+				break;
+			}
+		}
+	}
+
+	for (int b = 0; b < TRACK_MAX_TARGETS; b++) {
+		tracker->blob_id[b] = b < count && blob_target[b] >= 0 ? tracker->targets[blob_target[b]].id : 0;
+	}
+}
+
+bool blob_tracker_predict(const blob_tracker *tracker, int id, unsigned long time, seg_point *position)
+{
+	for (int t = 0; t < TRACK_MAX_TARGETS; t++) {
+		const track_target *target = &tracker->targets[t];
+		if (id != 0 && target->id == id) {
+			float x, y;
+			predicted(target, (float)(long)(time - target->time), &x, &y);
+			position->x = (int)(x + (x < 0 ? -0.5f : 0.5f));
+			position->y = (int)(y + (y < 0 ? -0.5f : 0.5f));
+			return true;
+		}
+	}
+	return false;
+}
+
+int blob_tracker_nearest(const blob_tracker *tracker, seg_point point)
+{
+	int best = 0;
+	float best_distance = -1.0f;
+	for (int t = 0; t < TRACK_MAX_TARGETS; t++) {
+		const track_target *target = &tracker->targets[t];
+		if (target->id == 0) {
+			continue;
+		}
+		float dx = target->x - point.x;
+		float dy = target->y - point.y;
+		float distance = dx * dx + dy * dy;
+		if (best_distance < 0 || distance < best_distance) {
+			best = target->id;
+			best_distance = distance;
+		}
+	}
+	return best;
+}
@@ -0,0 +1,52 @@
+/*
+Multi-target blob tracker for the pollinator robots.
+
+Keeps an ID for every blob across frames and runs a constant-velocity alpha-beta filter on its centroid, so the
+centering loop can steer on where the target will be when the motors act instead of where it was when the last frame
+was captured. Each frame the filtered targets are predicted to the frame's capture time and matched to the measured
+centroids nearest first (within a gate); unmatched centroids start new targets and targets that stay unmatched for
+a few frames are dropped.
+*/
+
+#ifndef BLOB_TRACK_H
+#define BLOB_TRACK_H
+
+#include "color-segment.h" // seg_point
+#include <stdbool.h>       // Boolean support
+
+#define TRACK_MAX_TARGETS 8   // targets followed at once (same as SEG_MAX_BLOBS)
+#define TRACK_ALPHA 0.6f      // default position gain
+#define TRACK_BETA 0.25f      // default velocity gain
+#define TRACK_GATE 40         // default largest jump (pixels) between prediction and measurement of one target
+#define TRACK_MAX_MISSED 3    // default frames a target may go unseen before it is dropped
+
+typedef struct track_target {
+	int id;                  // stable across frames, 0 = slot unused
+	float x, y;              // filtered centroid at "time"
+	float vx, vy;            // pixels per millisecond
+	unsigned long time;      // capture time (ms) of the last update
+	int missed;              // frames in a row without a matching blob
+} track_target;
+
+typedef struct blob_tracker {
+	float alpha, beta;
+	int gate;
+	int max_missed;
+	int next_id;
+	track_target targets[TRACK_MAX_TARGETS];
+	int blob_id[TRACK_MAX_TARGETS];  // ID assigned to each blob of the last update (index 0 = largest)
+} blob_tracker;
+
+void blob_tracker_init(blob_tracker *tracker, float alpha, float beta, int gate, int max_missed);
+void blob_tracker_reset(blob_tracker *tracker);  // forget all targets
+
+// Update: feed the centroids of one frame (largest first) captured at "time" ms
+void blob_tracker_update(blob_tracker *tracker, const seg_point *centroids, int count, unsigned long time);
+
+// Predict: where target "id" will be at "time" ms; false if the tracker no longer follows it
+bool blob_tracker_predict(const blob_tracker *tracker, int id, unsigned long time, seg_point *position);
+
+// Nearest: ID of the target closest to "point" at the last update, 0 if there is none
+int blob_tracker_nearest(const blob_tracker *tracker, seg_point point);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+Background camera capture for the pollinator robots (see camera-thread.h).
+
+The double buffer has two slots, each guarded by its own version counter (a seqlock). The capture thread always
+writes the slot that is not currently published, so a reader copying the published slot only has to retry if the
+writer laps it by two whole frames during the copy. Neither side ever takes a lock.
+
+A ROBOT_VIRTUAL_TIME build (see robot-clock.h) has no capture thread: camera_latest captures a frame itself whenever
+one is due and then reads it back through the same buffer.
+*/
+
+#include "camera-thread.h"
+#include "run-log.h"     // recording frames and blobs for offline replay
+#include "robot-clock.h" // waking the control loop when a frame arrives
+#include <pthread.h>     // capture thread
+#include <stdatomic.h>   // lock-free publishing
+#include <string.h>      // memset
+
+// Set to 1 to take blobs from our own color segmentation (color-segment.c) instead of the blockz.conf channel tracker.
+// search_snapshot() and is_pollinated() read the same frame_snapshot either way.
+#ifndef CAMERA_USE_SEGMENTER
+#define CAMERA_USE_SEGMENTER 0
+#endif
+
+#define CAMERA_VIRTUAL_PERIOD 33 // ms between frames when the control loop captures them itself (ROBOT_VIRTUAL_TIME)
+
+#if CAMERA_USE_SEGMENTER
+#include "color-segment.h"
+#include "color-lut.h"
+#define TRACK_MARGIN 16           // pixels around the target's last bounding box searched in tracking mode
+#define CAMERA_LUT_FILE "color.lut" // lookup table from lut-build; without it the default thresholds are used
+static segmenter seg;
+static seg_tracker tracker = {-1, TRACK_MARGIN, false, {0, 0, 0, 0}, {-1, -1}};
+static unsigned long long tracker_request;  // the request "tracker" was last started for
+#endif
+
+static frame_snapshot slots[2];           // the double buffer
+static atomic_uint slot_version[2];       // odd while the slot is being written
+static atomic_uint published_slot;        // index of the slot holding the newest frame
+static atomic_bool running;
+static atomic_ullong track_request;       // requested by the control loop, 0 for whole-frame scanning (see camera_track)
+#if !ROBOT_VIRTUAL_TIME
+static pthread_t capture_thread;
+#endif
+
+// Publish: write a frame into the unpublished slot and then make it the published one
+static void publish(const frame_snapshot *frame)
+{
+	unsigned int slot = 1 - atomic_load_explicit(&published_slot, memory_order_relaxed);
+	unsigned int version = atomic_load_explicit(&slot_version[slot], memory_order_relaxed);
+
+	atomic_store_explicit(&slot_version[slot], version + 1, memory_order_relaxed); // mark the slot as being written
+	atomic_thread_fence(memory_order_release);
+	slots[slot] = *frame;
+	atomic_store_explicit(&slot_version[slot], version + 2, memory_order_release); // slot is consistent again
+
+	atomic_store_explicit(&published_slot, slot, memory_order_release);
+}
+
+#if CAMERA_USE_SEGMENTER
+// Read Blobs: run our segmentation on the raw camera frame and copy the largest objects of each channel
+static void read_blobs(frame_snapshot *frame)
+{
+	int width = get_camera_width();
+	int height = get_camera_height();
+	frame->width = width;
+	frame->height = height;
+	if (seg.width != width || seg.height != height) {
+		seg_free(&seg);
+		if (!seg_init(&seg, width, height)) {
+			memset(frame->count, 0, sizeof(frame->count));
+			return;
+		}
+		seg_default_colors(&seg);
+		static const unsigned char *lut;
+		static int lut_channels;
+		if (!lut) {
+			lut = lut_map(CAMERA_LUT_FILE, &lut_channels); // mapped once, stays valid for the whole run
+		}
+		seg_set_lut(&seg, lut, lut_channels);
+		tracker.locked = false;
+	}
+	unsigned long long request = atomic_load_explicit(&track_request, memory_order_relaxed);
+	if (request != tracker_request) {
+		if (request == 0) {
+			seg_track_stop(&tracker);
+		} else {
+			seg_track_start(&tracker, (int)(request >> 32) - 1, TRACK_MARGIN);
+			seg_track_target(&tracker, (seg_point){(short)(request >> 16), (short)request});
+		}
+		tracker_request = request;
+	}
+	const unsigned char *bgr = get_camera_frame();
+	if (tracker.channel >= 0) {
+		seg_process_tracked(&seg, &tracker, bgr);
+	} else if (seg_presence(&seg, bgr, seg_presence_step(&seg, SEG_PRESENCE_HITS), SEG_PRESENCE_HITS, ~0u)) {
+		seg_process(&seg, bgr); // something is in view, extract the blobs properly
+	} else {
+		// searching and nothing in view: the cheap sampled check is all this frame needs
+		for (int channel = 0; channel < seg.channel_count; channel++) {
+			seg.channels[channel].count = 0;
+		}
+	}
+	for (int channel = 0; channel < SNAPSHOT_CHANNELS; channel++) {
+		frame->count[channel] = seg_object_count(&seg, channel);
+		for (int i = 0; i < frame->count[channel] && i < SNAPSHOT_BLOBS; i++) {
+			seg_rect box = seg_object_bbox(&seg, channel, i);
+			seg_point center = seg_object_centroid(&seg, channel, i);
+			frame->bbox[channel][i] = (rectangle){box.ulx, box.uly, box.width, box.height};
+			frame->centroid[channel][i] = (point2){center.x, center.y};
+			frame->area[channel][i] = seg_object_area(&seg, channel, i);
+		}
+	}
+}
+#else
+// Read Blobs: copy the largest objects of each channel from the blockz.conf channel tracker
+static void read_blobs(frame_snapshot *frame)
+{
+	frame->width = get_camera_width();
+	frame->height = get_camera_height();
+	for (int channel = 0; channel < SNAPSHOT_CHANNELS; channel++) {
+		frame->count[channel] = get_object_count(channel);
+		for (int i = 0; i < frame->count[channel] && i < SNAPSHOT_BLOBS; i++) {
+			frame->bbox[channel][i] = get_object_bbox(channel, i);
+			frame->centroid[channel][i] = get_object_centroid(channel, i);
+			frame->area[channel][i] = get_object_area(channel, i);
+		}
+	}
+}
+#endif
+
+// Record: append the raw frame and its blobs to the run log (only called while recording)
+static void record(const frame_snapshot *frame)
+{
+	run_log_frame(frame->time, frame->sequence, get_camera_frame(), frame->width, frame->height);
+	run_blobs blobs;
+	memset(&blobs, 0, sizeof(blobs));
+	blobs.sequence = frame->sequence;
+	for (int channel = 0; channel < SNAPSHOT_CHANNELS && channel < RUN_LOG_CHANNELS; channel++) {
+		blobs.count[channel] = frame->count[channel];
+		for (int i = 0; i < frame->count[channel] && i < SNAPSHOT_BLOBS && i < SEG_MAX_BLOBS; i++) {
+			const rectangle *box = &frame->bbox[channel][i];
+			seg_blob *blob = &blobs.blobs[channel][i];
+			blob->area = frame->area[channel][i];
+			blob->bbox = (seg_rect){box->ulx, box->uly, box->width, box->height};
+			blob->centroid = (seg_point){frame->centroid[channel][i].x, frame->centroid[channel][i].y};
+		}
+	}
+	run_log_blobs(frame->time, &blobs);
+}
+
+// Capture: update the camera and publish the blobs of the frame it delivers
+static void capture(frame_snapshot *frame)
+{
+	camera_update(); // blocks until the camera delivers the next frame
+	frame->sequence++;
+	frame->time = systime();
+	read_blobs(frame);
+	publish(frame);
+	if (!ROBOT_VIRTUAL_TIME) {
+		robot_wake(); // a control loop waiting for this frame can act on it now
+	}
+	if (run_log_active()) {
+		record(frame);
+	}
+}
+
+#if ROBOT_VIRTUAL_TIME
+static frame_snapshot captured;           // the frame the control loop captured last
+static unsigned long next_capture;        // systime() at which the camera has the next frame
+
+bool camera_thread_start()
+{
+	memset(slots, 0, sizeof(slots));
+	memset(&captured, 0, sizeof(captured));
+	atomic_store(&published_slot, 0);
+	atomic_store(&running, true);
+	next_capture = systime();
+	return true;
+}
+
+void camera_thread_stop()
+{
+	atomic_store(&running, false);
+}
+#else
+// Capture Loop: publish every frame until stopped
+static void *capture_loop(void *unused)
+{
+	(void)unused;
+	frame_snapshot frame;
+	memset(&frame, 0, sizeof(frame));
+
+	while (atomic_load_explicit(&running, memory_order_relaxed)) {
+		capture(&frame);
+	}
+	return NULL;
+}
+
+bool camera_thread_start()
+{
+	memset(slots, 0, sizeof(slots));
+	atomic_store(&published_slot, 0);
+	atomic_store(&running, true);
+	if (pthread_create(&capture_thread, NULL, capture_loop, NULL) != 0) {
+		atomic_store(&running, false);
+		return false;
+	}
+	return true;
+}
+
+void camera_thread_stop()
+{
+	if (atomic_exchange(&running, false)) {
+		pthread_join(capture_thread, NULL);
+	}
+}
+#endif
+
+// Camera Track: channel and target go into one word so the capture thread never sees half of a request
+void camera_track(int channel, point2 target)
+{
+	unsigned long long request = ((unsigned long long)(channel + 1) << 32)
+		| ((unsigned long long)(target.x & 0xffff) << 16) | (unsigned long long)(target.y & 0xffff);
+	atomic_store_explicit(&track_request, request, memory_order_relaxed);
+}
+
+void camera_track_stop()
+{
+	atomic_store_explicit(&track_request, 0, memory_order_relaxed);
+}
+
+void camera_latest(frame_snapshot *frame)
+{
+#if ROBOT_VIRTUAL_TIME
+	// No capture thread: take the frame here once the camera has one
+	if (atomic_load(&running) && (long)(systime() - next_capture) >= 0) {
+		capture(&captured);
+		next_capture = captured.time + CAMERA_VIRTUAL_PERIOD;
+	}
+#endif
+	while (true) {
+		unsigned int slot = atomic_load_explicit(&published_slot, memory_order_acquire);
+		unsigned int before = atomic_load_explicit(&slot_version[slot], memory_order_acquire);
+		if (before & 1) {
+			continue; // the writer lapped us and is filling this slot right now
+		}
+		*frame = slots[slot];
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&slot_version[slot], memory_order_relaxed) == before) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,42 @@
+/*
+Background camera capture for the pollinator robots.
+
+A capture thread calls camera_update() as fast as the camera delivers frames and publishes the blob results
+through a lock-free double buffer. The control loop copies the newest frame with "camera_latest" and never
+blocks on the camera; the sequence number tells it whether the frame is new since its last look.
+
+While searching, each frame first gets a sparse presence check and blobs are only extracted when something is in view.
+During centering and approach the control loop can switch the thread into tracking mode ("camera_track"), in which
+only a window around the target is processed until it is lost (needs CAMERA_USE_SEGMENTER, see camera-thread.c).
+
+Every frame carries up to SNAPSHOT_BLOBS objects per channel, largest first, so the proximity test can look at every
+flower in a cluttered frame and not just the largest one.
+*/
+
+#ifndef CAMERA_THREAD_H
+#define CAMERA_THREAD_H
+
+#include <kipr/wombat.h> // KIPR Wombat native library
+#include <stdbool.h>     // Boolean support
+
+#define SNAPSHOT_CHANNELS 2 // channel 0 is red, channel 1 is blue
+#define SNAPSHOT_BLOBS 8    // objects kept per channel (same as SEG_MAX_BLOBS)
+
+// One camera frame worth of blob results, published as a whole so readers never mix two frames
+typedef struct frame_snapshot {
+    unsigned long sequence;              // frame number, increases by one for every published frame (0 = no frame yet)
+    unsigned long time;                  // systime() when the frame was captured
+    int width, height;                   // camera resolution of the frame
+    int count[SNAPSHOT_CHANNELS];        // number of objects seen on each channel (may exceed SNAPSHOT_BLOBS)
+    rectangle bbox[SNAPSHOT_CHANNELS][SNAPSHOT_BLOBS];   // bounding boxes, index 0 is the largest object
+    point2 centroid[SNAPSHOT_CHANNELS][SNAPSHOT_BLOBS];  // centroids, index 0 is the largest object
+    int area[SNAPSHOT_CHANNELS][SNAPSHOT_BLOBS];         // areas, index 0 is the largest object
+} frame_snapshot;
+
+bool camera_thread_start();                 // start the capture thread (camera must already be open); false if it could not be started
+void camera_thread_stop();                  // stop the capture thread and wait for it to exit
+void camera_latest(frame_snapshot *frame);  // copy the newest published frame into "frame" without blocking
+void camera_track(int channel, point2 target); // follow this channel's object nearest "target" in a window around it
+void camera_track_stop();                   // go back to scanning the whole frame
+
+#endif
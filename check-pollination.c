@@ -0,0 +1,83 @@
+/*
+Check of the red/blue proximity test (pollination.h) against a plain all-pairs loop.
+
+Random red and blue centroids, including ones past the edges of the frame and with an unknown frame size (0 x 0),
+have to give the same pollinated flowers, nearest pollen and pairs as testing every red blob against every blue one.
+Exits 1 with the first disagreement.
+
+Build and run on any Linux box (from the top of the repository; make check runs it):
+    make check-pollination
+    build/check-pollination
+*/
+
+#include "pollination.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CASES 20000
+
+static int distance_sq(seg_point a, seg_point b)
+{
+	return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+// Reference: the all-pairs answer for one red blob; the number of blue blobs within the radius and the nearest one
+static int reference(seg_point red, const seg_point *blue, int blue_count, int radius, int *nearest)
+{
+	int pairs = 0, best_sq = 0;
+	*nearest = -1;
+	for (int b = 0; b < blue_count; b++) {
+		int squared = distance_sq(red, blue[b]);
+		if (squared < radius * radius) {
+			pairs++;
+			if (*nearest < 0 || squared < best_sq) {
+				*nearest = b;
+				best_sq = squared;
+			}
+		}
+	}
+	return pairs;
+}
+
+int main()
+{
+	static const int sizes[][2] = {{160, 120}, {320, 240}, {0, 0}, {40, 30}};
+	unsigned int seed = 1;
+	for (int test = 0; test < CASES; test++) {
+		int width = sizes[test % 4][0], height = sizes[test % 4][1];
+		int span_x = width ? width : 320, span_y = height ? height : 240; // where the points fall, frame or not
+		int radius = 5 + rand_r(&seed) % 60;
+		seg_point red[POLL_MAX_FLOWERS], blue[POLL_MAX_FLOWERS];
+		int red_count = rand_r(&seed) % (POLL_MAX_FLOWERS + 1), blue_count = rand_r(&seed) % (POLL_MAX_FLOWERS + 1);
+		// a quarter of the points lie up to half a frame past an edge
+		for (int i = 0; i < red_count + blue_count; i++) {
+			seg_point *point = i < red_count ? &red[i] : &blue[i - red_count];
+			bool outside = rand_r(&seed) % 4 == 0;
+			point->x = (short)(rand_r(&seed) % (outside ? 2 * span_x : span_x) - (outside ? span_x / 2 : 0));
+			point->y = (short)(rand_r(&seed) % (outside ? 2 * span_y : span_y) - (outside ? span_y / 2 : 0));
+		}
+
+		pollination_result result;
+		find_pollinated(red, red_count, blue, blue_count, radius, width, height, &result);
+		int pairs = 0;
+		for (int r = 0; r < red_count; r++) {
+			int nearest;
+			pairs += reference(red[r], blue, blue_count, radius, &nearest);
+			int found = result.nearest_blue[r];
+			// ties may go to either blue blob, so the nearest one is compared by its distance
+			if (result.pollinated[r] != (nearest >= 0) || (found >= 0) != (nearest >= 0)
+				|| (found >= 0 && distance_sq(red[r], blue[found]) != distance_sq(red[r], blue[nearest]))) {
+				fprintf(stderr, "case %d (%dx%d, radius %d): red %d at (%d, %d) has nearest blue %d, expected %d\n",
+						test, width, height, radius, r, red[r].x, red[r].y, found, nearest);
+				return 1;
+			}
+		}
+		if (result.pair_count != pairs) {
+			fprintf(stderr, "case %d (%dx%d, radius %d): %d pairs, expected %d\n", test, width, height, radius,
+					result.pair_count, pairs);
+			return 1;
+		}
+	}
+	printf("find_pollinated agrees with the all-pairs test on %d cases\n", CASES);
+	return 0;
+}
@@ -21,6 +21,10 @@ Revisions:	    Earlier version (2018) and revisions (2023) by Nick Livingston
 #include <kipr/wombat.h> // KIPR Wombat native library
 #include <stdlib.h>	 // library for general purpose functions
 #include <stdbool.h> // library for boolean support
+#include "arbiter.h" // picks the behavior that runs each tick
+#include "tuning.h"  // hierarchy overrides from tuning.cfg or the hierarchy optimizer
+#include "servo-cal.h" // calibrated wheel speed to servo position table
+#include "robot-clock.h" // sleeping until the next deadline instead of polling the timer
 
 // *** Define integer keys for each action type *** //
 #define SEEK_LIGHT_TYPE 0
@@ -31,6 +35,8 @@ Revisions:	    Earlier version (2018) and revisions (2023) by Nick Livingston
 #define ESCAPE_B_TYPE 5
 #define CRUISE_S_TYPE 6
 #define CRUISE_A_TYPE 7
+#define SEEK_RED_TYPE 8
+#define BEHAVIOR_TYPES 9
 
 // *** Define PIN Address *** //
 
@@ -49,6 +55,8 @@ Revisions:	    Earlier version (2018) and revisions (2023) by Nick Livingston
 #define RIGHT_MOTOR_PIN 0
 #define LEFT_MOTOR_PIN 1 // servos
 
+#define CAMERA_PERIOD 33 // ms between camera frames; the main loop never sleeps longer, so no frame goes unread
+
 // *** Define a new kind of variable type called "behavior" that contains properties for type (indexing definitions above), rank, and an active/inactive boolean *** //
 typedef struct behavior{
 	const char *title;
@@ -63,7 +71,7 @@ int compare_ranks(const void *a, const void *b)
 	bool is_active_a = ((struct behavior *)a)->is_active; 
 	bool is_active_b = ((struct behavior *)b)->is_active; 
 	if(is_active_a != is_active_b){
-		return is_active_b;
+		return is_active_a ? -1 : 1;
 	}
 	int rank_a = ((struct behavior *)a)->rank; 
 	int rank_b = ((struct behavior *)b)->rank;  
@@ -78,6 +86,14 @@ bool is_above_photo_differential(int threshold); // return true if the absolute
 bool is_front_bump();							 // return true if one of the front bumpers was hit
 bool is_back_bump();							 // return true if one of the back bumpers was hit
 bool timer_elapsed();							 // return true if our timer has elapsed
+bool is_avoid_triggered();						 // trigger for AVOID: IR above avoid_threshold
+bool is_approach_triggered();					 // trigger for APPROACH: IR above approach_threshold
+bool is_photo_triggered();						 // trigger for SEEK LIGHT/DARK: photo differential above photo_threshold
+bool is_red_seen();								 // trigger for SEEK RED: the camera sees a red object
+
+//ARBITRATION
+void compile_hierarchy(); // sort subsumption_hierarchy and rebuild the arbiter; call again whenever the hierarchy is edited
+void tune_hierarchy();    // apply "<behavior>_rank" and "<behavior>_active" overrides (see tuning.h) to subsumption_hierarchy
 
 //ACTIONS
 void escape_front();
@@ -88,13 +104,14 @@ void avoid();
 void approach();
 void cruise_straight();
 void cruise_arc();
+void seek_red();
 void stop();
 
 //MOTOR CONTROL
 void drive(float left, float right, float delay_seconds); //drive with a certain motor speed for a number of seconds
 
 //HELPER FUNCTIONS
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high); //remap a value from a source range to a new range
+void init_wheels(); //build the wheel table from this robot's calibration
 
 // BUILT-IN FUNCTIONS
 void enable_servo(int pin);						// enable servo at the specified pin
@@ -107,6 +124,8 @@ void set_servo_position(int pin, int position); // set a servo at the specified
 
 // global variables to store all current sensor values accessible to all functions and updated by the "read_sensors" function
 int right_photo_value, left_photo_value, right_ir_value, left_ir_value, front_bump_left_value, front_bump_center_value, front_bump_right_value, back_bump_left_value, back_bump_center_value, back_bump_right_value;
+int red_object_area; // bounding box area of the largest red object in the last camera update, 0 if none
+servo_table wheels; // servo position for every wheel speed, built by "init_wheels"
 
 // threshold values
 int avoid_threshold = 1600;	   // the absolute difference between IR readings has to be above this for the avoid action
@@ -126,6 +145,7 @@ struct behavior subsumption_hierarchy[] = {
 	{"ESCAPE FRONT", ESCAPE_F_TYPE, 0, false},
 	{"ESCAPE BACK", ESCAPE_B_TYPE, 0, false},
 	{"AVOID", AVOID_TYPE, 0, true},
+	{"SEEK RED", SEEK_RED_TYPE, 0, true},
 	{"SEEK LIGHT", SEEK_LIGHT_TYPE, 0, false},
 	{"CRUISE STRAIGHT", CRUISE_S_TYPE, 0, true},
 	{"SEEK DARK",  SEEK_DARK_TYPE, 0, false},
@@ -133,6 +153,7 @@ struct behavior subsumption_hierarchy[] = {
 	{"CRUISE ARC", CRUISE_A_TYPE, 0, false}
 };
 int hierarchy_length; //set in main function based on number of elements in subsumption_hierarchy defined above
+arbiter behavior_arbiter; //the hierarchy compiled into rank order, rebuilt only by compile_hierarchy()
 
 //==================================//
 //===============MAIN===============//
@@ -140,7 +161,24 @@ int hierarchy_length; //set in main function based on number of elements in subs
 int main() 
 {
 	hierarchy_length = sizeof(subsumption_hierarchy) / sizeof(behavior); //set this variable once for loopin trhough the hierarchy
+	for (int i = 0; i < hierarchy_length; i++) {
+		subsumption_hierarchy[i].rank = i; //the order of the array is the initial rank
+	}
+	tune_hierarchy(); //a tuned hierarchy (tuning.cfg, or a candidate from the evolve tool) replaces the order above
 	
+	arbiter_init(&behavior_arbiter); //what each behavior type checks and does
+	arbiter_define(&behavior_arbiter, ESCAPE_F_TYPE, is_front_bump, escape_front);
+	arbiter_define(&behavior_arbiter, ESCAPE_B_TYPE, is_back_bump, escape_back);
+	arbiter_define(&behavior_arbiter, AVOID_TYPE, is_avoid_triggered, avoid);
+	arbiter_define(&behavior_arbiter, SEEK_LIGHT_TYPE, is_photo_triggered, seek_light);
+	arbiter_define(&behavior_arbiter, SEEK_DARK_TYPE, is_photo_triggered, seek_dark);
+	arbiter_define(&behavior_arbiter, APPROACH_TYPE, is_approach_triggered, approach);
+	arbiter_define(&behavior_arbiter, CRUISE_S_TYPE, NULL, cruise_straight); //cruising always wants control
+	arbiter_define(&behavior_arbiter, CRUISE_A_TYPE, NULL, cruise_arc);
+	arbiter_define(&behavior_arbiter, SEEK_RED_TYPE, is_red_seen, seek_red);
+	compile_hierarchy();
+	
+	init_wheels();
 	enable_servo(LEFT_MOTOR_PIN);	//initialize both motors and set speed to zero
 	enable_servo(RIGHT_MOTOR_PIN);
 	drive(0.0,0.0,1.0);
@@ -149,21 +187,15 @@ int main()
     camera_open();
     
     while (true){
-        // get the bounding box of the largest object in
-        // channel 0 (the red channel)
-        rectangle object_bounding_box = get_object_bbox(0, 0);
-        if (object_bounding_box.width * object_bounding_box.height != 0){
-            printf("red object seen!");
-            
-           	cruise_straight();
-            msleep(100);
-            stop();
-            
+        // sleep until the current drive command ends, or until the next camera frame if that comes first
+        unsigned long deadline = start_time + timer_duration, next_frame = robot_time() + CAMERA_PERIOD;
+        robot_sleep_until((long)(next_frame - deadline) < 0 ? next_frame : deadline);
+
+        camera_update(); // update the camera
+        if (timer_elapsed()) {
+            read_sensors();
+            arbiter_run(&behavior_arbiter); //highest-ranked active behavior whose trigger holds
         }
-
-        // update the camera
-        camera_update();
-        msleep(10);
     }
 
     camera_close();  // cleanup the camera
@@ -228,6 +260,9 @@ void read_sensors()
 	back_bump_left_value = digital(BACK_BUMP_LEFT_PIN);	// read the bumper at BACK_BUMP_LEFT_PIN
 	back_bump_center_value = digital(BACK_BUMP_CENTER_PIN);  // read the bumper at BACK_BUMP_CENTER_PIN
 	back_bump_right_value = digital(BACK_BUMP_RIGHT_PIN);	// read the bumper at BACK_BUMP_RIGHT_PIN	
+	// the largest object in channel 0 (the red channel) as of the last camera update
+	rectangle object_bounding_box = get_object_bbox(0, 0);
+	red_object_area = object_bounding_box.width * object_bounding_box.height;
 }
 /******************************************************/
 bool is_above_photo_differential(int threshold)
@@ -253,6 +288,26 @@ bool is_back_bump()
 	return (back_bump_left_value == 1 || back_bump_center_value == 1 || back_bump_right_value == 1); // return true if one of the back bump values is 1, otherwise false
 }
 /******************************************************/
+bool is_avoid_triggered()
+{
+	return is_above_distance_threshold(avoid_threshold);
+}
+/******************************************************/
+bool is_approach_triggered()
+{
+	return is_above_distance_threshold(approach_threshold);
+}
+/******************************************************/
+bool is_photo_triggered()
+{
+	return is_above_photo_differential(photo_threshold);
+}
+/******************************************************/
+bool is_red_seen()
+{
+	return red_object_area != 0;
+}
+/******************************************************/
 
 //====================================//
 //===============ACTION===============//
@@ -261,17 +316,14 @@ bool is_back_bump()
 /******************************************************/
 void drive(float left, float right, float delay_seconds)
 {
-	// 850 is full motor speed clockwise, 1250 is full motor speed counterclockwise
-	// Servo is stopped from ~1044 to 1055
-
-	float left_speed = map(left, -1.0, 1.0, 0, 2047); // call the map function to map our speed (set between -1 and 1) to the appropriate range of motor values
-	float right_speed = map(right, -1.0, 1.0, 2047, 0);
+	int left_speed = (int)(left * SERVO_SPEED_MAX); // speed (set between -1 and 1) in per mille, looked up in the calibrated wheel table
+	int right_speed = (int)(right * SERVO_SPEED_MAX);
 
 	timer_duration = (int)(delay_seconds * 1000.0); // multiply our desired time in seconds by 1000 to get milliseconds and update this global variable
-	start_time = systime();							// update our start time to reflect the time we start driving (in ms)
+	start_time = robot_time();						// update our start time to reflect the time we start driving (in ms)
 
-	set_servo_position(LEFT_MOTOR_PIN, left_speed);
-	set_servo_position(RIGHT_MOTOR_PIN, right_speed); // set the servos to run at the mapped speed
+	set_servo_position(LEFT_MOTOR_PIN, servo_position(wheels.left, left_speed));
+	set_servo_position(RIGHT_MOTOR_PIN, servo_position(wheels.right, right_speed)); // set the servos to run at that speed
 }
 /******************************************************/
 void cruise_straight()
@@ -284,6 +336,11 @@ void cruise_arc()
 	drive(0.25, 0.4, 0.5);
 }
 /******************************************************/
+void seek_red()
+{
+	drive(0.50, 0.50, 0.1); //head for the red object; the next tick looks again
+}
+/******************************************************/
 void stop()
 {
 	drive(0.0, 0.0, 0.25);
@@ -360,17 +417,63 @@ void approach()
 	}
 }
 
+//=====================================//
+//=============ARBITRATION=============//
+//=====================================//
+
+void compile_hierarchy()
+{
+	int types[ARBITER_MAX_BEHAVIORS];
+	bool active[ARBITER_MAX_BEHAVIORS];
+	qsort(subsumption_hierarchy, hierarchy_length, sizeof(behavior), compare_ranks); //active behaviors first, by rank
+	for (int i = 0; i < hierarchy_length && i < ARBITER_MAX_BEHAVIORS; i++) {
+		types[i] = subsumption_hierarchy[i].type;
+		active[i] = subsumption_hierarchy[i].is_active;
+	}
+	arbiter_compile(&behavior_arbiter, types, active, hierarchy_length);
+}
+
+/******************************************************/
+void tune_hierarchy()
+{
+	//tuning keys by behavior type (SEEK_LIGHT_TYPE .. SEEK_RED_TYPE)
+	static const char *keys[BEHAVIOR_TYPES] = {"seek_light", "seek_dark", "approach", "avoid", "escape_front",
+											   "escape_back", "cruise_straight", "cruise_arc", "seek_red"};
+	static char names[2 * BEHAVIOR_TYPES][32];
+	tuning_param params[2 * BEHAVIOR_TYPES];
+	int rank[BEHAVIOR_TYPES], active[BEHAVIOR_TYPES];
+	for (int type = 0; type < BEHAVIOR_TYPES; type++) {
+		snprintf(names[2 * type], sizeof(names[0]), "%s_rank", keys[type]);
+		snprintf(names[2 * type + 1], sizeof(names[0]), "%s_active", keys[type]);
+		params[2 * type] = (tuning_param){names[2 * type], &rank[type]};
+		params[2 * type + 1] = (tuning_param){names[2 * type + 1], &active[type]};
+	}
+	for (int i = 0; i < hierarchy_length; i++) {
+		rank[subsumption_hierarchy[i].type] = subsumption_hierarchy[i].rank;
+		active[subsumption_hierarchy[i].type] = subsumption_hierarchy[i].is_active;
+	}
+	if (tuning_load(params, 2 * BEHAVIOR_TYPES) == 0) {
+		return;
+	}
+	for (int i = 0; i < hierarchy_length; i++) {
+		subsumption_hierarchy[i].rank = rank[subsumption_hierarchy[i].type];
+		subsumption_hierarchy[i].is_active = active[subsumption_hierarchy[i].type] != 0;
+	}
+}
+
 //=====================================//
 //===============HELPERS===============//
 //=====================================//
 
 bool timer_elapsed()
 {
-	return (systime() > (start_time + timer_duration)); // return true if the current time is greater than our start time plus timer duration
+	return (long)(robot_time() - (start_time + timer_duration)) >= 0; // return true once the current time reaches our start time plus timer duration
 }
 /******************************************************/
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high)
+void init_wheels()
 {
-	return target_range_low + ((value - start_range_low) / (start_range_high - start_range_low)) * (target_range_high - target_range_low);
-	// remap a value from a source range to a new range
+	servo_calibration calibration;
+	servo_cal_default(&calibration);
+	servo_cal_load(&calibration, SERVO_CAL_FILE); // this robot's own servos, if it has been calibrated
+	servo_cal_build(&wheels, &calibration);
 }
\ No newline at end of file
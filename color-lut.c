@@ -0,0 +1,261 @@
+/*
+RGB to color-channel lookup table (see color-lut.h).
+
+A cell covers 8x8x8 RGB values. When a table is built from thresholds, each cell gets the channels that at least half
+of a 4x4x4 sample of its values belong to, so the table disagrees with the thresholds only on the few pixels whose
+cell straddles a class boundary.
+*/
+
+#include "color-lut.h"
+#include <ctype.h>      // isspace
+#include <fcntl.h>      // open
+#include <stdio.h>      // FILE
+#include <stdlib.h>     // atoi
+#include <string.h>     // memset, strncmp
+#include <sys/mman.h>   // mmap
+#include <unistd.h>     // close
+
+#define CELL_SAMPLES 4   // samples per component inside a cell when building from thresholds
+
+//=====================================//
+//==============BUILDING===============//
+//=====================================//
+
+void lut_rgb_to_hsv(const unsigned char rgb[3], unsigned char hsv[3])
+{
+	int r = rgb[0], g = rgb[1], b = rgb[2];
+	int max = r > g ? (r > b ? r : b) : (g > b ? g : b);
+	int min = r < g ? (r < b ? r : b) : (g < b ? g : b);
+	int delta = max - min;
+	int hue = 0;
+	if (delta > 0) {
+		if (max == r) {
+			hue = 60 * (g - b) / delta;
+		} else if (max == g) {
+			hue = 120 + 60 * (b - r) / delta;
+		} else {
+			hue = 240 + 60 * (r - g) / delta;
+		}
+		if (hue < 0) {
+			hue += 360;
+		}
+	}
+	hsv[0] = (unsigned char)(hue / 2);
+	hsv[1] = (unsigned char)(max > 0 ? (255 * delta + max / 2) / max : 0);
+	hsv[2] = (unsigned char)max;
+}
+
+// In HSV Range: the test the KIPR camera library does for an HSV channel
+static bool in_hsv_range(const lut_hsv_range *range, const unsigned char hsv[3])
+{
+	for (int k = 1; k < 3; k++) {
+		if (hsv[k] < range->bottom[k] || hsv[k] > range->top[k]) {
+			return false;
+		}
+	}
+	if (range->bottom[0] <= range->top[0]) {
+		return hsv[0] >= range->bottom[0] && hsv[0] <= range->top[0];
+	}
+	return hsv[0] >= range->bottom[0] || hsv[0] <= range->top[0]; // wraps around through red
+}
+
+// Build: fill every cell from "channels" membership tests on a sample of the cell's RGB values
+static void build(unsigned char *lut, int channels, bool (*test)(const void *classes, int channel, const unsigned char rgb[3]),
+				  const void *classes)
+{
+	for (int cell = 0; cell < LUT_SIZE; cell++) {
+		int base[3] = {(cell >> 10) << 3, ((cell >> 5) & 31) << 3, (cell & 31) << 3};
+		int hits[SEG_MAX_CHANNELS] = {0};
+		for (int i = 0; i < CELL_SAMPLES * CELL_SAMPLES * CELL_SAMPLES; i++) {
+			unsigned char rgb[3] = {
+				(unsigned char)(base[0] + 1 + 2 * (i / (CELL_SAMPLES * CELL_SAMPLES))),
+				(unsigned char)(base[1] + 1 + 2 * (i / CELL_SAMPLES % CELL_SAMPLES)),
+				(unsigned char)(base[2] + 1 + 2 * (i % CELL_SAMPLES))};
+			for (int channel = 0; channel < channels; channel++) {
+				hits[channel] += test(classes, channel, rgb);
+			}
+		}
+		unsigned char bits = 0;
+		for (int channel = 0; channel < channels; channel++) {
+			if (2 * hits[channel] >= CELL_SAMPLES * CELL_SAMPLES * CELL_SAMPLES) {
+				bits |= 1 << channel;
+			}
+		}
+		lut[cell] = bits;
+	}
+}
+
+static bool color_test(const void *classes, int channel, const unsigned char rgb[3])
+{
+	return seg_color_matches(&((const seg_color *)classes)[channel], rgb);
+}
+
+bool lut_hsv_matches(const lut_hsv_range *range, const unsigned char rgb[3])
+{
+	unsigned char hsv[3];
+	lut_rgb_to_hsv(rgb, hsv);
+	return in_hsv_range(range, hsv);
+}
+
+static bool hsv_test(const void *classes, int channel, const unsigned char rgb[3])
+{
+	return lut_hsv_matches(&((const lut_hsv_range *)classes)[channel], rgb);
+}
+
+void lut_from_colors(unsigned char *lut, const seg_color *colors, int channels)
+{
+	build(lut, channels, color_test, colors);
+}
+
+void lut_from_hsv(unsigned char *lut, const lut_hsv_range *ranges, int channels)
+{
+	build(lut, channels, hsv_test, ranges);
+}
+
+// Read Blockz: blockz.conf is a KIPR camera config, key=value lines under [group] headers; each HSV channel has
+// the keys th, ts, tv (top) and bh, bs, bv (bottom) in a group or key path containing "channel_<n>"
+int lut_read_blockz(const char *path, lut_hsv_range *ranges, int max_channels)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		return -1;
+	}
+	memset(ranges, 0, max_channels * sizeof(lut_hsv_range));
+	int channels = 0;
+	char group[128] = "";
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+		char *text = line;
+		while (isspace((unsigned char)*text)) {
+			text++;
+		}
+		if (*text == '[') {
+			sscanf(text, "[%127[^]]", group);
+			continue;
+		}
+		char key[128];
+		int value;
+		if (sscanf(text, "%127[^=]=%d", key, &value) != 2) {
+			continue;
+		}
+		for (int end = (int)strlen(key) - 1; end >= 0 && isspace((unsigned char)key[end]); end--) {
+			key[end] = '\0';
+		}
+		char full[256];
+		snprintf(full, sizeof(full), "%s/%s", group, key);
+		char *channel_key = strstr(full, "channel_");
+		char *name = strrchr(full, '/');
+		if (!channel_key || !name) {
+			continue;
+		}
+		int channel = atoi(channel_key + strlen("channel_"));
+		name++;
+		const char *components = "hsv";
+		const char *component = strlen(name) == 2 ? strchr(components, name[1]) : NULL;
+		if (channel < 0 || channel >= max_channels || (name[0] != 't' && name[0] != 'b') || !component) {
+			continue;
+		}
+		unsigned char *bound = name[0] == 't' ? ranges[channel].top : ranges[channel].bottom;
+		bound[component - components] = (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+		if (channel + 1 > channels) {
+			channels = channel + 1;
+		}
+	}
+	fclose(file);
+	return channels;
+}
+
+//=====================================//
+//=============CALIBRATION=============//
+//=====================================//
+
+void lut_votes_init(lut_votes *votes, int channels)
+{
+	memset(votes, 0, sizeof(*votes));
+	votes->channels = channels;
+}
+
+void lut_votes_add(lut_votes *votes, const unsigned char *bgr, const unsigned char *labels, int pixels)
+{
+	for (int i = 0; i < pixels; i++) {
+		int label = labels[i];
+		if (label > votes->channels) {
+			continue; // unlabelled
+		}
+		const unsigned char *px = bgr + 3 * i;
+		unsigned short *count = &votes->counts[LUT_INDEX(px[2], px[1], px[0])][label];
+		if (*count < 65535) {
+			(*count)++;
+		}
+	}
+}
+
+void lut_from_votes(unsigned char *lut, const lut_votes *votes, int min_samples, int min_share)
+{
+	for (int cell = 0; cell < LUT_SIZE; cell++) {
+		int total = 0;
+		for (int label = 0; label <= votes->channels; label++) {
+			total += votes->counts[cell][label];
+		}
+		if (total < min_samples || total == 0) {
+			continue;
+		}
+		unsigned char bits = 0;
+		for (int channel = 0; channel < votes->channels; channel++) {
+			if (100 * votes->counts[cell][channel + 1] >= min_share * total) {
+				bits |= 1 << channel;
+			}
+		}
+		lut[cell] = bits;
+	}
+}
+
+//=====================================//
+//================FILES================//
+//=====================================//
+
+bool lut_save(const char *path, const unsigned char *lut, int channels)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+	lut_header header;
+	memcpy(header.magic, LUT_MAGIC, 4);
+	header.version = LUT_VERSION;
+	header.bits = LUT_BITS;
+	header.channels = channels;
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(lut, LUT_SIZE, 1, file) == 1;
+	return fclose(file) == 0 && ok;
+}
+
+const unsigned char *lut_map(const char *path, int *channels)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	size_t length = sizeof(lut_header) + LUT_SIZE;
+	off_t size = lseek(fd, 0, SEEK_END);
+	void *base = size == (off_t)length ? mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd); // the mapping stays valid
+	if (base == MAP_FAILED) {
+		return NULL;
+	}
+	const lut_header *header = base;
+	if (memcmp(header->magic, LUT_MAGIC, 4) != 0 || header->version != LUT_VERSION || header->bits != LUT_BITS) {
+		munmap(base, length);
+		return NULL;
+	}
+	if (channels) {
+		*channels = (int)header->channels;
+	}
+	return (const unsigned char *)base + sizeof(lut_header);
+}
+
+void lut_unmap(const unsigned char *lut)
+{
+	if (lut) {
+		munmap((void *)(lut - sizeof(lut_header)), sizeof(lut_header) + LUT_SIZE);
+	}
+}
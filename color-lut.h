@@ -0,0 +1,66 @@
+/*
+RGB to color-channel lookup table for the pollinator robots.
+
+Every pixel is quantized to 5 bits per component and looked up in a 32x32x32 byte table whose bit c is set when that
+RGB cell belongs to channel c, so classifying a pixel is one table load whatever the color classes look like (HSV
+ranges with hue wrap-around, RGB boxes, shapes learned from calibration frames). The table is 32 KiB and fits in L1.
+
+Tables are built off the robot by lut-build (from blockz.conf, the default thresholds or labelled calibration
+frames), saved as a small header plus the raw table, and memory-mapped by the robot at startup.
+*/
+
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include "color-segment.h" // seg_color, SEG_MAX_CHANNELS
+#include <stdbool.h>       // Boolean support
+
+#define LUT_BITS 5                        // bits kept per color component
+#define LUT_SIZE (1 << (3 * LUT_BITS))    // table entries, one byte each
+#define LUT_INDEX(r, g, b) ((((r) >> 3) << 10) | (((g) >> 3) << 5) | ((b) >> 3))
+#define LUT_MAGIC "PLUT"
+#define LUT_VERSION 1
+
+// An HSV range as in blockz.conf: OpenCV scale, hue 0-179, saturation and value 0-255. When the bottom hue is above
+// the top hue the range wraps around through red.
+typedef struct lut_hsv_range {
+	unsigned char bottom[3];  // h, s, v
+	unsigned char top[3];
+} lut_hsv_range;
+
+// File layout: this header, then LUT_SIZE table bytes
+typedef struct lut_header {
+	char magic[4];
+	unsigned int version;
+	unsigned int bits;        // LUT_BITS
+	unsigned int channels;    // channels with a bit in the table
+} lut_header;
+
+// Votes from calibration frames: how many labelled pixels fell into each cell, per channel plus background
+typedef struct lut_votes {
+	int channels;
+	unsigned short counts[LUT_SIZE][SEG_MAX_CHANNELS + 1]; // [cell][0] is background, [cell][c + 1] is channel c
+} lut_votes;
+
+// BUILDING
+void lut_from_colors(unsigned char *lut, const seg_color *colors, int channels);    // same classes as the kernels
+void lut_from_hsv(unsigned char *lut, const lut_hsv_range *ranges, int channels);
+int lut_read_blockz(const char *path, lut_hsv_range *ranges, int max_channels);     // channels read, -1 on error
+
+// CALIBRATION
+void lut_votes_init(lut_votes *votes, int channels);
+// Add: count the pixels of a BGR frame; labels holds 0 for background and c + 1 for channel c, 255 for unlabelled
+void lut_votes_add(lut_votes *votes, const unsigned char *bgr, const unsigned char *labels, int pixels);
+// From Votes: cells with at least "min_samples" votes get the channels holding at least "min_share" percent of them;
+// cells with fewer votes keep what "lut" already has (a table built from blockz.conf or the thresholds)
+void lut_from_votes(unsigned char *lut, const lut_votes *votes, int min_samples, int min_share);
+
+// FILES
+bool lut_save(const char *path, const unsigned char *lut, int channels);
+const unsigned char *lut_map(const char *path, int *channels);  // map a saved table read-only; NULL on error
+void lut_unmap(const unsigned char *lut);
+
+void lut_rgb_to_hsv(const unsigned char rgb[3], unsigned char hsv[3]);  // OpenCV's 8-bit conversion
+bool lut_hsv_matches(const lut_hsv_range *range, const unsigned char rgb[3]); // per-pixel HSV test, what the table replaces
+
+#endif
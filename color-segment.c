@@ -0,0 +1,654 @@
+/*
+Color segmentation for the pollinator robots (see color-segment.h).
+
+The classify kernels work on 16 pixels at a time. A pixel belongs to a channel when every component lies inside the
+channel's box and the dominant component beats both others by at least the margin. Every test is an unsigned byte
+compare, so SSE2 and NEON do it without widening:
+    x >= lo   <=>   max(x, lo) == x
+    x <= hi   <=>   min(x, hi) == x
+    d - o >= margin (clamped at 0)   <=>   saturating_sub(d, o) >= margin
+*/
+
+#include "color-segment.h"
+#include "blob-label.h" // run-length connected components
+#include "color-lut.h"  // LUT_INDEX
+#include <math.h>   // sqrt
+#include <stdlib.h> // malloc, free
+#include <string.h> // memset
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define SEG_KERNEL "sse2"
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SEG_KERNEL "neon"
+#else
+#define SEG_KERNEL "scalar"
+#endif
+
+//=====================================//
+//===============SETUP=================//
+//=====================================//
+
+bool seg_init(segmenter *seg, int width, int height)
+{
+	memset(seg, 0, sizeof(*seg));
+	seg->width = width;
+	seg->height = height;
+	seg->min_area = SEG_MIN_AREA;
+
+	int pixels = width * height;
+	seg->r = malloc(pixels);
+	seg->g = malloc(pixels);
+	seg->b = malloc(pixels);
+	seg->mask = calloc(pixels, 1);
+	seg->stack = malloc(pixels * sizeof(int));
+	seg->visited = malloc(pixels);
+	seg->samples = calloc((size_t)3 * (width + 31), 1);
+	seg->labeller = malloc(sizeof(blob_labeller));
+	if (seg->labeller && !blob_labeller_init(seg->labeller, width, height)) {
+		free(seg->labeller);
+		seg->labeller = NULL;
+	}
+	if (!seg->r || !seg->g || !seg->b || !seg->mask || !seg->stack || !seg->visited || !seg->samples || !seg->labeller) {
+		seg_free(seg);
+		return false;
+	}
+	return true;
+}
+
+void seg_free(segmenter *seg)
+{
+	free(seg->r);
+	free(seg->g);
+	free(seg->b);
+	free(seg->mask);
+	free(seg->stack);
+	free(seg->visited);
+	free(seg->samples);
+	if (seg->labeller) {
+		blob_labeller_free(seg->labeller);
+		free(seg->labeller);
+	}
+	seg->r = seg->g = seg->b = seg->mask = seg->visited = seg->samples = NULL;
+	seg->stack = NULL;
+	seg->labeller = NULL;
+}
+
+void seg_set_color(segmenter *seg, int channel, seg_color color)
+{
+	seg->colors[channel] = color;
+	if (channel >= seg->channel_count) {
+		seg->channel_count = channel + 1;
+	}
+}
+
+void seg_default_colors(segmenter *seg)
+{
+	seg_color red = {{110, 0, 0}, {255, 255, 255}, 0, 50};  // strongly red: R at least 50 above G and B
+	seg_color blue = {{0, 0, 80}, {255, 255, 255}, 2, 40};  // strongly blue: B at least 40 above R and G
+	seg_set_color(seg, 0, red);
+	seg_set_color(seg, 1, blue);
+}
+
+void seg_set_lut(segmenter *seg, const unsigned char *lut, int channels)
+{
+	seg->lut = lut;
+	if (lut && channels > seg->channel_count) {
+		seg->channel_count = channels < SEG_MAX_CHANNELS ? channels : SEG_MAX_CHANNELS;
+	}
+}
+
+//=====================================//
+//==============PIPELINE===============//
+//=====================================//
+
+// Load Span: deinterleave pixels [start, end) of a BGR frame into the planes
+static void load_span(segmenter *seg, const unsigned char *bgr, int start, int end)
+{
+	int i = start;
+#if defined(__ARM_NEON)
+	for (; i + 16 <= end; i += 16) {
+		uint8x16x3_t px = vld3q_u8(bgr + 3 * i); // loads and deinterleaves 16 pixels
+		vst1q_u8(seg->b + i, px.val[0]);
+		vst1q_u8(seg->g + i, px.val[1]);
+		vst1q_u8(seg->r + i, px.val[2]);
+	}
+#endif
+	for (; i < end; i++) {
+		seg->b[i] = bgr[3 * i];
+		seg->g[i] = bgr[3 * i + 1];
+		seg->r[i] = bgr[3 * i + 2];
+	}
+}
+
+void seg_load_bgr(segmenter *seg, const unsigned char *bgr)
+{
+	load_span(seg, bgr, 0, seg->width * seg->height);
+}
+
+// Matches: true if one pixel belongs to the color class (the scalar version of the vector test, evaluated without
+// branches because background pixels land on either side of the thresholds at random)
+static inline bool matches(const seg_color *color, const unsigned char rgb[3])
+{
+	int ok = 1;
+	for (int k = 0; k < 3; k++) {
+		ok &= (rgb[k] >= color->min[k]) & (rgb[k] <= color->max[k]);
+	}
+	static const int next[3] = {1, 2, 0};
+	int dominant = rgb[color->dominant];
+	int lead1 = dominant - rgb[next[color->dominant]];
+	int lead2 = dominant - rgb[next[next[color->dominant]]];
+	// a negative lead counts as 0, so a margin of 0 accepts any pixel inside the box
+	ok &= ((lead1 > 0 ? lead1 : 0) >= color->margin) & ((lead2 > 0 ? lead2 : 0) >= color->margin);
+	return ok;
+}
+
+bool seg_color_matches(const seg_color *color, const unsigned char rgb[3])
+{
+	return matches(color, rgb);
+}
+
+// Classify Range: scalar kernel for pixels [start, end)
+static void classify_range(segmenter *seg, int channel, int start, int end)
+{
+	const seg_color *color = &seg->colors[channel];
+	unsigned char bit = 1 << channel;
+	for (int i = start; i < end; i++) {
+		unsigned char rgb[3] = {seg->r[i], seg->g[i], seg->b[i]};
+		if (matches(color, rgb)) {
+			seg->mask[i] |= bit;
+		} else {
+			seg->mask[i] &= ~bit;
+		}
+	}
+}
+
+void seg_classify_scalar(segmenter *seg, int channel)
+{
+	classify_range(seg, channel, 0, seg->width * seg->height);
+}
+
+#if defined(__SSE2__)
+typedef __m128i vec;
+static inline vec vec_load(const unsigned char *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void vec_store(unsigned char *p, vec v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline vec vec_dup(unsigned char x) { return _mm_set1_epi8((char)x); }
+static inline vec vec_and(vec a, vec b) { return _mm_and_si128(a, b); }
+static inline vec vec_or(vec a, vec b) { return _mm_or_si128(a, b); }
+static inline vec vec_clear(vec a, vec bits) { return _mm_andnot_si128(bits, a); }
+static inline vec vec_ge(vec a, vec b) { return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a); }
+static inline vec vec_le(vec a, vec b) { return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a); }
+static inline vec vec_subs(vec a, vec b) { return _mm_subs_epu8(a, b); }
+#define SEG_VECTOR 1
+#elif defined(__ARM_NEON)
+typedef uint8x16_t vec;
+static inline vec vec_load(const unsigned char *p) { return vld1q_u8(p); }
+static inline void vec_store(unsigned char *p, vec v) { vst1q_u8(p, v); }
+static inline vec vec_dup(unsigned char x) { return vdupq_n_u8(x); }
+static inline vec vec_and(vec a, vec b) { return vandq_u8(a, b); }
+static inline vec vec_or(vec a, vec b) { return vorrq_u8(a, b); }
+static inline vec vec_clear(vec a, vec bits) { return vbicq_u8(a, bits); }
+static inline vec vec_ge(vec a, vec b) { return vcgeq_u8(a, b); }
+static inline vec vec_le(vec a, vec b) { return vcleq_u8(a, b); }
+static inline vec vec_subs(vec a, vec b) { return vqsubq_u8(a, b); }
+#define SEG_VECTOR 1
+#else
+#define SEG_VECTOR 0
+#endif
+
+#if SEG_VECTOR
+// Vector Color: one channel's thresholds broadcast to all 16 lanes
+typedef struct vector_color {
+	vec min[3], max[3];
+	vec margin;
+	vec bit;
+	int dominant, other1, other2;
+} vector_color;
+
+static void prepare(const seg_color *color, int channel, vector_color *v)
+{
+	static const int next[3] = {1, 2, 0};
+	for (int k = 0; k < 3; k++) {
+		v->min[k] = vec_dup(color->min[k]);
+		v->max[k] = vec_dup(color->max[k]);
+	}
+	v->margin = vec_dup(color->margin);
+	v->bit = vec_dup(1 << channel);
+	v->dominant = color->dominant;
+	v->other1 = next[color->dominant];
+	v->other2 = next[next[color->dominant]];
+}
+
+// Vector Matches: all ones in every lane whose pixel belongs to the channel
+static inline vec vector_matches(const vector_color *v, const vec rgb[3])
+{
+	vec ok = vec_and(vec_ge(rgb[0], v->min[0]), vec_le(rgb[0], v->max[0]));
+	ok = vec_and(ok, vec_and(vec_ge(rgb[1], v->min[1]), vec_le(rgb[1], v->max[1])));
+	ok = vec_and(ok, vec_and(vec_ge(rgb[2], v->min[2]), vec_le(rgb[2], v->max[2])));
+	ok = vec_and(ok, vec_ge(vec_subs(rgb[v->dominant], rgb[v->other1]), v->margin));
+	ok = vec_and(ok, vec_ge(vec_subs(rgb[v->dominant], rgb[v->other2]), v->margin));
+	return ok;
+}
+#endif
+
+// Classify Span: vector kernel for pixels [start, end), scalar for whatever does not fill a whole vector
+static void classify_span(segmenter *seg, int channel, int start, int end)
+{
+	int i = start;
+#if SEG_VECTOR
+	vector_color v;
+	prepare(&seg->colors[channel], channel, &v);
+	for (; i + 16 <= end; i += 16) {
+		vec rgb[3] = {vec_load(seg->r + i), vec_load(seg->g + i), vec_load(seg->b + i)};
+		vec m = vec_load(seg->mask + i);
+		vec_store(seg->mask + i, vec_or(vec_clear(m, v.bit), vec_and(vector_matches(&v, rgb), v.bit)));
+	}
+#endif
+	classify_range(seg, channel, i, end); // leftover pixels (or everything without SIMD)
+}
+
+void seg_classify(segmenter *seg, int channel)
+{
+	classify_span(seg, channel, 0, seg->width * seg->height);
+}
+
+#if SEG_VECTOR
+// Vector Classify All: mask byte for 16 pixels, one bit per channel
+static inline vec vector_classify_all(const vector_color *v, int channels, const vec rgb[3])
+{
+	vec m = vec_dup(0);
+	for (int channel = 0; channel < channels; channel++) {
+		m = vec_or(m, vec_and(vector_matches(&v[channel], rgb), v[channel].bit));
+	}
+	return m;
+}
+#endif
+
+#if defined(__SSE2__)
+// Deinterleave SSE2: split 32 BGR pixels (96 bytes) into two vectors per component. Five rounds of interleaving the
+// first, second and third pairs of 16-byte registers sort every third byte into its own pair of registers.
+static inline void deinterleave_sse2(const unsigned char *src, vec b[2], vec g[2], vec r[2])
+{
+	vec v0 = vec_load(src), v1 = vec_load(src + 16), v2 = vec_load(src + 32);
+	vec v3 = vec_load(src + 48), v4 = vec_load(src + 64), v5 = vec_load(src + 80);
+	for (int round = 0; round < 5; round++) {
+		vec a0 = _mm_unpacklo_epi8(v0, v3), a1 = _mm_unpackhi_epi8(v0, v3);
+		vec a2 = _mm_unpacklo_epi8(v1, v4), a3 = _mm_unpackhi_epi8(v1, v4);
+		vec a4 = _mm_unpacklo_epi8(v2, v5), a5 = _mm_unpackhi_epi8(v2, v5);
+		v0 = a0; v1 = a1; v2 = a2; v3 = a3; v4 = a4; v5 = a5;
+	}
+	b[0] = v0; b[1] = v1;
+	g[0] = v2; g[1] = v3;
+	r[0] = v4; r[1] = v5;
+}
+#endif
+
+// Fused Span: classify pixels [start, end) of a BGR frame into every channel in one pass. Pixels are deinterleaved
+// straight into registers (NEON vld3, SSE2 unpack rounds), tested against all channels while they are there, and each
+// mask byte is written once, to mask[i]; the full-size planes are never touched.
+static void fused_span(segmenter *seg, const unsigned char *bgr, unsigned char *mask, int start, int end)
+{
+	int channels = seg->channel_count;
+	int i = start;
+	if (seg->lut) {
+		// one table load per pixel decides every channel at once
+		const unsigned char *lut = seg->lut;
+#if defined(__SSE2__)
+		// the table indices are computed 32 pixels at a time, only the loads themselves stay scalar
+		const vec zero = _mm_setzero_si128();
+		const vec top5 = vec_dup(0xf8);
+		for (; i + 32 <= end; i += 32) {
+			vec b[2], g[2], r[2];
+			deinterleave_sse2(bgr + 3 * i, b, g, r);
+			unsigned short index[32];
+			for (int half = 0; half < 2; half++) {
+				vec rq = vec_and(r[half], top5), gq = vec_and(g[half], top5);
+				vec bq = _mm_srli_epi16(vec_and(b[half], top5), 3);
+				vec lo = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_unpacklo_epi8(rq, zero), 7),
+					_mm_slli_epi16(_mm_unpacklo_epi8(gq, zero), 2)), _mm_unpacklo_epi8(bq, zero));
+				vec hi = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(_mm_unpackhi_epi8(rq, zero), 7),
+					_mm_slli_epi16(_mm_unpackhi_epi8(gq, zero), 2)), _mm_unpackhi_epi8(bq, zero));
+				_mm_storeu_si128((__m128i *)(index + 16 * half), lo);
+				_mm_storeu_si128((__m128i *)(index + 16 * half + 8), hi);
+			}
+			for (int k = 0; k < 32; k++) {
+				mask[i + k] = lut[index[k]];
+			}
+		}
+#endif
+		for (; i < end; i++) {
+			const unsigned char *px = bgr + 3 * i;
+			mask[i] = lut[LUT_INDEX(px[2], px[1], px[0])];
+		}
+		return;
+	}
+#if SEG_VECTOR
+	vector_color v[SEG_MAX_CHANNELS];
+	for (int channel = 0; channel < channels; channel++) {
+		prepare(&seg->colors[channel], channel, &v[channel]);
+	}
+#if defined(__SSE2__)
+	for (; i + 32 <= end; i += 32) {
+		vec b[2], g[2], r[2];
+		deinterleave_sse2(bgr + 3 * i, b, g, r);
+		vec first[3] = {r[0], g[0], b[0]};
+		vec second[3] = {r[1], g[1], b[1]};
+		vec_store(mask + i, vector_classify_all(v, channels, first));
+		vec_store(mask + i + 16, vector_classify_all(v, channels, second));
+	}
+#else
+	for (; i + 16 <= end; i += 16) {
+		uint8x16x3_t px = vld3q_u8(bgr + 3 * i);
+		vec rgb[3] = {px.val[2], px.val[1], px.val[0]};
+		vec_store(mask + i, vector_classify_all(v, channels, rgb));
+	}
+#endif
+#endif
+	for (; i < end; i++) {
+		const unsigned char *px = bgr + 3 * i;
+		unsigned char rgb[3] = {px[2], px[1], px[0]};
+		unsigned char m = 0;
+		for (int channel = 0; channel < channels; channel++) {
+			m |= matches(&seg->colors[channel], rgb) << channel;
+		}
+		mask[i] = m;
+	}
+}
+
+void seg_classify_all(segmenter *seg, const unsigned char *bgr)
+{
+	fused_span(seg, bgr, seg->mask, 0, seg->width * seg->height);
+}
+
+void seg_keep_blob(seg_channel *result, const seg_blob *blob)
+{
+	int kept = result->count < SEG_MAX_BLOBS ? result->count : SEG_MAX_BLOBS;
+	result->count++;
+	if (kept == SEG_MAX_BLOBS && blob->area <= result->blobs[SEG_MAX_BLOBS - 1].area) {
+		return; // smaller than everything we keep
+	}
+	int slot = kept < SEG_MAX_BLOBS ? kept : SEG_MAX_BLOBS - 1;
+	while (slot > 0 && result->blobs[slot - 1].area < blob->area) {
+		result->blobs[slot] = result->blobs[slot - 1];
+		slot--;
+	}
+	result->blobs[slot] = *blob;
+}
+
+void seg_find_blobs(segmenter *seg, int channel)
+{
+	blob_label(seg->labeller, seg->mask, 1 << channel, seg->min_area, &seg->channels[channel]);
+}
+
+// Find Blobs Flood: 4-connected flood fill over the channel's mask bit, kept as the reference for the labeller
+void seg_find_blobs_flood(segmenter *seg, int channel)
+{
+	int width = seg->width;
+	int pixels = width * seg->height;
+	unsigned char bit = 1 << channel;
+	seg_channel *result = &seg->channels[channel];
+
+	result->count = 0;
+	memset(seg->visited, 0, pixels);
+
+	for (int start = 0; start < pixels; start++) {
+		if (!(seg->mask[start] & bit) || seg->visited[start]) {
+			continue;
+		}
+		int top = 0;
+		int area = 0;
+		long sum_x = 0, sum_y = 0;
+		int min_x = width, min_y = seg->height, max_x = -1, max_y = -1;
+
+		seg->stack[top++] = start;
+		seg->visited[start] = 1;
+		while (top > 0) {
+			int p = seg->stack[--top];
+			int x = p % width;
+			int y = p / width;
+			area++;
+			sum_x += x;
+			sum_y += y;
+			if (x < min_x) min_x = x;
+			if (x > max_x) max_x = x;
+			if (y < min_y) min_y = y;
+			if (y > max_y) max_y = y;
+
+			int neighbors[4] = {x > 0 ? p - 1 : -1, x < width - 1 ? p + 1 : -1, p - width, p + width};
+			for (int n = 0; n < 4; n++) {
+				int q = neighbors[n];
+				if (q >= 0 && q < pixels && (seg->mask[q] & bit) && !seg->visited[q]) {
+					seg->visited[q] = 1;
+					seg->stack[top++] = q;
+				}
+			}
+		}
+
+		if (area >= seg->min_area) {
+			seg_blob blob;
+			blob.area = area;
+			blob.bbox.ulx = min_x;
+			blob.bbox.uly = min_y;
+			blob.bbox.width = max_x - min_x + 1;
+			blob.bbox.height = max_y - min_y + 1;
+			blob.centroid.x = (int)(sum_x / area);
+			blob.centroid.y = (int)(sum_y / area);
+			seg_keep_blob(result, &blob);
+		}
+	}
+}
+
+void seg_process(segmenter *seg, const unsigned char *bgr)
+{
+	seg_classify_all(seg, bgr);
+	for (int channel = 0; channel < seg->channel_count; channel++) {
+		seg_find_blobs(seg, channel);
+	}
+}
+
+void seg_process_window(segmenter *seg, const unsigned char *bgr, seg_rect window)
+{
+	// classify whole vectors even if that reaches a little past the window; the labeller only reads the window itself
+	int span = (window.width + 31) & ~31;
+	if (span > seg->width) {
+		span = seg->width;
+	}
+	int left = window.ulx + span > seg->width ? seg->width - span : window.ulx;
+	for (int y = window.uly; y < window.uly + window.height; y++) {
+		int start = y * seg->width + left;
+		fused_span(seg, bgr, seg->mask, start, start + span);
+	}
+	for (int channel = 0; channel < seg->channel_count; channel++) {
+		blob_label_window(seg->labeller, seg->mask, 1 << channel, window, seg->min_area, &seg->channels[channel]);
+	}
+}
+
+//=====================================//
+//==============PRESENCE===============//
+//=====================================//
+
+int seg_presence_step(const segmenter *seg, int hits)
+{
+	int side = (int)ceil(sqrt(seg->min_area)); // side of the smallest square that covers min_area pixels
+	int step = hits > 0 ? side / hits : side;
+	return step > 1 ? step : 1;
+}
+
+unsigned int seg_presence(segmenter *seg, const unsigned char *bgr, int step, int hits, unsigned int channels)
+{
+	int width = seg->width;
+	int count = (width + step - 1) / step; // samples per sampled row
+	// classify whole vectors of samples (the padding stays black), as long as that still fits in the row's mask
+	int span = (count + 31) & ~31;
+	span = span < width ? span : width;
+	unsigned char wanted = channels & ((1u << seg->channel_count) - 1);
+	hits = hits > 1 ? hits : 1;
+
+	for (int y = step / 2, sampled = 0; y < seg->height; y += step, sampled++) {
+		// gather every step-th pixel of the row side by side, so the vector kernel classifies only the samples; their
+		// mask bytes go to the start of the row's mask, where the rows sampled after this one look them up
+		const unsigned char *src = bgr + 3 * y * width;
+		unsigned char *out = seg->samples;
+		for (int k = 0; k < count; k++, src += 3 * step, out += 3) {
+			out[0] = src[0];
+			out[1] = src[1];
+			out[2] = src[2];
+		}
+		unsigned char *row = seg->mask + y * width;
+		fused_span(seg, seg->samples, row, 0, span);
+
+		// a cluster is "hits" matching samples running left along this row or up through the rows sampled before it;
+		// one AND per sample tests every wanted channel at once
+		for (int k = 0; k < count; k++) {
+			unsigned char across = k >= hits - 1 ? row[k] & wanted : 0, up = sampled + 1 >= hits ? row[k] & wanted : 0;
+			for (int j = 1; j < hits && (across | up); j++) {
+				across &= row[k - j];
+				up &= row[k - j * step * width];
+			}
+			if (across | up) {
+				return across | up; // the first cluster is enough to run the full pipeline
+			}
+		}
+	}
+	return 0;
+}
+
+//=====================================//
+//==============TRACKING===============//
+//=====================================//
+
+void seg_track_start(seg_tracker *tracker, int channel, int margin)
+{
+	tracker->channel = channel;
+	tracker->margin = margin;
+	tracker->locked = false;
+	tracker->target = (seg_point){-1, -1};
+}
+
+void seg_track_target(seg_tracker *tracker, seg_point target)
+{
+	tracker->target = target;
+	tracker->locked = false;
+}
+
+void seg_track_stop(seg_tracker *tracker)
+{
+	tracker->channel = -1;
+	tracker->locked = false;
+}
+
+// Nearest Blob: index of the kept blob whose centroid is closest to "point"
+static int nearest_blob(const seg_channel *result, seg_point point)
+{
+	int kept = result->count < SEG_MAX_BLOBS ? result->count : SEG_MAX_BLOBS;
+	int best = 0;
+	int best_distance = -1;
+	for (int i = 0; i < kept; i++) {
+		int dx = result->blobs[i].centroid.x - point.x;
+		int dy = result->blobs[i].centroid.y - point.y;
+		int distance = dx * dx + dy * dy;
+		if (best_distance < 0 || distance < best_distance) {
+			best = i;
+			best_distance = distance;
+		}
+	}
+	return best;
+}
+
+// Lock: center the next window on the target's bounding box, grown by the motion margin and clipped to the frame
+static void lock(const segmenter *seg, seg_tracker *tracker)
+{
+	const seg_channel *result = &seg->channels[tracker->channel];
+	const seg_blob *blob = &result->blobs[0];
+	if (tracker->target.x >= 0) {
+		blob = &result->blobs[nearest_blob(result, tracker->target)];
+		tracker->target = blob->centroid; // keep following this one, not whichever blob is largest next frame
+	}
+	seg_rect box = blob->bbox;
+	int left = box.ulx - tracker->margin;
+	int top = box.uly - tracker->margin;
+	int right = box.ulx + box.width + tracker->margin;
+	int bottom = box.uly + box.height + tracker->margin;
+	if (left < 0) left = 0;
+	if (top < 0) top = 0;
+	if (right > seg->width) right = seg->width;
+	if (bottom > seg->height) bottom = seg->height;
+
+	tracker->window.ulx = left;
+	tracker->window.uly = top;
+	tracker->window.width = right - left;
+	tracker->window.height = bottom - top;
+	tracker->locked = true;
+}
+
+bool seg_process_tracked(segmenter *seg, seg_tracker *tracker, const unsigned char *bgr)
+{
+	if (tracker->channel < 0 || tracker->channel >= seg->channel_count) {
+		seg_process(seg, bgr);
+		return false;
+	}
+	if (tracker->locked) {
+		seg_process_window(seg, bgr, tracker->window);
+		if (seg->channels[tracker->channel].count > 0) {
+			lock(seg, tracker);
+			return true;
+		}
+		tracker->locked = false; // target left the window, look at the whole frame again
+	}
+	seg_process(seg, bgr);
+	if (seg->channels[tracker->channel].count > 0) {
+		lock(seg, tracker);
+	}
+	return false;
+}
+
+//=====================================//
+//===============QUERIES===============//
+//=====================================//
+
+// Blob At: the index-th largest blob of a channel, or NULL if there is no such blob
+static const seg_blob *blob_at(const segmenter *seg, int channel, int index)
+{
+	if (channel < 0 || channel >= seg->channel_count || index < 0) {
+		return NULL;
+	}
+	const seg_channel *result = &seg->channels[channel];
+	if (index >= result->count || index >= SEG_MAX_BLOBS) {
+		return NULL;
+	}
+	return &result->blobs[index];
+}
+
+int seg_object_count(const segmenter *seg, int channel)
+{
+	if (channel < 0 || channel >= seg->channel_count) {
+		return 0;
+	}
+	return seg->channels[channel].count;
+}
+
+seg_rect seg_object_bbox(const segmenter *seg, int channel, int index)
+{
+	const seg_blob *blob = blob_at(seg, channel, index);
+	seg_rect none = {0, 0, 0, 0}; // width * height == 0 means "no object", like get_object_bbox
+	return blob ? blob->bbox : none;
+}
+
+seg_point seg_object_centroid(const segmenter *seg, int channel, int index)
+{
+	const seg_blob *blob = blob_at(seg, channel, index);
+	seg_point none = {-1, -1};
+	return blob ? blob->centroid : none;
+}
+
+int seg_object_area(const segmenter *seg, int channel, int index)
+{
+	const seg_blob *blob = blob_at(seg, channel, index);
+	return blob ? blob->area : 0;
+}
+
+const char *seg_kernel_name()
+{
+	return SEG_KERNEL;
+}
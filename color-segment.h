@@ -0,0 +1,132 @@
+/*
+Color segmentation for the pollinator robots.
+
+Replaces the blockz.conf channel tracker with our own pipeline so it can be profiled and tuned:
+    1. seg_classify_all  one pass over a camera frame (KIPR get_camera_frame() is BGR, 3 bytes per pixel) that marks
+                         the pixels of every color channel in the mask (SSE2 / NEON kernels, scalar fallback)
+    2. seg_find_blobs    group marked pixels into blobs, largest first (run-length labeller, blob-label.c)
+With a lookup table set (seg_set_lut, color-lut.h) step 1 is one table load per pixel instead of the threshold tests.
+seg_load_bgr + seg_classify do step 1 one channel at a time through full-size planes; they are kept as the
+reference the fused pass is checked and benchmarked against.
+The seg_object_* queries mirror get_object_count / get_object_bbox / get_object_centroid / get_object_area.
+
+While the robot is only searching, seg_presence answers "is anything there?" from a sparse sample of the raw frame and
+the full pipeline only runs when it says yes.
+
+While the robot centers on and approaches a target, a seg_tracker keeps it in tracking mode: after the target is
+first found only a window around its last bounding box is processed, and the whole frame again once it is lost.
+The target is the largest blob, or the blob nearest a given point when several flowers are in view.
+
+Nothing in here needs the Wombat, so it also runs on synthetic frames on a plain Linux box.
+*/
+
+#ifndef COLOR_SEGMENT_H
+#define COLOR_SEGMENT_H
+
+#include <stdbool.h> // Boolean support
+
+#define SEG_MAX_CHANNELS 4   // color channels a segmenter can track (we use 0 = red, 1 = blue)
+#define SEG_MAX_BLOBS 8      // blobs kept per channel, largest first
+#define SEG_MIN_AREA 10      // default smallest blob (in pixels) that counts as an object
+#define SEG_PRESENCE_HITS 1  // default number of neighboring samples that have to match to count as a cluster
+
+// A color class: a box in RGB space plus a margin by which one component has to beat the other two
+typedef struct seg_color {
+	unsigned char min[3];    // inclusive lower bound for R, G, B
+	unsigned char max[3];    // inclusive upper bound for R, G, B
+	unsigned char dominant;  // component that has to be the strongest: 0 = R, 1 = G, 2 = B
+	unsigned char margin;    // how far the dominant component has to exceed both others
+} seg_color;
+
+typedef struct seg_rect {
+	int ulx, uly;            // upper left corner
+	int width, height;
+} seg_rect;
+
+typedef struct seg_point {
+	int x, y;
+} seg_point;
+
+typedef struct seg_blob {
+	int area;                // number of pixels
+	seg_rect bbox;
+	seg_point centroid;
+} seg_blob;
+
+typedef struct seg_channel {
+	int count;                     // number of blobs found (may exceed SEG_MAX_BLOBS, only the largest are kept)
+	seg_blob blobs[SEG_MAX_BLOBS]; // sorted by area, largest first
+} seg_channel;
+
+// Tracking mode: follow one channel's blob through a window instead of scanning the whole frame
+typedef struct seg_tracker {
+	int channel;             // channel being followed, -1 when not tracking
+	int margin;              // pixels added around the last bounding box for the target's motion between frames
+	bool locked;             // true once the target has been found; the next frame only looks inside "window"
+	seg_rect window;
+	seg_point target;        // centroid of the blob being followed; x < 0 follows the largest blob
+} seg_tracker;
+
+typedef struct segmenter {
+	int width, height;
+	int channel_count;
+	int min_area;                          // smallest blob that counts as an object
+	seg_color colors[SEG_MAX_CHANNELS];
+	unsigned char *r, *g, *b;              // deinterleaved frame planes
+	unsigned char *mask;                   // one byte per pixel, bit c set when the pixel belongs to channel c
+	struct blob_labeller *labeller;        // run-length connected components (blob-label.h)
+	int *stack;                            // flood fill work list, one entry per pixel
+	unsigned char *visited;                // flood fill marks, one byte per pixel
+	unsigned char *samples;                // presence check: the sampled pixels of one row, packed (3 bytes each)
+	const unsigned char *lut;              // RGB to channel bits (color-lut.h); NULL classifies with the thresholds
+	seg_channel channels[SEG_MAX_CHANNELS];
+} segmenter;
+
+// SETUP
+bool seg_init(segmenter *seg, int width, int height);   // allocate all buffers for one frame size; false if out of memory
+void seg_free(segmenter *seg);
+void seg_set_color(segmenter *seg, int channel, seg_color color);
+void seg_default_colors(segmenter *seg);                 // channel 0 = red, channel 1 = blue
+void seg_set_lut(segmenter *seg, const unsigned char *lut, int channels); // classify by table; NULL goes back to colors
+bool seg_color_matches(const seg_color *color, const unsigned char rgb[3]); // one pixel against one color class
+
+// PIPELINE
+void seg_classify_all(segmenter *seg, const unsigned char *bgr); // fused: every channel in one pass over the frame
+void seg_load_bgr(segmenter *seg, const unsigned char *bgr);  // copy an interleaved BGR frame into the planes
+void seg_classify(segmenter *seg, int channel);               // vectorized where available
+void seg_classify_scalar(segmenter *seg, int channel);        // reference kernel, same result as seg_classify
+void seg_find_blobs(segmenter *seg, int channel);
+void seg_find_blobs_flood(segmenter *seg, int channel);      // naive flood fill, same blobs as seg_find_blobs (reference)
+void seg_process(segmenter *seg, const unsigned char *bgr);   // both steps for every channel
+void seg_process_window(segmenter *seg, const unsigned char *bgr, seg_rect window); // same, only inside the window
+
+// PRESENCE
+// Presence: classify every "step"-th pixel of every "step"-th row of a BGR frame and stop at the first cluster of
+// "hits" matching samples in a row or column for any channel in the "channels" bitmask; returns the channels of that
+// cluster (bit c for channel c), 0 if there is none. Overwrites the start of the sampled rows of the mask.
+unsigned int seg_presence(segmenter *seg, const unsigned char *bgr, int step, int hits, unsigned int channels);
+
+// Presence Step: the widest sampling step at which every blob that covers a solid square of min_area pixels still
+// puts "hits" samples in a row (and in a column) under seg_presence, so the check never says no to a frame whose blob
+// seg_find_blobs would keep. The square's side is ceil(sqrt(min_area)), and any run of that many pixels holds at
+// least side / step samples; for the defaults (10 pixels, 1 hit) the step is 4, so one pixel in 16 is classified.
+int seg_presence_step(const segmenter *seg, int hits);
+
+// TRACKING
+void seg_track_start(seg_tracker *tracker, int channel, int margin);       // follow the largest blob
+void seg_track_target(seg_tracker *tracker, seg_point target);            // follow the blob nearest "target" instead
+void seg_track_stop(seg_tracker *tracker);
+// Process Tracked: process the window if locked, falling back to the whole frame when the target is not in it;
+// returns true if only the window was needed
+bool seg_process_tracked(segmenter *seg, seg_tracker *tracker, const unsigned char *bgr);
+
+// QUERIES (same meaning as the KIPR get_object_* functions; index 0 is the largest object)
+int seg_object_count(const segmenter *seg, int channel);
+seg_rect seg_object_bbox(const segmenter *seg, int channel, int index);
+seg_point seg_object_centroid(const segmenter *seg, int channel, int index);
+int seg_object_area(const segmenter *seg, int channel, int index);
+
+void seg_keep_blob(seg_channel *result, const seg_blob *blob); // count a blob and insert it into the largest-first list
+const char *seg_kernel_name();                           // "sse2", "neon" or "scalar"
+
+#endif
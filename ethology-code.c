@@ -3,6 +3,17 @@
 #include <stdlib.h>       // General-purpose functions
 #include <stdbool.h>      // Boolean support
 #include <math.h>
+#include "camera-thread.h" // background camera capture, provides frame_snapshot
+#include "pollination.h"   // red/blue proximity test over every blob in the frame
+#include "blob-track.h"    // blob IDs and predicted centroids while centering
+#include "run-log.h"       // recording a run for offline replay
+#include "robot-clock.h"   // sleeping until the next deadline instead of polling the timer
+#include "sensor-thread.h" // IR and bumpers sampled in the background
+#include "sensor-filter.h" // spike removal, smoothing and debouncing of every sample
+#include "motor-out.h"     // drops repeated servo writes and limits how often each servo is written
+#include "servo-cal.h"     // calibrated wheel speed to servo position table
+#include "visual-servo.h"  // closed-loop steering and approach on the target's position and size
+#include "tuning.h"        // thresholds and timings overridden from tuning.cfg or by the sweep tool
 
 // Define integer keys for each action type
 #define SEEK_LIGHT_TYPE 0
@@ -31,40 +42,134 @@
 #define GRIPPER_OPEN_POSITION 0
 #define GRIPPER_CLOSED_POSITION 1023
 
+#define FORWARD_SPEED 300 // per mille of full speed for "forward", the same on every calibrated robot
+
 #define LIFTER_DOWN_POSITION 2030
 #define LIFTER_UP_POSITION 0
 
+// Sensor filtering (every sample of the sensor thread goes through these)
+#define IR_SMOOTHING 0.3f   // weight of each new median-filtered IR sample in the average
+#define IR_HYSTERESIS 200   // IR has to drop this far below the threshold before avoid stops triggering
+#define BUMP_DEBOUNCE 4     // samples a bumper has to hold before it counts (2 ms each at SENSOR_RATE)
+#define BUMP_SETTLE_MS 2    // how soon to look again while a bumper is still debouncing
+
+// Behavior sequences that run one step per tick
+#define SEQUENCE_NONE 0
+#define SEQUENCE_APPROACH 1
+#define SEQUENCE_DROP 2
+#define SEQUENCE_DANCE 3
+
+// Steps of the approach and drop sequences
+#define STEP_SERVO 0    // turn towards and drive up to the target until it is within reach or out of view
+#define STEP_LOWER 1    // lower the lifter
+#define STEP_OPEN 2     // open the gripper
+#define STEP_CLOSE 3    // close the gripper on the flower
+#define STEP_RELEASE 4  // open the gripper over the drop zone
+#define STEP_LIFT 5     // raise the lifter
+#define STEP_BACK 6     // back away from the drop zone
+#define STEP_DONE 7
+
 // Global Variables
 int hierarchy_length;
 int timer_duration = 500;
 unsigned long start_time = 0;
 bool have_pollen = false;
+bool record_run = false;                // append camera frames, blobs, sensors and drive commands to run_log_path
+const char *run_log_path = "run.log";  // replay it off the robot with log-replay
 
 // store all current sensor values accessible to all functions and updated by the "read_sensors" function
 int right_ir_value, left_ir_value, back_bump_left_value, back_bump_center_value, back_bump_right_value;
 
+// Pins sampled by the sensor thread, in the order of the values above
+sensor_pin sensor_pins[] = {
+    {SENSOR_ANALOG, RIGHT_IR_PIN},
+    {SENSOR_ANALOG, LEFT_IR_PIN},
+    {SENSOR_DIGITAL, BACK_BUMP_LEFT_PIN},
+    {SENSOR_DIGITAL, BACK_BUMP_CENTER_PIN},
+    {SENSOR_DIGITAL, BACK_BUMP_RIGHT_PIN}
+};
+sensor_sample sensors[SENSOR_RING]; // samples taken by "read_sensors" since the previous tick, newest first
+unsigned long long last_sample = 0;  // sequence of the newest sample already filtered
+
+// IR values are the median of the last five samples, averaged; bumper values are debounced
+median5 ir_median[2];  // right, left
+ema ir_average[2];
+hysteresis ir_near[2];
+debounce bumpers[3];   // left, center, right
+
 // threshold values
 int avoid_threshold = 6000;	   // the absolute difference between IR readings has to be above this for the avoid action
+int pollination_distance = 30; // pollen closer than this many pixels to a flower's centroid means it is pollinated
+int actuation_latency = 60;    // ms from a centering decision until the motors act on it; the tracker predicts this far ahead
+int grasp_area = 4000;         // pixels a flower (or the drop zone) covers once the gripper can reach it
+int max_turn = SERVO_STEER_MAX; // largest steering correction while approaching (per mille)
+
+// search timings
+int spin_limit = 7;            // spins of the spin search before driving the next leg of the spiral
+int spiral_step = 1;           // seconds each spiral leg grows by
+int dance_after = 30000;       // ms without finding pollen before the robot dances
+
+// Tunable parameters (see tuning.h), set from tuning.cfg or by the sweep tool before anything else runs
+tuning_param tuning[] = {
+    {"avoid_threshold", &avoid_threshold},
+    {"pollination_distance", &pollination_distance},
+    {"actuation_latency", &actuation_latency},
+    {"grasp_area", &grasp_area},
+    {"max_turn", &max_turn},
+    {"spin_limit", &spin_limit},
+    {"spiral_step", &spiral_step},
+    {"dance_after", &dance_after}
+};
+
+// Camera snapshot: every perception function reads the blobs of the current tick from here instead of updating the camera itself
+frame_snapshot frame; // filled once per tick by "capture_frame"
+int target_flower = 0; // red object to approach, set by "is_pollinated" to the largest flower without pollen
+point2 target;         // position of the object being centered on, followed from frame to frame
+blob_tracker centering_tracker; // filters the centroids seen while centering
+int centering_id = 0;           // tracker ID of the object being centered on
+visual_servo approach_servo;    // wheel speeds from the target's offset and size while approaching
+bool fresh_frame = false;       // "frame" is new this tick
+
+// Behavior sequence in progress: approach, drop and dance take seconds, so they run one step per tick
+// and the bumpers and IR are still checked between steps
+int sequence = SEQUENCE_NONE;
+int sequence_step = 0;
+int sequence_channel = 0;          // camera channel the approach follows
+unsigned long sequence_start = 0;  // systime() when the sequence started
+unsigned long no_pollen_timer = 0; // systime() when pollen was last found or dropped (or the last dance ended)
+unsigned long motor_report_time = 0; // robot_time() when the skipped servo writes were last logged
 
 // Function Declarations
 void initialize_camera();
+bool capture_frame(); // copy the newest camera frame into "frame", true if it is new since the last call
 bool search_snapshot(int channel);
+int nearest_object(int channel, point2 point);
 void spin_search();
-void approach_object();
+void approach_object(int channel);
 void stop();
 void drive(float left, float right, float delay_seconds);
+void drive_q(int left, int right, int milliseconds); // drive with speeds in per mille (-1000 .. 1000), integer only
+void set_wheels(int left, int right); // set both wheel speeds (per mille) without touching the timer
+void init_wheels(); // build the wheel table from this robot's calibration
 bool timer_elapsed();
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high);
 bool is_pollinated();
 void approach_drop();
 void forward();
 void dance(); // Function for the dance
+void step_sequence();      // run the next step of the sequence in progress
+void interrupt_sequence(); // a higher-priority behavior takes over
+void hold(int milliseconds); // keep the motors as they are until the next tick in this many ms
 void read_sensors();							 // read all sensor values and save to global variables
+void init_filters();							 // reset the IR filters and bumper debouncers
+void filter_sample(const int *values);			 // run one sample (in sensor_pins order) through the filters
+bool is_bump_settling();						 // true while a bumper is between pressed and released
 bool is_above_distance_threshold(int threshold); // return true if one and only one IR sensor is above the specified threshold
 bool is_back_bump();							 // return true if one of the back bumpers was hit
 void escape_back(); //initialize escape back function
 void avoid(); //initialize avoid function
 
+servo_table wheels; // servo position for every wheel speed, built by "init_wheels"
+
 //Used for spin seach function
 int spiral_length = 1; // Length of the forward movement, increases over time
 int spin_count = 0; // Global variable to track the number of spins
@@ -74,59 +179,91 @@ int spin_count = 0; // Global variable to track the number of spins
 //==================================//
 
 int main() {    
+    tuning_load(tuning, sizeof(tuning) / sizeof(tuning_param));
     enable_servo(LEFT_MOTOR_PIN);
     enable_servo(RIGHT_MOTOR_PIN);
     enable_servo(GRIPPER_PIN);
     enable_servo (LIFTER_PIN);
-
-    unsigned long no_pollen_timer = systime(); // Timer to track time spent without finding pollen
+    motor_out_init(MOTOR_INTERVAL);
+    init_wheels();
+    visual_servo_config approach_config;
+    visual_servo_defaults(&approach_config, grasp_area);
+    approach_config.max_turn = max_turn;
+    visual_servo_init(&approach_servo, &approach_config);
+
+    no_pollen_timer = systime(); // Timer to track time spent without finding pollen
    
+    if (record_run) {
+        run_log_start(run_log_path, systime()); // started before anything moves so the log has the whole run
+    }
     drive(0.0, 0.0, 1.0);
     
+    init_filters();
+    sensor_thread_start(sensor_pins, sizeof(sensor_pins) / sizeof(sensor_pin), SENSOR_RATE);
     initialize_camera();
 
 while (true) {
-    if (timer_elapsed()) {
-        read_sensors(); // Read all sensors and set global variables of their readouts
+    unsigned long deadline = start_time + timer_duration; // the current drive command runs until then, or a new frame or bump wakes us
+    if (is_bump_settling()) {
+        deadline = robot_time() + BUMP_SETTLE_MS; // a bumper changed, see whether it holds
+    }
+    motor_flush_deadline(&deadline); // a servo write held back by the motor layer is due sooner
+    robot_sleep_until(deadline);
+    motor_flush();
+    if (run_log_active() && robot_time() - motor_report_time >= 10000) {
+        motor_stats counts;
+        motor_stats_read(&counts);
+        char note[128];
+        snprintf(note, sizeof(note), "servo writes skipped: %.1f/s (%lu written, %lu unchanged, %lu coalesced)",
+                 motor_skipped_per_second(), counts.written, counts.unchanged, counts.coalesced);
+        run_log_note(systime(), note);
+        motor_report_time = robot_time();
+    }
+    read_sensors(); // Take the newest sensor sample into the global variables (no pin is read here)
+    if (timer_elapsed() || is_back_bump()) { // a bump cuts the current drive command short
+        fresh_frame = capture_frame(); // one camera frame for every perception check below
 
         if (is_back_bump()) {
+            interrupt_sequence(); // escaping wins over an approach or dance in progress
             escape_back();
             // continue;
         } else {
             if (is_above_distance_threshold(avoid_threshold)) {
+                interrupt_sequence();
                 avoid();
                 // continue;
+            } else if (sequence != SEQUENCE_NONE) {
+                step_sequence(); // one step of the approach, drop or dance in progress
             } else {
-                if (systime() - no_pollen_timer > 30000) { // Check if 30 seconds have passed without detecting pollen
+                if (systime() - no_pollen_timer > (unsigned long)dance_after) { // Check if it has gone too long without detecting pollen
                     stop();
-                    dance(); // Perform the dance
-                    no_pollen_timer = systime(); // Reset timer after dance
+                    dance(); // Start the dance, the timer is reset when it ends
                 } else {
                     if (is_pollinated()) {
                         // Object detected, approach it
                         printf("pollinated!!");
+                        run_log_note(systime(), "pollinated");
                         spin_search(); // No object detected, continue spinning search
                          // If the robot spins 2 times, drive forward and reset
-                if (spin_count >= 7) {
+                if (spin_count >= spin_limit) {
                     stop();
                     drive(0.3, 0.3, spiral_length); // Drive forward
-                    spiral_length++;               // Increase spiral search area
+                    spiral_length += spiral_step;  // Increase spiral search area
                     spin_count = 0;                // Reset spin counter
                 }
                     } else if (!have_pollen) {
                         if (search_snapshot(0)) {
                             // Object detected, approach it
                             approach_object(0);
-                            no_pollen_timer = systime();
                             
                         } else {
                             // No object detected, continue spinning search
                             spin_search();
                              // If the robot spins 2 times, drive forward and reset
-                if (spin_count >= 7) {
+                if (spin_count >= spin_limit) {
                     stop();
                     drive(0.3, 0.3, spiral_length); // Drive forward
-                    spiral_length++;               // Increase spiral search area
+                    spiral_length += spiral_step;  // Increase spiral search area
                     spin_count = 0;                // Reset spin counter
                 }
                         }
@@ -134,16 +271,15 @@ while (true) {
                         if (search_snapshot(1)) {
                             // Object detected, approach it
                             approach_drop();
-                            no_pollen_timer = systime();
 
                         } else {
                             // No object detected, continue spinning search
                             spin_search();
                              // If the robot spins 2 times, drive forward and reset
-                if (spin_count >= 7) {
+                if (spin_count >= spin_limit) {
                     stop();
                     drive(0.3, 0.3, spiral_length); // Drive forward
-                    spiral_length++;               // Increase spiral search area
+                    spiral_length += spiral_step;  // Increase spiral search area
                     spin_count = 0;                // Reset spin counter
                 }
                         }
@@ -164,114 +300,152 @@ return 0;
 void initialize_camera() {
     camera_load_config("blockz.conf");
     camera_open();
+    camera_thread_start(); // frames are captured in the background from now on
 }
 
-// Search Snapshot: Detects objects using the camera
+// Capture Frame: Takes the newest frame from the capture thread without waiting for the camera
+bool capture_frame() {
+    unsigned long previous = frame.sequence;
+    camera_latest(&frame);
+    return frame.sequence != previous;
+}
+
+// Search Snapshot: Detects objects in the current frame
 bool search_snapshot(int channel) {
-    camera_update();
-    msleep(10);
-    int object_count = get_object_count(channel);
+    int object_count = frame.count[channel];
     if (object_count > 0){
         printf("found");
+        run_log_note(systime(), "found");
     }
     return object_count > 0; // Return true if any object is detected
 }
 
-// Function to wait for the object to be centered in the camera's view
-void wait_for_centered_object(int channel) {
-    camera_update();
-    msleep(10); // Small delay for camera update
-    
-    int object_count = get_object_count(channel);
-    if (object_count == 0) {
-        // No object detected, return
-        return;
+// Nearest Object: index of the object on this channel closest to "point" in the current frame
+int nearest_object(int channel, point2 point) {
+    int kept = frame.count[channel] < SNAPSHOT_BLOBS ? frame.count[channel] : SNAPSHOT_BLOBS;
+    int best = 0;
+    int best_distance = -1;
+    for (int i = 0; i < kept; i++) {
+        int x = frame.centroid[channel][i].x - point.x;
+        int y = frame.centroid[channel][i].y - point.y;
+        int distance = x * x + y * y;
+        if (best_distance < 0 || distance < best_distance) {
+            best = i;
+            best_distance = distance;
+        }
     }
+    return best;
+}
 
-    // Define the center of the camera's view (in pixels)
-    int center_x = 80; // Assuming the camera resolution is 320x240 (center is 160 on x-axis)
+// Start Servo: begin following "target" on this channel
+void start_servo() {
+    blob_tracker_init(&centering_tracker, TRACK_ALPHA, TRACK_BETA, TRACK_GATE, TRACK_MAX_MISSED);
+    centering_id = 0;
+    visual_servo_reset(&approach_servo);
+}
 
-    // Define a threshold for being "centered"
-    int threshold = 35;  // Tolerance for being centered (±20 pixels)
-    
-    while (true) {
-        camera_update();  // Continuously update the camera
-		msleep(10);
-        // Get the x-coordinate of the first detected object (assuming one object detected)
-        int object_x = get_object_centroid(channel, 0).x;
-
-        // Check if the object is within the centered threshold
-        if (object_x >= (center_x - threshold) && object_x <= (center_x + threshold)) {
-            // If the object is centered, break the loop and exit
-            printf("x: %d", object_x);
-            break;
-        } else {
-            // Otherwise, move the robot to center the object
-            if (object_x < center_x - threshold) {
-                // Move left to center the object
-                drive(-0.07, 0.07, 0.1);
-                msleep(10);
-            } else if (object_x > center_x + threshold) {
-                // Move right to center the object
-                drive(0.07, -0.07, 0.1);
-                msleep(10);
-            }
-            msleep(10); // Small delay to avoid excessive updates
+// Servo Step: one closed-loop correction that turns towards the object and drives up to it at the same time;
+// true once it is within reach of the gripper or out of view
+bool servo_step(int channel) {
+    if (!fresh_frame) {
+        // No new frame since the last correction, the wheels keep their speeds;
+        // the capture thread wakes us as soon as it publishes the next one
+        hold(20);
+        return false;
+    }
+    if (frame.count[channel] <= 0) {
+        // Object out of view: either lost or already under the camera, in front of the gripper
+        return true;
+    }
+    int kept = frame.count[channel] < SNAPSHOT_BLOBS ? frame.count[channel] : SNAPSHOT_BLOBS;
+    seg_point centroids[SNAPSHOT_BLOBS];
+    for (int i = 0; i < kept; i++) {
+        centroids[i] = (seg_point){frame.centroid[channel][i].x, frame.centroid[channel][i].y};
+    }
+    blob_tracker_update(&centering_tracker, centroids, kept, frame.time);
+
+    // Follow the object we picked, not whichever one happens to be largest in this frame,
+    // and steer on where it will be when the motors act rather than where it was in the frame
+    seg_point predicted;
+    if (!blob_tracker_predict(&centering_tracker, centering_id, systime() + actuation_latency, &predicted)) {
+        // nothing followed yet, or the track was dropped: take up the track closest to where the object was last seen
+        centering_id = blob_tracker_nearest(&centering_tracker, (seg_point){target.x, target.y});
+        if (!blob_tracker_predict(&centering_tracker, centering_id, systime() + actuation_latency, &predicted)) {
+            predicted = centroids[nearest_object(channel, target)];
+        }
+    }
+    int followed = -1;
+    for (int i = 0; i < kept; i++) {
+        if (centering_tracker.blob_id[i] == centering_id) {
+            followed = i;
         }
     }
+    if (followed < 0) {
+        followed = nearest_object(channel, target); // predicted from earlier frames but not matched in this one
+    }
+    target = frame.centroid[channel][followed];
+
+    int left, right;
+    if (visual_servo_update(&approach_servo, predicted.x, frame.area[channel][followed], frame.width, frame.time, &left, &right)) {
+        return true;
+    }
+    drive_q(left, right, 20); // corrected again with the next frame
+    return false;
 }
 
 
-// Is pollinated Boolean loop : checks if the flower the camera sees has pollen on it
+// Is pollinated Boolean loop : checks if every flower the camera sees has pollen on it
+// and picks the largest one that does not as "target_flower"
 bool is_pollinated() {
-    camera_update();
-    msleep(10);
-
-    int red_count = get_object_count(0);
-    int blue_count = get_object_count(1);
+    int red_count = frame.count[0] < SNAPSHOT_BLOBS ? frame.count[0] : SNAPSHOT_BLOBS;
+    int blue_count = frame.count[1] < SNAPSHOT_BLOBS ? frame.count[1] : SNAPSHOT_BLOBS;
+    target_flower = 0;
 
-    if (red_count + blue_count < 1){
+    if (red_count < 1 || blue_count < 1){
         return false;
     }
 
-    int redx  = (get_object_centroid(0, 0)).x ;
-    int redy  = (get_object_centroid(0, 0)).y ;
-    int bluex  = (get_object_centroid(1, 0)).x ;
-    int bluey  = (get_object_centroid(1, 0)).y ;
-    
-    int x = redx - bluex;
-    int y = redy - bluey;
-    
-    float dist = sqrt( pow(x, 2) + pow(y, 2) );
-    
- 		if (dist < 30){
+    seg_point red[SNAPSHOT_BLOBS], blue[SNAPSHOT_BLOBS];
+    for (int i = 0; i < red_count; i++) {
+        red[i] = (seg_point){frame.centroid[0][i].x, frame.centroid[0][i].y};
+    }
+    for (int i = 0; i < blue_count; i++) {
+        blue[i] = (seg_point){frame.centroid[1][i].x, frame.centroid[1][i].y};
+    }
+    pollination_result flowers;
+    find_pollinated(red, red_count, blue, blue_count, pollination_distance, frame.width, frame.height, &flowers);
+
+    if (flowers.pollinated_count > 0){
         printf("nearby");
-        return true;
+        run_log_note(systime(), "nearby");
     }
+    int unpollinated = first_unpollinated(&flowers);
+    if (unpollinated < 0) {
+        return true; // every flower in view already has pollen
+    }
+    target_flower = unpollinated;
     return false;
 }
 
-// Dance: Perform a dance by alternating motor movements
+// Dance: Start a dance of alternating spins; it runs for 10 seconds, one move per tick
 void dance() {
-    unsigned long dance_start = systime(); // Track the start time of the dance
-    while (systime() - dance_start < 10000) { // Dance for 10 seconds
-        // Move left wheel forward, right wheel backward (spin in place)
-        drive(0.2, -0.2, 0.5);  // 0.5 seconds of movement
-        msleep(500);  // Pause for 0.5 seconds
-        // Move right wheel forward, left wheel backward (spin in place)
-        drive(-0.2, 0.2, 0.5);  // 0.5 seconds of movement
-        msleep(500);  // Pause for 0.5 seconds
-        drive(0.2, -0.2, 0.5);  // 0.5 seconds of movement
-        msleep(500);  // Pause for 0.5 seconds
-        // Move right wheel forward, left wheel backward (spin in place)
-        drive(-0.2, 0.2, 0.5);  // 0.5 seconds of movement
-        msleep(500);  // Pause for 0.5 seconds
-        drive(0.2, -0.2, 0.5);  // 0.5 seconds of movement
-        msleep(500);  // Pause for 0.5 seconds
-        // Move right wheel forward, left wheel backward (spin in place)
-        drive(-0.2, 0.2, 0.5);  // 0.5 seconds of movement
-        msleep(500);  // Pause for 0.5 seconds
+    sequence = SEQUENCE_DANCE;
+    sequence_step = 0;
+    sequence_start = systime(); // Track the start time of the dance
+}
+
+// Dance Step: one 0.5 second spin, left wheel forward and right wheel forward in turn; false when the dance is over
+bool dance_step() {
+    if (sequence_step % 6 == 0 && systime() - sequence_start >= 10000) { // Dance for 10 seconds, in rounds of six moves
+        return false;
+    }
+    if (sequence_step % 2 == 0) {
+        drive(0.2, -0.2, 0.5);  // Move left wheel forward, right wheel backward (spin in place)
+    } else {
+        drive(-0.2, 0.2, 0.5);  // Move right wheel forward, left wheel backward (spin in place)
     }
+    sequence_step++;
+    return true;
 }
 
 // Spin Search
@@ -286,48 +460,129 @@ void spin_search() {
     }
 }
 
-// Approach Object: Drives forward until the object is no longer visible, then closes gripper
-void approach_object(channel) {
-    stop(); // Stop once the object is no longer visible
-    wait_for_centered_object(channel);  // This function will block until the object is centered
-    stop();
-    msleep(1000);
-    set_servo_position(LIFTER_PIN,LIFTER_DOWN_POSITION);
-    msleep(1000);
-    set_servo_position(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Open the gripper
-    msleep(1000); // Wait for the gripper to open
-    while (search_snapshot(channel)) {
-        forward(); // Drive forward while object is visible
-        msleep(200);
+// Approach Object: Starts lowering and opening the gripper, then steering and driving up to the object and closing the gripper
+void approach_object(int channel) {
+    stop(); // Stop while the gripper gets ready
+    target = frame.centroid[channel][channel == 0 ? target_flower : 0]; // the flower without pollen, not just the largest
+    camera_track(channel, target); // only look around the object until it is lost
+    start_servo();
+    sequence = SEQUENCE_APPROACH;
+    sequence_step = STEP_LOWER;
+    sequence_channel = channel;
+    sequence_start = systime();
+}
+
+// Approach Drop: Starts steering and driving up to the drop zone and releasing the pollen
+void approach_drop() {
+    target = frame.centroid[1][0];
+    camera_track(1, target); // only look around the drop zone until it is lost
+    start_servo();
+    sequence = SEQUENCE_DROP;
+    sequence_step = STEP_SERVO;
+    sequence_channel = 1;
+    sequence_start = systime();
+}
+
+// Approach Step: one step of picking up pollen; false when the sequence is over
+bool approach_step() {
+    switch (sequence_step) {
+    case STEP_LOWER:
+        motor_set(LIFTER_PIN, LIFTER_DOWN_POSITION);
+        hold(1000);
+        sequence_step = STEP_OPEN;
+        break;
+    case STEP_OPEN:
+        motor_set(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Open the gripper
+        hold(1000); // Wait for the gripper to open
+        sequence_step = STEP_SERVO;
+        break;
+    case STEP_SERVO:
+        if (servo_step(sequence_channel)) {
+            camera_track_stop();
+            stop();
+            hold(1000);
+            sequence_step = STEP_CLOSE;
+        }
+        break;
+    case STEP_CLOSE:
+        motor_set(GRIPPER_PIN, GRIPPER_CLOSED_POSITION); // Close the gripper
+        hold(1000); // Wait for the gripper to close
+        sequence_step = STEP_LIFT;
+        break;
+    case STEP_LIFT:
+        motor_set(LIFTER_PIN, LIFTER_UP_POSITION);
+        hold(1000);
+        have_pollen = true;
+        sequence_step = STEP_DONE;
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// Drop Step: one step of dropping pollen off; false when the sequence is over
+bool drop_step() {
+    switch (sequence_step) {
+    case STEP_SERVO:
+        if (servo_step(sequence_channel)) {
+            camera_track_stop();
+            stop();
+            hold(1000); // Wait before opening the gripper
+            sequence_step = STEP_RELEASE;
+        }
+        break;
+    case STEP_RELEASE:
+        motor_set(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Open the gripper
+        have_pollen = false;
+        hold(1000); // Wait for the gripper to open
+        sequence_step = STEP_LIFT;
+        break;
+    case STEP_LIFT:
+        motor_set(LIFTER_PIN, LIFTER_UP_POSITION);
+        hold(1000);
+        sequence_step = STEP_BACK;
+        break;
+    case STEP_BACK:
+        drive(-1.0, -1.0, 0.2);
+        sequence_step = STEP_DONE;
+        break;
+    default:
+        return false;
     }
-    stop();
-    msleep(1000);
-    set_servo_position(GRIPPER_PIN, GRIPPER_CLOSED_POSITION); // Close the gripper
-    msleep(1000); // Wait for the gripper to close
-    set_servo_position(LIFTER_PIN, LIFTER_UP_POSITION);
-    msleep(1000); 
-    have_pollen = true;
+    return true;
+}
 
+// Step Sequence: runs one step of the sequence in progress and ends it when it is done
+void step_sequence() {
+    bool running = false;
+    if (sequence == SEQUENCE_APPROACH) {
+        running = approach_step();
+    } else if (sequence == SEQUENCE_DROP) {
+        running = drop_step();
+    } else if (sequence == SEQUENCE_DANCE) {
+        running = dance_step();
+    }
+    if (!running) {
+        sequence = SEQUENCE_NONE;
+        no_pollen_timer = systime(); // reset after picking up, dropping or dancing
+    }
 }
 
-void approach_drop() {
-        stop(); // Stop once the object is no longer visible
-    
-    wait_for_centered_object(1);
-    stop();
-    msleep(1000);
-    while (search_snapshot(1)) {
-        forward(); // Drive forward while object is visible
-        msleep(200);
+// Interrupt Sequence: a bump or obstacle takes over. An approach or drop is abandoned (the target is not where it
+// was any more) with the lifter raised again; a dance carries on where it was once the robot is clear.
+void interrupt_sequence() {
+    if (sequence == SEQUENCE_APPROACH || sequence == SEQUENCE_DROP) {
+        camera_track_stop();
+        motor_set(LIFTER_PIN, LIFTER_UP_POSITION);
+        sequence = SEQUENCE_NONE;
     }
-        stop();
-    msleep(1000); // Wait for the gripper to open
-    set_servo_position(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Close the gripper
-    have_pollen = false;  
-    msleep(1000); // Wait for the gripper to close
-    set_servo_position(LIFTER_PIN, LIFTER_UP_POSITION);
-    msleep(1000);
-    drive(-1.0, -1.0, 0.2);
+}
+
+// Hold: keeps the motors as they are and lets the next tick come in this many milliseconds
+void hold(int milliseconds) {
+    timer_duration = milliseconds;
+    start_time = robot_time();
 }
 
 // Stop: Stops the robot
@@ -336,24 +591,25 @@ void stop() {
 }
 
 void stop_plain() {
-    set_servo_position(LEFT_MOTOR_PIN, 0);
-    set_servo_position(RIGHT_MOTOR_PIN, 0);
+    motor_set_now(LEFT_MOTOR_PIN, 0);
+    motor_set_now(RIGHT_MOTOR_PIN, 0);
 }
 void forward() {
-    set_servo_position(LEFT_MOTOR_PIN, 1500);
-    set_servo_position(RIGHT_MOTOR_PIN, 880);
+    set_wheels(FORWARD_SPEED, FORWARD_SPEED);
 }
 
 //Avoid function
 
 void avoid()
 {
-	if (left_ir_value > avoid_threshold)
+	// turn away from the side whose comparator is_above_distance_threshold found near; the raw reading may already
+	// be back under the threshold while the hysteresis still holds it
+	if (ir_near[1].above)
 	{
 		drive(0.5, -0.5, 0.1);
 	}
 
-	else if (right_ir_value > avoid_threshold)
+	else if (ir_near[0].above)
 	{
 		drive(-0.5, 0.5, 0.1);
 	}
@@ -369,40 +625,105 @@ void escape_back()
 // Drive Function: Controls motor speeds
 
 void drive(float left, float right, float delay_seconds) {
-    float left_speed = map(left, -1.0, 1.0, 0, 2047);
-    float right_speed = map(right, -1.0, 1.0, 2047, 0);
+    drive_q((int)(left * SERVO_SPEED_MAX), (int)(right * SERVO_SPEED_MAX), (int)(delay_seconds * 1000));
+}
 
-    timer_duration = (int)(delay_seconds * 1000);
-    start_time = systime();
+void drive_q(int left, int right, int milliseconds) {
+    timer_duration = milliseconds;
+    start_time = robot_time();
+    if (run_log_active()) {
+        run_log_drive(systime(), left / (float)SERVO_SPEED_MAX, right / (float)SERVO_SPEED_MAX, milliseconds / 1000.0f);
+    }
 
-    set_servo_position(LEFT_MOTOR_PIN, left_speed);
-    set_servo_position(RIGHT_MOTOR_PIN, right_speed);
+    set_wheels(left, right);
+}
+
+void set_wheels(int left, int right) {
+    if (left == 0 && right == 0) { // a stop goes out at once, never held back for the interval
+        motor_set_now(LEFT_MOTOR_PIN, servo_position(wheels.left, 0));
+        motor_set_now(RIGHT_MOTOR_PIN, servo_position(wheels.right, 0));
+        return;
+    }
+    motor_set(LEFT_MOTOR_PIN, servo_position(wheels.left, left));
+    motor_set(RIGHT_MOTOR_PIN, servo_position(wheels.right, right));
+}
+
+void init_wheels() {
+    servo_calibration calibration;
+    servo_cal_default(&calibration);
+    servo_cal_load(&calibration, SERVO_CAL_FILE); // this robot's own servos, if it has been calibrated
+    servo_cal_build(&wheels, &calibration);
 }
 
 // Timer Elapsed: Checks if specified duration has passed
 
 bool timer_elapsed() {
-    return (systime() > (start_time + timer_duration));
+    return (long)(robot_time() - (start_time + timer_duration)) >= 0;
 }
 
 //reads all of the sensors
 
 void read_sensors()
 {
-	right_ir_value = analog_et(RIGHT_IR_PIN);				// read the IR sensor at RIGHT_IR_PIN
-	left_ir_value = analog_et(LEFT_IR_PIN);					// read the IR sensor at LEFT_IR_PIN
-	// read the bumpers
-	back_bump_left_value = digital(BACK_BUMP_LEFT_PIN);	// read the bumper at BACK_BUMP_LEFT_PIN
-	back_bump_center_value = digital(BACK_BUMP_CENTER_PIN);  // read the bumper at BACK_BUMP_CENTER_PIN
-	back_bump_right_value = digital(BACK_BUMP_RIGHT_PIN);	// read the bumper at BACK_BUMP_RIGHT_PIN	
+	int count = sensor_history_since(last_sample, sensors, SENSOR_RING);
+	if (count > 0) {
+		// every sample from the sensor thread since the last tick, oldest first; no pin is read here
+		for (int i = count - 1; i >= 0; i--) {
+			filter_sample(sensors[i].values);
+		}
+		last_sample = sensors[0].sequence;
+	} else if (last_sample == 0) {
+		// sensor thread not running (or no sample yet), read the pins directly
+		int values[5];
+		values[0] = analog_et(RIGHT_IR_PIN);		// read the IR sensor at RIGHT_IR_PIN
+		values[1] = analog_et(LEFT_IR_PIN);			// read the IR sensor at LEFT_IR_PIN
+		// read the bumpers
+		values[2] = digital(BACK_BUMP_LEFT_PIN);	// read the bumper at BACK_BUMP_LEFT_PIN
+		values[3] = digital(BACK_BUMP_CENTER_PIN);	// read the bumper at BACK_BUMP_CENTER_PIN
+		values[4] = digital(BACK_BUMP_RIGHT_PIN);	// read the bumper at BACK_BUMP_RIGHT_PIN
+		filter_sample(values);
+	}
+	if (run_log_active())
+	{
+		int values[5] = {right_ir_value, left_ir_value, back_bump_left_value, back_bump_center_value, back_bump_right_value};
+		run_log_sensors(systime(), values, 5);
+	}
 }
 /******************************************************/
 
-// Used for avoid function
+void init_filters()
+{
+	for (int i = 0; i < 2; i++) {
+		median5_init(&ir_median[i]);
+		ema_init(&ir_average[i], IR_SMOOTHING);
+		hysteresis_init(&ir_near[i], IR_HYSTERESIS);
+	}
+	for (int i = 0; i < 3; i++) {
+		debounce_init(&bumpers[i], BUMP_DEBOUNCE);
+	}
+}
+
+void filter_sample(const int *values)
+{
+	right_ir_value = (int)ema_update(&ir_average[0], median5_update(&ir_median[0], values[0])); // a single spike never gets through the median
+	left_ir_value = (int)ema_update(&ir_average[1], median5_update(&ir_median[1], values[1]));
+	back_bump_left_value = debounce_update(&bumpers[0], values[2] == 1);
+	back_bump_center_value = debounce_update(&bumpers[1], values[3] == 1);
+	back_bump_right_value = debounce_update(&bumpers[2], values[4] == 1);
+}
+
+bool is_bump_settling()
+{
+	return debounce_settling(&bumpers[0]) || debounce_settling(&bumpers[1]) || debounce_settling(&bumpers[2]);
+}
+
+// Used for avoid function (once per tick: the comparators remember whether each side was already above the threshold)
 
 bool is_above_distance_threshold(int threshold)
 {
-	return (left_ir_value > threshold || right_ir_value > threshold) && !(left_ir_value > threshold && right_ir_value > threshold);
+	bool right_near = hysteresis_update(&ir_near[0], right_ir_value, threshold);
+	bool left_near = hysteresis_update(&ir_near[1], left_ir_value, threshold);
+	return (left_near || right_near) && !(left_near && right_near);
 	// returns true if one (exclusive) IR value is above the threshold, otherwise false
 }
 
@@ -413,9 +734,4 @@ bool is_back_bump()
 	return (back_bump_left_value == 1 || back_bump_center_value == 1 || back_bump_right_value == 1); // return true if one of the back bump values is 1, otherwise false
 }
 
-// Map Function: Maps one range to another
-
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high) {
-    return target_range_low + ((value - start_range_low) / (start_range_high - start_range_low)) * (target_range_high - target_range_low);
-}
  
\ No newline at end of file
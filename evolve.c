@@ -0,0 +1,431 @@
+/*
+Genetic optimizer for the subsumption hierarchy of color-detection.c.
+
+A candidate hierarchy is an ordering of the nine behavior types together with an is_active flag for each. Every
+candidate is scored in the arena simulator over the same seeded missions (mission.h), passed to the program as the
+"<behavior>_rank" and "<behavior>_active" tuning overrides its tune_hierarchy() reads, with the missions of a
+generation spread over all cores by the work-stealing pool (work-pool.h). The fitness of a mission is
+
+    EVOLVE_POLLINATION_WEIGHT * pollinations/min + percent of the arena covered - EVOLVE_BUMP_WEIGHT * bumps/min
+
+averaged over the seeds; a mission that times out or fails scores 0. color-detection never drives a gripper, so its
+missions pollinate nothing and for it the fitness is coverage-based: percent of the arena covered less the bump
+penalty. The pollination term only counts for a program given with -p that carries flowers, and the summary says which
+of the two was ranked.
+
+Many different genomes are the same hierarchy to the arbiter, since only the order of the active behaviors matters and
+nothing below an always-active cruise behavior can ever run, so fitness is cached under that reduced form and each
+distinct hierarchy is simulated only once.
+
+Each generation keeps the best EVOLVE_ELITE candidates and breeds the rest by tournament selection, order crossover
+of the ranks, uniform crossover of the flags, and swap and flip mutations. The search stops after -g generations or
+once the best fitness has not improved for -S generations, and prints the winner as a subsumption_hierarchy[]
+initializer to paste into color-detection.c.
+
+Build and run on any Linux box (from the top of the repository):
+    make evolve
+    build/evolve [-j workers] [-P population] [-g generations] [-S stall] [-n seeds] [-s seconds] [-w timeout]
+                 [-r seed] [-p program]
+*/
+
+#include "mission.h"
+#include "work-pool.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BEHAVIOR_TYPES 9
+#define EVOLVE_PROGRAM "build/sim/color-detection"
+#define EVOLVE_POPULATION 32
+#define EVOLVE_GENERATIONS 40
+#define EVOLVE_STALL 10           // generations without improvement before stopping
+#define EVOLVE_SEEDS 6
+#define EVOLVE_SECONDS 300        // simulated seconds per mission
+#define EVOLVE_ELITE 2            // best candidates carried over unchanged
+#define EVOLVE_TOURNAMENT 3
+#define EVOLVE_SWAP_RATE 0.3      // chance of swapping two ranks in a child
+#define EVOLVE_FLIP_RATE 0.125    // chance of each flag flipping in a child
+#define EVOLVE_POLLINATION_WEIGHT 10.0
+#define EVOLVE_BUMP_WEIGHT 1.0
+#define CACHE_SIZE (1 << 18)      // fitness cache slots (power of two, more than there are distinct hierarchies)
+
+// By type, as in color-detection.c: tuning key, name in the initializer, type macro, whether it always fires
+static const struct {
+	const char *key, *name, *macro;
+	bool always;
+} behaviors[BEHAVIOR_TYPES] = {
+	{"seek_light", "SEEK LIGHT", "SEEK_LIGHT_TYPE", false},
+	{"seek_dark", "SEEK DARK", "SEEK_DARK_TYPE", false},
+	{"approach", "APPROACH", "APPROACH_TYPE", false},
+	{"avoid", "AVOID", "AVOID_TYPE", false},
+	{"escape_front", "ESCAPE FRONT", "ESCAPE_F_TYPE", false},
+	{"escape_back", "ESCAPE BACK", "ESCAPE_B_TYPE", false},
+	{"cruise_straight", "CRUISE STRAIGHT", "CRUISE_S_TYPE", true},
+	{"cruise_arc", "CRUISE ARC", "CRUISE_A_TYPE", true},
+	{"seek_red", "SEEK RED", "SEEK_RED_TYPE", false},
+};
+
+typedef struct genome {
+	int order[BEHAVIOR_TYPES];      // behavior types, highest rank first
+	bool active[BEHAVIOR_TYPES];    // by type
+	double fitness;
+} genome;
+
+// One distinct hierarchy being simulated this generation
+typedef struct candidate {
+	uint32_t key;
+	char tuning[512];
+	double sum;                     // under results_lock
+} candidate;
+
+typedef struct cache_slot {
+	uint32_t key;                   // 0 = empty
+	double fitness;
+} cache_slot;
+
+typedef struct evolution {
+	const char *program;
+	int workers, seeds;
+	double seconds, timeout;
+	candidate *candidates;
+	int candidate_count;
+	pthread_mutex_t results_lock;
+	cache_slot *cache;
+	int cached, hits;
+	long missions, failed;
+	long pollinations;              // over all missions, 0 when the program never carries a flower
+} evolution;
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//=====================================//
+//===============FITNESS===============//
+//=====================================//
+
+// Key: the hierarchy as the arbiter sees it, one nibble per active type (type + 1) in rank order, ending after the
+// first behavior that always fires (so at most the seven others and one cruise, 32 bits)
+static uint32_t key(const genome *g)
+{
+	uint32_t k = 0;
+	for (int rank = 0; rank < BEHAVIOR_TYPES; rank++) {
+		int type = g->order[rank];
+		if (!g->active[type]) {
+			continue;
+		}
+		k = k << 4 | (uint32_t)(type + 1);
+		if (behaviors[type].always) {
+			break;
+		}
+	}
+	return k ? k : 0xf; // nothing active is a hierarchy too
+}
+
+static cache_slot *lookup(evolution *run, uint32_t k)
+{
+	uint32_t slot = (k * 2654435761u) & (CACHE_SIZE - 1);
+	while (run->cache[slot].key != 0 && run->cache[slot].key != k) {
+		slot = (slot + 1) & (CACHE_SIZE - 1);
+	}
+	return &run->cache[slot];
+}
+
+// Describe: the ROBOT_TUNING string that makes the program run this genome's hierarchy
+static void describe(const genome *g, char *tuning, size_t size)
+{
+	size_t length = 0;
+	for (int rank = 0; rank < BEHAVIOR_TYPES && length < size; rank++) {
+		int type = g->order[rank];
+		length += snprintf(tuning + length, size - length, "%s%s_rank=%d,%s_active=%d", rank ? "," : "",
+						   behaviors[type].key, rank, behaviors[type].key, g->active[type]);
+	}
+}
+
+static double score(const mission_result *result)
+{
+	if (result->status != MISSION_DONE || result->seconds <= 0) {
+		return 0;
+	}
+	double minutes = result->seconds / 60;
+	return EVOLVE_POLLINATION_WEIGHT * result->pollinations / minutes + result->coverage
+		- EVOLVE_BUMP_WEIGHT * result->bumps / minutes;
+}
+
+// Run Mission: one job of the pool; job = candidate * seeds + seed
+static void run_mission(int job, void *context)
+{
+	evolution *run = context;
+	candidate *c = &run->candidates[job / run->seeds];
+	mission settings = {run->program, (unsigned int)(job % run->seeds) + 1, run->seconds, run->timeout, c->tuning};
+	mission_result result;
+	mission_run(&settings, &result);
+
+	pthread_mutex_lock(&run->results_lock);
+	c->sum += score(&result);
+	run->missions++;
+	run->failed += result.status != MISSION_DONE;
+	run->pollinations += result.status == MISSION_DONE ? result.pollinations : 0;
+	pthread_mutex_unlock(&run->results_lock);
+}
+
+// Evaluate: give every genome its fitness, simulating only the hierarchies the cache has not seen
+static bool evaluate(evolution *run, genome *population, int count)
+{
+	run->candidate_count = 0;
+	for (int i = 0; i < count; i++) {
+		uint32_t k = key(&population[i]);
+		cache_slot *slot = lookup(run, k);
+		if (slot->key == k) {
+			run->hits++;
+			continue;
+		}
+		bool queued = false;
+		for (int c = 0; c < run->candidate_count && !queued; c++) {
+			queued = run->candidates[c].key == k;
+		}
+		if (!queued) {
+			candidate *c = &run->candidates[run->candidate_count++];
+			c->key = k;
+			c->sum = 0;
+			describe(&population[i], c->tuning, sizeof(c->tuning));
+		}
+	}
+	if (run->candidate_count > 0
+		&& !work_pool_run(run->workers, run->candidate_count * run->seeds, run_mission, run)) {
+		return false;
+	}
+	for (int c = 0; c < run->candidate_count; c++) {
+		cache_slot *slot = lookup(run, run->candidates[c].key);
+		slot->key = run->candidates[c].key;
+		slot->fitness = run->candidates[c].sum / run->seeds;
+		run->cached++;
+	}
+	for (int i = 0; i < count; i++) {
+		population[i].fitness = lookup(run, key(&population[i]))->fitness;
+	}
+	return true;
+}
+
+//=====================================//
+//===============BREEDING==============//
+//=====================================//
+
+static double uniform(unsigned int *seed)
+{
+	return (double)rand_r(seed) / ((double)RAND_MAX + 1);
+}
+
+static void random_genome(genome *g, unsigned int *seed)
+{
+	for (int rank = 0; rank < BEHAVIOR_TYPES; rank++) {
+		g->order[rank] = rank;
+	}
+	for (int rank = BEHAVIOR_TYPES - 1; rank > 0; rank--) {
+		int other = rand_r(seed) % (rank + 1);
+		int swap = g->order[rank];
+		g->order[rank] = g->order[other];
+		g->order[other] = swap;
+	}
+	for (int type = 0; type < BEHAVIOR_TYPES; type++) {
+		g->active[type] = rand_r(seed) & 1;
+	}
+}
+
+// Default Genome: the hierarchy color-detection.c ships with
+static void default_genome(genome *g)
+{
+	static const int order[BEHAVIOR_TYPES] = {4, 5, 3, 8, 0, 6, 1, 2, 7}; // ESCAPE F/B, AVOID, SEEK RED, SEEK LIGHT, ...
+	memcpy(g->order, order, sizeof(order));
+	memset(g->active, 0, sizeof(g->active));
+	g->active[3] = true; // AVOID
+	g->active[8] = true; // SEEK RED
+	g->active[6] = true; // CRUISE STRAIGHT
+}
+
+static const genome *tournament(const genome *population, int count, unsigned int *seed)
+{
+	const genome *best = &population[rand_r(seed) % count];
+	for (int i = 1; i < EVOLVE_TOURNAMENT; i++) {
+		const genome *other = &population[rand_r(seed) % count];
+		best = other->fitness > best->fitness ? other : best;
+	}
+	return best;
+}
+
+// Breed: order crossover of the ranks (a slice from one parent, the remaining types in the other parent's order),
+// uniform crossover of the flags, then mutation
+static void breed(const genome *a, const genome *b, genome *child, unsigned int *seed)
+{
+	int start = rand_r(seed) % BEHAVIOR_TYPES;
+	int end = start + rand_r(seed) % (BEHAVIOR_TYPES - start) + 1;
+	bool taken[BEHAVIOR_TYPES] = {false};
+	for (int rank = start; rank < end; rank++) {
+		child->order[rank] = a->order[rank];
+		taken[a->order[rank]] = true;
+	}
+	int from = 0;
+	for (int rank = 0; rank < BEHAVIOR_TYPES; rank++) {
+		if (rank >= start && rank < end) {
+			continue;
+		}
+		while (taken[b->order[from]]) {
+			from++;
+		}
+		child->order[rank] = b->order[from++];
+	}
+	for (int type = 0; type < BEHAVIOR_TYPES; type++) {
+		child->active[type] = (rand_r(seed) & 1) ? a->active[type] : b->active[type];
+		if (uniform(seed) < EVOLVE_FLIP_RATE) {
+			child->active[type] = !child->active[type];
+		}
+	}
+	if (uniform(seed) < EVOLVE_SWAP_RATE) {
+		int i = rand_r(seed) % BEHAVIOR_TYPES, j = rand_r(seed) % BEHAVIOR_TYPES;
+		int swap = child->order[i];
+		child->order[i] = child->order[j];
+		child->order[j] = swap;
+	}
+}
+
+static int by_fitness(const void *a, const void *b)
+{
+	double fa = ((const genome *)a)->fitness, fb = ((const genome *)b)->fitness;
+	return fa > fb ? -1 : fa < fb;
+}
+
+// Print Initializer: active behaviors first in rank order, then the inactive ones, as in color-detection.c
+static void print_initializer(const genome *g)
+{
+	printf("struct behavior subsumption_hierarchy[] = {\n");
+	int printed = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		for (int rank = 0; rank < BEHAVIOR_TYPES; rank++) {
+			int type = g->order[rank];
+			if (g->active[type] != (pass == 0)) {
+				continue;
+			}
+			printed++;
+			printf("\t{\"%s\", %s, 0, %s}%s\n", behaviors[type].name, behaviors[type].macro,
+				   g->active[type] ? "true" : "false", printed < BEHAVIOR_TYPES ? "," : "");
+		}
+	}
+	printf("};\n");
+}
+
+int main(int argc, char **argv)
+{
+	static evolution run;
+	run.program = EVOLVE_PROGRAM;
+	run.workers = work_pool_cores();
+	run.seeds = EVOLVE_SEEDS;
+	run.seconds = EVOLVE_SECONDS;
+	run.timeout = MISSION_TIMEOUT;
+	int size = EVOLVE_POPULATION, generations = EVOLVE_GENERATIONS, stall = EVOLVE_STALL;
+	unsigned int seed = 1;
+	for (int arg = 1; arg < argc; arg++) {
+		const char *option = argv[arg];
+		if (arg + 1 >= argc || option[0] != '-' || strlen(option) != 2) {
+			fprintf(stderr, "usage: %s [-j workers] [-P population] [-g generations] [-S stall] [-n seeds] "
+					"[-s seconds] [-w timeout] [-r seed] [-p program]\n", argv[0]);
+			return 2;
+		}
+		const char *value = argv[++arg];
+		switch (option[1]) {
+		case 'j': run.workers = atoi(value); break;
+		case 'P': size = atoi(value); break;
+		case 'g': generations = atoi(value); break;
+		case 'S': stall = atoi(value); break;
+		case 'n': run.seeds = atoi(value); break;
+		case 's': run.seconds = atof(value); break;
+		case 'w': run.timeout = atof(value); break;
+		case 'r': seed = (unsigned int)strtoul(value, NULL, 10); break;
+		case 'p': run.program = value; break;
+		default:
+			fprintf(stderr, "unknown option %s\n", option);
+			return 2;
+		}
+	}
+	size = size < EVOLVE_ELITE + 1 ? EVOLVE_ELITE + 1 : size;
+	run.seeds = run.seeds < 1 ? 1 : run.seeds;
+
+	genome *population = malloc(size * sizeof(genome));
+	genome *next = malloc(size * sizeof(genome));
+	run.candidates = malloc(size * sizeof(candidate));
+	run.cache = calloc(CACHE_SIZE, sizeof(cache_slot));
+	if (!population || !next || !run.candidates || !run.cache) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	pthread_mutex_init(&run.results_lock, NULL);
+
+	default_genome(&population[0]);
+	for (int i = 1; i < size; i++) {
+		random_genome(&population[i], &seed);
+	}
+	printf("population %d, %d seeds of %.0f simulated seconds per hierarchy, %d workers (%s)\n", size, run.seeds,
+		   run.seconds, run.workers, run.program);
+
+	double t0 = now_seconds();
+	if (!evaluate(&run, population, size)) {
+		fprintf(stderr, "cannot start the workers\n");
+		return 1;
+	}
+	double baseline = population[0].fitness;
+	genome best = population[0];
+	int since_best = 0;
+	for (int generation = 1; generation <= generations && since_best < stall; generation++) {
+		qsort(population, size, sizeof(genome), by_fitness);
+		if (population[0].fitness > best.fitness) {
+			best = population[0];
+			since_best = 0;
+		} else {
+			since_best++;
+		}
+		double mean = 0;
+		for (int i = 0; i < size; i++) {
+			mean += population[i].fitness / size;
+		}
+		printf("generation %2d: best %7.2f, mean %7.2f, %d hierarchies simulated, %d cache hits, %.1f s\n",
+			   generation, population[0].fitness, mean, run.cached, run.hits, now_seconds() - t0);
+		fflush(stdout);
+
+		memcpy(next, population, EVOLVE_ELITE * sizeof(genome));
+		for (int i = EVOLVE_ELITE; i < size; i++) {
+			breed(tournament(population, size, &seed), tournament(population, size, &seed), &next[i], &seed);
+		}
+		genome *swap = population;
+		population = next;
+		next = swap;
+		if (!evaluate(&run, population, size)) {
+			fprintf(stderr, "cannot start the workers\n");
+			return 1;
+		}
+	}
+	qsort(population, size, sizeof(genome), by_fitness);
+	if (population[0].fitness > best.fitness) {
+		best = population[0];
+	}
+
+	printf("\n%ld missions in %.1f s (%ld timed out or failed); fitness %.2f, the shipped hierarchy %.2f\n\n",
+		   run.missions, now_seconds() - t0, run.failed, best.fitness, baseline);
+	if (run.pollinations == 0) {
+		printf("No mission pollinated a flower, so the fitness is coverage-based: "
+			   "%% of the arena covered - %.0f x bumps/min\n\n", EVOLVE_BUMP_WEIGHT);
+	} else {
+		printf("Fitness: %.0f x pollinations/min + %% of the arena covered - %.0f x bumps/min\n\n",
+			   EVOLVE_POLLINATION_WEIGHT, EVOLVE_BUMP_WEIGHT);
+	}
+	print_initializer(&best);
+	free(population);
+	free(next);
+	free(run.candidates);
+	free(run.cache);
+	return 0;
+}
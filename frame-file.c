@@ -0,0 +1,49 @@
+/*
+Frame files (see frame-file.h).
+*/
+
+#include "frame-file.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Load Netpbm: read a binary PGM/PPM with 8-bit samples and "depth" bytes per pixel
+static unsigned char *load_netpbm(const char *path, const char *magic, int depth, int *width, int *height)
+{
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return NULL;
+	}
+	char format[3] = {0};
+	int max_value;
+	unsigned char *pixels = NULL;
+	if (fscanf(file, "%2s %d %d %d", format, width, height, &max_value) == 4 && format[0] == magic[0]
+		&& format[1] == magic[1] && max_value == 255 && fgetc(file) != EOF) {
+		size_t count = (size_t)*width * *height;
+		pixels = malloc(depth * count);
+		if (pixels && fread(pixels, depth, count, file) != count) {
+			free(pixels);
+			pixels = NULL;
+		}
+	}
+	fclose(file);
+	return pixels;
+}
+
+unsigned char *frame_load_ppm(const char *path, int *width, int *height)
+{
+	unsigned char *bgr = load_netpbm(path, "P6", 3, width, height);
+	if (bgr) {
+		int pixels = *width * *height;
+		for (int i = 0; i < pixels; i++) {
+			unsigned char red = bgr[3 * i];
+			bgr[3 * i] = bgr[3 * i + 2]; // PPM is RGB, the camera gives BGR
+			bgr[3 * i + 2] = red;
+		}
+	}
+	return bgr;
+}
+
+unsigned char *frame_load_pgm(const char *path, int *width, int *height)
+{
+	return load_netpbm(path, "P5", 1, width, height);
+}
@@ -0,0 +1,17 @@
+/*
+Frame files for the off-robot tools and benchmarks.
+
+Recorded camera frames are kept as binary PPM (P6) and calibration labels as binary PGM (P5), so any image viewer or
+editor can open and paint them. Frames come back as interleaved BGR like KIPR get_camera_frame().
+*/
+
+#ifndef FRAME_FILE_H
+#define FRAME_FILE_H
+
+// Load PPM: read a binary PPM into a newly allocated BGR buffer; NULL on failure
+unsigned char *frame_load_ppm(const char *path, int *width, int *height);
+
+// Load PGM: read a binary PGM into a newly allocated buffer, one byte per pixel; NULL on failure
+unsigned char *frame_load_pgm(const char *path, int *width, int *height);
+
+#endif
@@ -0,0 +1,161 @@
+/*
+Run log backend for the headless Wombat library (see headless.h).
+
+Replays a run log recorded on the robot (run-log.h) in real time: the camera sees the recorded frames and the sensors
+read the recorded values, both at the moment of the run at which they were recorded. The program ends with the log.
+
+Sensor records hold the values in the order the robot program logged them, so the pins they came from are given in
+WOMBAT_LOG_PINS, e.g. "a2,a3,d2,d0,d1" (analog 2, analog 3, digital 2, digital 0, digital 1), which is also the default
+and the order ethology-code.c logs in.
+*/
+
+#include "headless.h"
+#include "../run-log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_DEFAULT_PINS "a2,a3,d2,d0,d1"
+
+typedef struct log_entry {
+	unsigned long time;      // ms since the start of the recording
+	const void *payload;
+} log_entry;
+
+static run_log_reader reader;
+static log_entry *sensors, *frames;
+static int sensor_count, frame_count;
+static unsigned long log_length;
+static char pin_kind[RUN_LOG_SENSORS];  // 'a' or 'd' for each logged value
+static int pin_port[RUN_LOG_SENSORS];
+static int pin_count;
+
+// Read Pins: parse WOMBAT_LOG_PINS
+static void read_pins()
+{
+	const char *pins = getenv("WOMBAT_LOG_PINS");
+	char list[256];
+	snprintf(list, sizeof(list), "%s", pins ? pins : LOG_DEFAULT_PINS);
+	pin_count = 0;
+	for (char *item = strtok(list, ", "); item && pin_count < RUN_LOG_SENSORS; item = strtok(NULL, ", ")) {
+		if ((item[0] == 'a' || item[0] == 'd') && item[1]) {
+			pin_kind[pin_count] = item[0];
+			pin_port[pin_count] = atoi(item + 1);
+			pin_count++;
+		}
+	}
+}
+
+// Holds: the record's payload is at least "bytes" long, so a damaged record is dropped rather than read past
+static bool holds(const run_record *record, unsigned long long bytes)
+{
+	return record->size >= bytes;
+}
+
+// Usable: a sensors record whose values all lie in its payload, or a frame with pixels and all of them present
+static bool usable(const run_record *record, const void *payload)
+{
+	if (record->type == RUN_SENSORS) {
+		const run_sensors *values = payload;
+		return holds(record, sizeof(int)) && values->count >= 0 && values->count <= RUN_LOG_SENSORS
+			&& holds(record, sizeof(int) * (1ull + values->count));
+	}
+	if (record->type == RUN_FRAME) {
+		const run_frame_header *frame = payload;
+		return holds(record, sizeof(run_frame_header)) && frame->width && frame->height
+			&& holds(record, sizeof(run_frame_header) + 3ull * frame->width * frame->height);
+	}
+	return false;
+}
+
+static bool log_open(const char *path)
+{
+	if (!path || !run_log_open(&reader, path)) {
+		return false;
+	}
+	read_pins();
+	sensors = malloc(reader.record_count * sizeof(log_entry));
+	frames = malloc(reader.record_count * sizeof(log_entry));
+	if (!sensors || !frames) {
+		return false;
+	}
+	unsigned long long start = reader.header->start_time;
+	const void *payload;
+	const run_record *record;
+	while ((record = run_log_next(&reader, &payload))) {
+		unsigned long time = record->time > start ? (unsigned long)(record->time - start) : 0;
+		if (!usable(record, payload)) {
+			// not a sensors or frame record, or a damaged one, which is left out of the replay
+		} else if (record->type == RUN_SENSORS) {
+			sensors[sensor_count++] = (log_entry){time, payload};
+		} else if (record->type == RUN_FRAME) {
+			frames[frame_count++] = (log_entry){time, payload};
+		}
+		if (time > log_length) {
+			log_length = time;
+		}
+	}
+	return true;
+}
+
+// Latest: the last entry at or before "time" (records are in time order), NULL if none
+static const log_entry *latest(const log_entry *entries, int count, unsigned long time)
+{
+	int low = 0, high = count - 1, found = -1;
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		if (entries[middle].time <= time) {
+			found = middle;
+			low = middle + 1;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return found < 0 ? NULL : &entries[found];
+}
+
+static int sensor_value(char kind, int port, unsigned long time)
+{
+	const log_entry *entry = latest(sensors, sensor_count, time);
+	if (!entry) {
+		return 0;
+	}
+	const run_sensors *values = entry->payload;
+	for (int i = 0; i < pin_count && i < values->count; i++) {
+		if (pin_kind[i] == kind && pin_port[i] == port) {
+			return values->values[i];
+		}
+	}
+	return 0;
+}
+
+static int log_analog(int port, unsigned long time)
+{
+	return sensor_value('a', port, time);
+}
+
+static int log_digital(int port, unsigned long time)
+{
+	return sensor_value('d', port, time);
+}
+
+static const unsigned char *log_frame(unsigned long time, int *width, int *height)
+{
+	const log_entry *entry = latest(frames, frame_count, time);
+	if (!entry) {
+		return NULL;
+	}
+	const run_frame_header *frame = entry->payload;
+	*width = (int)frame->width;
+	*height = (int)frame->height;
+	return (const unsigned char *)(frame + 1);
+}
+
+static unsigned long log_duration()
+{
+	return log_length + 1;
+}
+
+const headless_backend headless_log_backend = {
+	"log", log_open, log_analog, log_digital, NULL, log_frame, log_duration
+};
@@ -0,0 +1,225 @@
+/*
+Scripted backend for the headless Wombat library (see headless.h).
+
+A script is a text file of timed events, one per line; a value holds from its time until the next event for the same
+port, and the camera shows the newest frame event. Times are milliseconds of run time, lines may come in any order,
+and # starts a comment:
+
+    0      analog 2 900          # IR on port 2 reads 900
+    2500   digital 0 1           # back bumper on port 0 pressed ...
+    2600   digital 0 0           # ... and released
+    0      frame synthetic 7     # a synthetic scene (synthetic-frame.c) with seed 7
+    4000   frame empty           # just the floor
+    6000   frame file flower.ppm # a recorded frame
+    8000   frame approach 12     # step 12 of a synthetic approach
+
+Without a script every sensor reads 0 and the camera sees an empty floor.
+*/
+
+#include "headless.h"
+#include "../frame-file.h"
+#include "../synthetic-frame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCRIPT_PORTS 16
+
+typedef struct script_value {
+	unsigned long time;
+	int value;
+} script_value;
+
+typedef struct script_frame {
+	unsigned long time;
+	unsigned char *bgr;
+	int width, height;
+} script_frame;
+
+typedef struct script_track {
+	script_value *values;   // sorted by time
+	int count, capacity;
+} script_track;
+
+static script_track analog_tracks[SCRIPT_PORTS], digital_tracks[SCRIPT_PORTS];
+static script_frame *frames;  // sorted by time
+static int frame_count, frame_capacity;
+static unsigned char *floor_frame;
+
+static int by_value_time(const void *a, const void *b)
+{
+	unsigned long ta = ((const script_value *)a)->time, tb = ((const script_value *)b)->time;
+	return ta < tb ? -1 : ta > tb;
+}
+
+static int by_frame_time(const void *a, const void *b)
+{
+	unsigned long ta = ((const script_frame *)a)->time, tb = ((const script_frame *)b)->time;
+	return ta < tb ? -1 : ta > tb;
+}
+
+static bool add_value(script_track *track, unsigned long time, int value)
+{
+	if (track->count == track->capacity) {
+		int capacity = track->capacity ? 2 * track->capacity : 16;
+		script_value *values = realloc(track->values, capacity * sizeof(script_value));
+		if (!values) {
+			return false;
+		}
+		track->values = values;
+		track->capacity = capacity;
+	}
+	track->values[track->count++] = (script_value){time, value};
+	return true;
+}
+
+static bool add_frame(unsigned long time, unsigned char *bgr, int width, int height)
+{
+	if (!bgr) {
+		return false;
+	}
+	if (frame_count == frame_capacity) {
+		int capacity = frame_capacity ? 2 * frame_capacity : 16;
+		script_frame *grown = realloc(frames, capacity * sizeof(script_frame));
+		if (!grown) {
+			free(bgr);
+			return false;
+		}
+		frames = grown;
+		frame_capacity = capacity;
+	}
+	frames[frame_count++] = (script_frame){time, bgr, width, height};
+	return true;
+}
+
+// Synthetic: a new frame of the default size drawn by one of the synthetic-frame.c scenes
+static unsigned char *synthetic(const char *scene, int number)
+{
+	unsigned char *bgr = malloc((size_t)3 * HEADLESS_CAMERA_WIDTH * HEADLESS_CAMERA_HEIGHT);
+	if (!bgr) {
+		return NULL;
+	}
+	if (strcmp(scene, "synthetic") == 0) {
+		synth_frame(bgr, HEADLESS_CAMERA_WIDTH, HEADLESS_CAMERA_HEIGHT, (unsigned int)number);
+	} else if (strcmp(scene, "approach") == 0) {
+		synth_approach_frame(bgr, HEADLESS_CAMERA_WIDTH, HEADLESS_CAMERA_HEIGHT, number);
+	} else {
+		synth_empty_frame(bgr, HEADLESS_CAMERA_WIDTH, HEADLESS_CAMERA_HEIGHT, (unsigned int)number);
+	}
+	return bgr;
+}
+
+// Parse Line: one event; false on a line that is not a valid event
+static bool parse_line(char *line)
+{
+	char *comment = strchr(line, '#');
+	if (comment) {
+		*comment = '\0';
+	}
+	unsigned long time;
+	char kind[16], argument[256];
+	int port, value;
+	if (sscanf(line, " %lu %15s", &time, kind) != 2) {
+		return sscanf(line, " %15s", kind) != 1; // blank lines are fine
+	}
+	if (strcmp(kind, "analog") == 0 || strcmp(kind, "digital") == 0) {
+		if (sscanf(line, " %*u %*s %d %d", &port, &value) != 2 || port < 0 || port >= SCRIPT_PORTS) {
+			return false;
+		}
+		return add_value(kind[0] == 'a' ? &analog_tracks[port] : &digital_tracks[port], time, value);
+	}
+	if (strcmp(kind, "frame") == 0) {
+		int number = 0;
+		if (sscanf(line, " %*u %*s file %255s", argument) == 1) {
+			int width, height;
+			unsigned char *bgr = frame_load_ppm(argument, &width, &height);
+			return add_frame(time, bgr, width, height);
+		}
+		if (sscanf(line, " %*u %*s %255s %d", argument, &number) < 1) {
+			return false;
+		}
+		return add_frame(time, synthetic(argument, number), HEADLESS_CAMERA_WIDTH, HEADLESS_CAMERA_HEIGHT);
+	}
+	return false;
+}
+
+static bool script_open(const char *path)
+{
+	floor_frame = synthetic("empty", 0);
+	if (!path || !*path) {
+		return floor_frame != NULL;
+	}
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		return false;
+	}
+	char line[512];
+	int number = 0;
+	while (fgets(line, sizeof(line), file)) {
+		number++;
+		if (!parse_line(line)) {
+			fprintf(stderr, "%s:%d: cannot use \"%s\"\n", path, number, strtok(line, "\n"));
+		}
+	}
+	fclose(file);
+	for (int port = 0; port < SCRIPT_PORTS; port++) {
+		qsort(analog_tracks[port].values, analog_tracks[port].count, sizeof(script_value), by_value_time);
+		qsort(digital_tracks[port].values, digital_tracks[port].count, sizeof(script_value), by_value_time);
+	}
+	qsort(frames, frame_count, sizeof(script_frame), by_frame_time);
+	return true;
+}
+
+// Latest: index of the last entry at or before "time" in a sorted list of "count" entries, -1 if none
+#define LATEST(list, count, time, result) \
+	do { \
+		int low = 0, high = (count) - 1; \
+		(result) = -1; \
+		while (low <= high) { \
+			int middle = (low + high) / 2; \
+			if ((list)[middle].time <= (time)) { \
+				(result) = middle; \
+				low = middle + 1; \
+			} else { \
+				high = middle - 1; \
+			} \
+		} \
+	} while (0)
+
+static int value_at(const script_track *tracks, int port, unsigned long time)
+{
+	if (port < 0 || port >= SCRIPT_PORTS) {
+		return 0;
+	}
+	int index;
+	LATEST(tracks[port].values, tracks[port].count, time, index);
+	return index < 0 ? 0 : tracks[port].values[index].value;
+}
+
+static int script_analog(int port, unsigned long time)
+{
+	return value_at(analog_tracks, port, time);
+}
+
+static int script_digital(int port, unsigned long time)
+{
+	return value_at(digital_tracks, port, time);
+}
+
+static const unsigned char *script_frame_at(unsigned long time, int *width, int *height)
+{
+	int index;
+	LATEST(frames, frame_count, time, index);
+	if (index < 0) {
+		*width = HEADLESS_CAMERA_WIDTH;
+		*height = HEADLESS_CAMERA_HEIGHT;
+		return floor_frame;
+	}
+	*width = frames[index].width;
+	*height = frames[index].height;
+	return frames[index].bgr;
+}
+
+const headless_backend headless_script_backend = {
+	"script", script_open, script_analog, script_digital, NULL, script_frame_at, NULL
+};
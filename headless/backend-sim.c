@@ -0,0 +1,551 @@
+/*
+Arena simulator backend for the headless Wombat library (see headless.h).
+
+A flat arena with walls, red flowers and blue pollen, and a differential-drive robot that moves by what its wheel
+servos are set to. The backend answers the robot's pins from the robot's pose: the IR sensors fall off with the
+distance to the wall they point at, the bumpers close while the robot presses against a wall, and the camera sees a
+rendered view of every flower in front of it. Closing the gripper picks up the object within reach, opening it puts
+the object down again. Together with a ROBOT_VIRTUAL_TIME build (see robot-clock.h), whose clock only moves when the
+program sleeps, a ten-minute mission runs in a fraction of a second.
+
+WOMBAT_BACKEND=sim draws a random arena with seed 1, sim:<seed> one with another seed, and sim:<file> reads an arena:
+
+    arena 300 200        # width and height in cm; walls all around
+    robot 40 100 0       # start pose: x y (cm) and heading (degrees, counterclockwise from +x)
+    red 150 80 5         # a flower: x y radius (cm)
+    blue 220 150 8       # pollen
+    wall 100 0 100 60    # an extra wall from x1 y1 to x2 y2
+    light 300 100        # a light for the photo sensors
+
+At exit one line sums up the run on stderr: simulated time, distance driven, bumps, pickups, pollinations (objects moved
+next to one of the other color), how many red flowers ended up with pollen next to them, and how much of the arena
+the robot covered (the share of 10 cm squares its center passed through).
+
+Pins are those of the pollinator robots: wheels on servo ports 0 (right) and 1 (left), gripper 2; photo sensors on
+analog 0 (right) and 1 (left), IR on analog 2 (right) and 3 (left); back bumpers on digital 0-2 (center, right, left)
+and front bumpers on digital 3-5 (center, right, left). The wheels turn the way the default calibration in servo-cal.h
+says.
+*/
+
+#include "headless.h"
+#include "../servo-cal.h"
+#include <math.h>
+#include <pthread.h>  // backends may be called from several threads
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_MAX_OBJECTS 64
+#define SIM_MAX_WALLS 64
+#define SIM_STEP 5                // ms per integration step
+
+#define SIM_ROBOT_RADIUS 12.0f    // cm
+#define SIM_WHEEL_BASE 16.0f      // cm between the wheels
+#define SIM_WHEEL_SPEED 30.0f     // cm/s at full speed
+#define SIM_CONTACT 0.5f          // cm from a wall at which a bumper closes
+
+#define SIM_IR_ANGLE 0.52f        // rad either side of the heading the IR sensors look (30 degrees)
+#define SIM_IR_NEAR 10.0f         // cm from the robot at which an IR sensor saturates
+#define SIM_IR_AMBIENT 100        // reading with nothing in range
+#define SIM_PHOTO_ANGLE 0.79f     // rad either side of the heading the photo sensors look (45 degrees)
+#define SIM_PHOTO_NEAR 30.0f      // cm from the light at which a photo sensor saturates
+
+#define SIM_CAMERA_FOV 1.05f      // rad of horizontal field of view (60 degrees)
+#define SIM_CAMERA_HEIGHT 10.0f   // cm above the floor
+#define SIM_HORIZON 10            // image row of the horizon (the camera looks slightly down)
+
+#define SIM_GRIP_REACH 15.0f      // cm past the front of the robot the gripper can take an object from
+#define SIM_POLLINATED 30.0f      // cm between a flower and pollen for the flower to count as pollinated
+#define SIM_CELL 10.0f            // cm per side of the squares the arena is divided into for coverage
+
+#define SIM_RIGHT_MOTOR 0
+#define SIM_LEFT_MOTOR 1
+#define SIM_GRIPPER 2
+
+#define SIM_RED 0
+#define SIM_BLUE 1
+
+typedef struct sim_object {
+	float x, y, radius;
+	int color;       // SIM_RED or SIM_BLUE
+	bool held;       // in the gripper
+} sim_object;
+
+typedef struct sim_wall {
+	float x1, y1, x2, y2;
+} sim_wall;
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static float arena_width = 300, arena_height = 200;
+static sim_object objects[SIM_MAX_OBJECTS];
+static int object_count;
+static sim_wall walls[SIM_MAX_WALLS];
+static int wall_count;
+static bool has_light;
+static float light_x, light_y;
+
+// Robot state
+static float robot_x = 40, robot_y = 100, robot_heading;
+static float left_speed, right_speed;    // cm/s
+static bool gripper_closed;
+static int held = -1;                    // object in the gripper
+static bool held_pollinated;             // it was already next to the other color when picked up
+static unsigned int contacts;            // bumper bits by digital port
+static unsigned long sim_time;           // ms of run time simulated so far
+static servo_calibration wheels;
+
+// Run summary
+static float distance;
+static int bumps, pickups, drops, pollinations;
+static unsigned char *visited;           // one byte per coverage cell, set once the robot's center has been in it
+static int cells_x, cells_y, cells_visited;
+
+static unsigned char frame[3 * HEADLESS_CAMERA_WIDTH * HEADLESS_CAMERA_HEIGHT];
+static unsigned char background[3 * HEADLESS_CAMERA_WIDTH * HEADLESS_CAMERA_HEIGHT];
+
+//===================================//
+//===============ARENA===============//
+//===================================//
+
+static void add_wall(float x1, float y1, float x2, float y2)
+{
+	if (wall_count < SIM_MAX_WALLS) {
+		walls[wall_count++] = (sim_wall){x1, y1, x2, y2};
+	}
+}
+
+static void add_object(float x, float y, float radius, int color)
+{
+	if (object_count < SIM_MAX_OBJECTS) {
+		objects[object_count++] = (sim_object){x, y, radius, color, false};
+	}
+}
+
+// Random Arena: six flowers and three pollen spread over the default arena, apart from each other and the start
+static void random_arena(unsigned int seed)
+{
+	static const int colors[] = {SIM_RED, SIM_RED, SIM_RED, SIM_RED, SIM_RED, SIM_RED, SIM_BLUE, SIM_BLUE, SIM_BLUE};
+	for (int i = 0; i < 9; i++) {
+		float x, y;
+		bool clear;
+		int tries = 0;
+		do {
+			x = 30 + (float)rand_r(&seed) / RAND_MAX * (arena_width - 60);
+			y = 30 + (float)rand_r(&seed) / RAND_MAX * (arena_height - 60);
+			clear = hypotf(x - robot_x, y - robot_y) > 40;
+			for (int j = 0; j < object_count && clear; j++) {
+				clear = hypotf(x - objects[j].x, y - objects[j].y) > 30;
+			}
+		} while (!clear && ++tries < 100);
+		add_object(x, y, colors[i] == SIM_RED ? 5 : 8, colors[i]);
+	}
+	robot_heading = (float)rand_r(&seed) / RAND_MAX * 2 * (float)M_PI;
+}
+
+// Read Arena: false if the file cannot be read or has a line that is not an arena line
+static bool read_arena(const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		return false;
+	}
+	char line[256];
+	bool sized = false, valid = true;
+	while (valid && fgets(line, sizeof(line), file)) {
+		char *comment = strchr(line, '#');
+		if (comment) {
+			*comment = '\0';
+		}
+		char kind[16];
+		float a, b, c, d;
+		int fields = sscanf(line, "%15s %f %f %f %f", kind, &a, &b, &c, &d);
+		if (fields <= 0) {
+			continue;
+		}
+		if (strcmp(kind, "arena") == 0 && fields >= 3) {
+			arena_width = a;
+			arena_height = b;
+			sized = true;
+		} else if (strcmp(kind, "robot") == 0 && fields >= 4) {
+			robot_x = a;
+			robot_y = b;
+			robot_heading = c * (float)M_PI / 180;
+		} else if ((strcmp(kind, "red") == 0 || strcmp(kind, "blue") == 0) && fields >= 4) {
+			add_object(a, b, c, kind[0] == 'r' ? SIM_RED : SIM_BLUE);
+		} else if (strcmp(kind, "wall") == 0 && fields == 5) {
+			add_wall(a, b, c, d);
+		} else if (strcmp(kind, "light") == 0 && fields >= 3) {
+			has_light = true;
+			light_x = a;
+			light_y = b;
+		} else {
+			fprintf(stderr, "sim: bad arena line: %s", line);
+			valid = false;
+		}
+	}
+	fclose(file);
+	if (!sized) {
+		fprintf(stderr, "sim: %s has no arena line\n", path);
+	}
+	return valid && sized;
+}
+
+//=====================================//
+//===============PHYSICS===============//
+//=====================================//
+
+// Wheel Speed: the fraction of full speed (-1 .. 1, positive is forward) a wheel turns at for a servo position
+static float wheel_speed(const servo_wheel *wheel, int position)
+{
+	if (position < 0 || (position >= wheel->stop_low && position <= wheel->stop_high)) {
+		return 0; // disabled or in the dead band
+	}
+	int edge = position > wheel->stop_high ? wheel->stop_high : wheel->stop_low;
+	bool forward = (wheel->forward_full > wheel->stop_high) == (position > wheel->stop_high);
+	int full = forward ? wheel->forward_full : wheel->reverse_full;
+	float fraction = full == edge ? 1 : (float)(position - edge) / (float)(full - edge);
+	fraction = fraction > 1 ? 1 : fraction;
+	return forward ? fraction : -fraction;
+}
+
+// Nearest Point: the point of a wall closest to (x, y)
+static void nearest_point(const sim_wall *wall, float x, float y, float *px, float *py)
+{
+	float dx = wall->x2 - wall->x1, dy = wall->y2 - wall->y1;
+	float length = dx * dx + dy * dy;
+	float t = length > 0 ? ((x - wall->x1) * dx + (y - wall->y1) * dy) / length : 0;
+	t = t < 0 ? 0 : t > 1 ? 1 : t;
+	*px = wall->x1 + t * dx;
+	*py = wall->y1 + t * dy;
+}
+
+// Bumper: the digital port of the bumper that closes for a contact "angle" rad from the heading (-pi .. pi)
+static int bumper(float angle)
+{
+	float side = fabsf(angle);
+	if (side < 0.52f) {
+		return 3;                     // front center
+	} else if (side < 1.57f) {
+		return angle > 0 ? 5 : 4;     // front left, front right
+	} else if (side < 2.62f) {
+		return angle > 0 ? 2 : 1;     // back left, back right
+	}
+	return 0;                         // back center
+}
+
+// Collide: push the robot out of every wall it overlaps and work out which bumpers that closes
+static unsigned int collide()
+{
+	unsigned int touching = 0;
+	for (int i = 0; i < wall_count; i++) {
+		float px, py;
+		nearest_point(&walls[i], robot_x, robot_y, &px, &py);
+		float dx = robot_x - px, dy = robot_y - py;
+		float gap = hypotf(dx, dy);
+		if (gap >= SIM_ROBOT_RADIUS + SIM_CONTACT || gap == 0) {
+			continue;
+		}
+		if (gap < SIM_ROBOT_RADIUS) {
+			robot_x += dx / gap * (SIM_ROBOT_RADIUS - gap);
+			robot_y += dy / gap * (SIM_ROBOT_RADIUS - gap);
+		}
+		float angle = atan2f(-dy, -dx) - robot_heading;
+		angle = remainderf(angle, 2 * (float)M_PI);
+		touching |= 1u << bumper(angle);
+	}
+	return touching;
+}
+
+// Visit: mark the coverage cell under the robot's center
+static void visit()
+{
+	int cx = (int)(robot_x / SIM_CELL), cy = (int)(robot_y / SIM_CELL);
+	if (visited && cx >= 0 && cx < cells_x && cy >= 0 && cy < cells_y && !visited[cy * cells_x + cx]) {
+		visited[cy * cells_x + cx] = 1;
+		cells_visited++;
+	}
+}
+
+// Advance: move the robot up to "time" in fixed steps
+static void advance(unsigned long time)
+{
+	while ((long)(time - sim_time) >= SIM_STEP) {
+		float dt = SIM_STEP / 1000.0f;
+		float speed = (left_speed + right_speed) / 2;
+		robot_heading += (right_speed - left_speed) / SIM_WHEEL_BASE * dt;
+		robot_x += speed * cosf(robot_heading) * dt;
+		robot_y += speed * sinf(robot_heading) * dt;
+		distance += fabsf(speed) * dt;
+		visit();
+		unsigned int touching = collide();
+		if (touching && !contacts) {
+			bumps++;
+		}
+		contacts = touching;
+		sim_time += SIM_STEP;
+	}
+	if (held >= 0) {
+		float reach = SIM_ROBOT_RADIUS + SIM_GRIP_REACH / 2;
+		objects[held].x = robot_x + reach * cosf(robot_heading);
+		objects[held].y = robot_y + reach * sinf(robot_heading);
+	}
+}
+
+// Pollinated: true if an object of the other color lies within SIM_POLLINATED of object "i"
+static bool pollinated(int i)
+{
+	for (int j = 0; j < object_count; j++) {
+		if (objects[j].color != objects[i].color && !objects[j].held
+			&& hypotf(objects[i].x - objects[j].x, objects[i].y - objects[j].y) < SIM_POLLINATED) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Grip: pick up the nearest object within reach when the gripper closes, put it down when it opens; putting one
+// down next to an object of the other color, when it was not next to one before, is a pollination
+static void grip(bool closed)
+{
+	if (closed && !gripper_closed) {
+		float front_x = robot_x + SIM_ROBOT_RADIUS * cosf(robot_heading);
+		float front_y = robot_y + SIM_ROBOT_RADIUS * sinf(robot_heading);
+		float best = SIM_GRIP_REACH;
+		for (int i = 0; i < object_count; i++) {
+			float gap = hypotf(objects[i].x - front_x, objects[i].y - front_y) - objects[i].radius;
+			if (!objects[i].held && gap < best) {
+				best = gap;
+				held = i;
+			}
+		}
+		if (held >= 0) {
+			held_pollinated = pollinated(held);
+			objects[held].held = true;
+			pickups++;
+		}
+	} else if (!closed && gripper_closed && held >= 0) {
+		objects[held].held = false;
+		pollinations += pollinated(held) && !held_pollinated;
+		held = -1;
+		drops++;
+	}
+	gripper_closed = closed;
+}
+
+//=====================================//
+//===============SENSORS===============//
+//=====================================//
+
+// Ray: distance from the robot's center to the nearest wall along "angle" (absolute), or INFINITY
+static float ray(float angle)
+{
+	float dx = cosf(angle), dy = sinf(angle);
+	float nearest = INFINITY;
+	for (int i = 0; i < wall_count; i++) {
+		const sim_wall *wall = &walls[i];
+		float ex = wall->x2 - wall->x1, ey = wall->y2 - wall->y1;
+		float denominator = dx * ey - dy * ex;
+		if (fabsf(denominator) < 1e-6f) {
+			continue; // parallel
+		}
+		float wx = wall->x1 - robot_x, wy = wall->y1 - robot_y;
+		float t = (wx * ey - wy * ex) / denominator;  // along the ray
+		float u = (wx * dy - wy * dx) / denominator;  // along the wall
+		if (t >= 0 && u >= 0 && u <= 1 && t < nearest) {
+			nearest = t;
+		}
+	}
+	return nearest;
+}
+
+static int ir(float side)
+{
+	float gap = ray(robot_heading + side) - SIM_ROBOT_RADIUS;
+	if (gap <= SIM_IR_NEAR) {
+		return 4095;
+	}
+	int value = (int)(4095 * SIM_IR_NEAR / gap);
+	return value > SIM_IR_AMBIENT ? value : SIM_IR_AMBIENT;
+}
+
+// Photo: lower is brighter, like the robot's photo resistors
+static int photo(float side)
+{
+	if (!has_light) {
+		return 4095;
+	}
+	float dx = light_x - robot_x, dy = light_y - robot_y;
+	float facing = cosf(atan2f(dy, dx) - robot_heading - side);
+	float near = SIM_PHOTO_NEAR / hypotf(dx, dy);
+	float brightness = (facing > 0 ? facing : 0) * (near < 1 ? near * near : 1);
+	return 4095 - (int)(4000 * brightness);
+}
+
+static int sim_analog(int port, unsigned long time)
+{
+	pthread_mutex_lock(&sim_lock);
+	advance(time);
+	int value = port == 0 ? photo(-SIM_PHOTO_ANGLE) : port == 1 ? photo(SIM_PHOTO_ANGLE)
+		: port == 2 ? ir(-SIM_IR_ANGLE) : port == 3 ? ir(SIM_IR_ANGLE) : 0;
+	pthread_mutex_unlock(&sim_lock);
+	return value;
+}
+
+static int sim_digital(int port, unsigned long time)
+{
+	pthread_mutex_lock(&sim_lock);
+	advance(time);
+	int value = port >= 0 && port < 32 && (contacts >> port & 1);
+	pthread_mutex_unlock(&sim_lock);
+	return value;
+}
+
+static void sim_servo(int port, int position, unsigned long time)
+{
+	pthread_mutex_lock(&sim_lock);
+	advance(time); // the old speeds hold up to now
+	if (port == SIM_LEFT_MOTOR) {
+		left_speed = wheel_speed(&wheels.left, position) * SIM_WHEEL_SPEED;
+	} else if (port == SIM_RIGHT_MOTOR) {
+		right_speed = wheel_speed(&wheels.right, position) * SIM_WHEEL_SPEED;
+	} else if (port == SIM_GRIPPER && position >= 0) {
+		grip(position >= 512);
+	}
+	pthread_mutex_unlock(&sim_lock);
+}
+
+//====================================//
+//===============CAMERA===============//
+//====================================//
+
+typedef struct sim_view {
+	float depth;      // cm in front of the camera
+	int x, y, radius; // circle in the image
+	int color;
+} sim_view;
+
+static void draw_disc(const sim_view *view)
+{
+	static const unsigned char colors[2][3] = {{40, 40, 200}, {190, 60, 40}}; // BGR, as in synthetic-frame.c
+	const unsigned char *color = colors[view->color];
+	int top = view->y - view->radius < 0 ? 0 : view->y - view->radius;
+	int bottom = view->y + view->radius >= HEADLESS_CAMERA_HEIGHT ? HEADLESS_CAMERA_HEIGHT - 1 : view->y + view->radius;
+	for (int row = top; row <= bottom; row++) {
+		int dy = row - view->y;
+		int half = (int)sqrtf((float)(view->radius * view->radius - dy * dy));
+		int left = view->x - half < 0 ? 0 : view->x - half;
+		int right = view->x + half >= HEADLESS_CAMERA_WIDTH ? HEADLESS_CAMERA_WIDTH - 1 : view->x + half;
+		unsigned char *pixel = frame + 3 * (row * HEADLESS_CAMERA_WIDTH + left);
+		for (int column = left; column <= right; column++, pixel += 3) {
+			pixel[0] = color[0];
+			pixel[1] = color[1];
+			pixel[2] = color[2];
+		}
+	}
+}
+
+// Render: the floor, then every object in view from the farthest to the nearest so near ones cover far ones
+static void render()
+{
+	memcpy(frame, background, sizeof(frame));
+	float focal = HEADLESS_CAMERA_WIDTH / 2 / tanf(SIM_CAMERA_FOV / 2);
+	float forward_x = cosf(robot_heading), forward_y = sinf(robot_heading);
+	float camera_x = robot_x + SIM_ROBOT_RADIUS * forward_x, camera_y = robot_y + SIM_ROBOT_RADIUS * forward_y;
+	sim_view views[SIM_MAX_OBJECTS];
+	int count = 0;
+	for (int i = 0; i < object_count; i++) {
+		if (objects[i].held) {
+			continue;
+		}
+		float dx = objects[i].x - camera_x, dy = objects[i].y - camera_y;
+		float depth = dx * forward_x + dy * forward_y;
+		float lateral = dy * forward_x - dx * forward_y; // positive to the left
+		if (depth < 2) {
+			continue;
+		}
+		sim_view view;
+		view.depth = depth;
+		view.radius = (int)(focal * objects[i].radius / depth);
+		view.x = HEADLESS_CAMERA_WIDTH / 2 - (int)(focal * lateral / depth);
+		view.y = SIM_HORIZON + (int)(focal * SIM_CAMERA_HEIGHT / depth) - view.radius; // standing on the floor
+		view.color = objects[i].color;
+		if (view.radius < 1 || view.x + view.radius < 0 || view.x - view.radius >= HEADLESS_CAMERA_WIDTH
+			|| view.y - view.radius >= HEADLESS_CAMERA_HEIGHT) {
+			continue;
+		}
+		int at = count++;
+		while (at > 0 && views[at - 1].depth < depth) {
+			views[at] = views[at - 1];
+			at--;
+		}
+		views[at] = view;
+	}
+	for (int i = 0; i < count; i++) {
+		draw_disc(&views[i]);
+	}
+}
+
+static const unsigned char *sim_frame(unsigned long time, int *width, int *height)
+{
+	pthread_mutex_lock(&sim_lock);
+	advance(time);
+	render();
+	pthread_mutex_unlock(&sim_lock);
+	*width = HEADLESS_CAMERA_WIDTH;
+	*height = HEADLESS_CAMERA_HEIGHT;
+	return frame;
+}
+
+//===================================//
+//===============SETUP===============//
+//===================================//
+
+// Report: the run summary, printed at exit
+static void report()
+{
+	int flowers = 0, pollinated_flowers = 0;
+	for (int i = 0; i < object_count; i++) {
+		if (objects[i].color == SIM_RED) {
+			flowers++;
+			pollinated_flowers += !objects[i].held && pollinated(i);
+		}
+	}
+	fprintf(stderr, "sim: %.1f s, %.1f m driven, %d bumps, %d picked up, %d put down, %d pollinations, "
+			"%d of %d flowers pollinated, %.1f%% of the arena covered\n", sim_time / 1000.0, distance / 100, bumps,
+			pickups, drops, pollinations, pollinated_flowers, flowers, 100.0 * cells_visited / (cells_x * cells_y));
+}
+
+static bool sim_open(const char *argument)
+{
+	char *end = NULL;
+	unsigned long seed = argument ? strtoul(argument, &end, 10) : 1;
+	if (argument && *end != '\0') {
+		if (!read_arena(argument)) {
+			return false;
+		}
+	} else {
+		random_arena((unsigned int)seed);
+	}
+	add_wall(0, 0, arena_width, 0);
+	add_wall(arena_width, 0, arena_width, arena_height);
+	add_wall(arena_width, arena_height, 0, arena_height);
+	add_wall(0, arena_height, 0, 0);
+	servo_cal_default(&wheels);
+	cells_x = (int)ceilf(arena_width / SIM_CELL);
+	cells_y = (int)ceilf(arena_height / SIM_CELL);
+	cells_x = cells_x > 0 ? cells_x : 1;
+	cells_y = cells_y > 0 ? cells_y : 1;
+	visited = calloc((size_t)cells_x * cells_y, 1);
+	visit();
+
+	for (int row = 0; row < HEADLESS_CAMERA_HEIGHT; row++) {
+		unsigned char shade = row < SIM_HORIZON ? 220 : 150; // wall above the horizon, floor below
+		memset(background + 3 * row * HEADLESS_CAMERA_WIDTH, shade, 3 * HEADLESS_CAMERA_WIDTH);
+	}
+	atexit(report);
+	return true;
+}
+
+const headless_backend headless_sim_backend = {
+	"sim", sim_open, sim_analog, sim_digital, sim_servo, sim_frame, NULL
+};
@@ -0,0 +1,51 @@
+/*
+Backends for the headless Wombat stand-in (see include/kipr/wombat.h).
+
+A backend supplies what the hardware would: sensor values, camera frames, and optionally a reaction to servo commands
+(a simulator moves its robot, a script ignores them). All calls pass the run time in milliseconds since the program
+started, so a backend never needs its own clock. Backends may be called from several threads at once (the capture
+thread asks for frames while the control loop reads sensors) and lock what they need.
+
+The backend is chosen by the WOMBAT_BACKEND environment variable when the program first touches the library:
+
+    script[:file]   values and frames from a script (see backend-script.c); without a file every sensor reads 0
+                    and the camera sees an empty floor
+    log:run.log     sensors and frames replayed from a run log recorded on the robot (see backend-log.c)
+    sim[:arena]     a robot driving around a simulated arena (see backend-sim.c); the arena is a file or a seed
+
+A program (or a simulator linked into it) can also install its own with headless_set_backend before the first call.
+WOMBAT_RUN_SECONDS ends the program after that much run time, so robot programs whose main loop never returns can be
+benchmarked and profiled. In a ROBOT_VIRTUAL_TIME build (make sim) the run time is virtual and passes only while the
+program sleeps, so any backend runs as fast as the CPU allows.
+*/
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h> // Boolean support
+
+#define HEADLESS_SERVO_PORTS 4
+#define HEADLESS_CAMERA_WIDTH 160   // KIPR's default low resolution
+#define HEADLESS_CAMERA_HEIGHT 120
+#define HEADLESS_CAMERA_PERIOD 33   // ms between camera frames (30 fps)
+
+typedef struct headless_backend {
+	const char *name;
+	bool (*open)(const char *argument);                 // argument after the ':' in WOMBAT_BACKEND (may be NULL); false on error
+	int (*analog)(int port, unsigned long time);
+	int (*digital)(int port, unsigned long time);
+	void (*servo)(int port, int position, unsigned long time); // optional: a servo position changed
+	// Frame: the BGR frame the camera sees at "time" and its size; NULL if the backend has none
+	const unsigned char *(*frame)(unsigned long time, int *width, int *height);
+	unsigned long (*duration)();                        // optional: run time after which the backend has nothing left
+} headless_backend;
+
+void headless_set_backend(const headless_backend *backend, const char *argument); // before the first library call
+unsigned long headless_time();                        // run time in ms
+int headless_servo_position(int port);               // last position set, -1 if the servo is disabled
+
+extern const headless_backend headless_script_backend;
+extern const headless_backend headless_log_backend;
+extern const headless_backend headless_sim_backend;
+
+#endif
@@ -0,0 +1,57 @@
+/*
+Headless stand-in for the KIPR Wombat library.
+
+Declares the part of <kipr/wombat.h> the robot programs in this repository use, with the same names, types and
+signatures, so they build unchanged on any Linux box. The calls are implemented by headless/wombat.c on top of a
+pluggable backend (headless/headless.h) that supplies sensor values and camera frames: scripted values, a recorded
+run log, or a simulator.
+
+Add headless/include to the include path ahead of the real library (the Makefile does) and link the files in headless/.
+*/
+
+#ifndef KIPR_WOMBAT_H
+#define KIPR_WOMBAT_H
+
+#include <stdio.h>   // the real header pulls this in and the robot programs rely on it for printf
+
+typedef struct point2 {
+	int x, y;
+} point2;
+
+typedef struct rectangle {
+	int ulx, uly;
+	int width, height;
+} rectangle;
+
+// TIME
+unsigned long systime();                      // milliseconds since an arbitrary start
+void msleep(long milliseconds);
+
+// SENSORS
+int analog_et(int port);                      // analog value of an ET (IR) or photo sensor, 0 .. 4095
+int analog(int port);
+int digital(int port);                        // 1 while a bumper is pressed
+
+// SERVOS
+void enable_servo(int port);
+void disable_servo(int port);
+void enable_servos();
+void disable_servos();
+void set_servo_position(int port, int position);
+int get_servo_position(int port);
+
+// CAMERA
+int camera_open();
+int camera_load_config(const char *name);     // blockz-style channel configuration
+int camera_update();                          // blocks until the next frame
+void camera_close();
+int get_camera_width();
+int get_camera_height();
+const unsigned char *get_camera_frame();      // interleaved BGR
+int get_channel_count();
+int get_object_count(int channel);
+rectangle get_object_bbox(int channel, int object);
+point2 get_object_centroid(int channel, int object);
+int get_object_area(int channel, int object);
+
+#endif
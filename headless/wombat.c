@@ -0,0 +1,375 @@
+/*
+Headless Wombat library (see include/kipr/wombat.h and headless.h).
+
+Time is the monotonic clock, in milliseconds, so systime() agrees with robot_time() in robot-clock.c. The camera runs
+our own color segmentation (color-segment.c) over the backend's frames with the thresholds from camera_load_config,
+so get_object_* answer the way the channel tracker on the robot would.
+
+In a ROBOT_VIRTUAL_TIME build (see robot-clock.h) time is a virtual clock instead, which only msleep() moves forward
+(camera_update() sleeps for its frame the same way): a sleep returns at once with the clock that much later, so the
+program runs as fast as the CPU allows. Only one thread may sleep on that clock.
+*/
+
+#include "headless.h"
+#include <kipr/wombat.h>
+#include "../color-segment.h"
+#include "../color-lut.h"
+#include "../robot-clock.h" // ROBOT_VIRTUAL_TIME
+#include <pthread.h>     // backend selection, servo state
+#include <stdlib.h>      // getenv, exit, malloc
+#include <string.h>      // strchr, memset
+#include <time.h>        // clock_gettime, nanosleep
+
+static pthread_once_t setup_once = PTHREAD_ONCE_INIT;
+static const headless_backend *backend;
+static const char *backend_argument;
+static unsigned long start_time;        // monotonic ms when the library was first used
+static unsigned long run_limit;         // ms of run time before the program ends, 0 = none
+#if ROBOT_VIRTUAL_TIME
+static unsigned long virtual_time;      // run time in ms, moved forward by msleep
+static pthread_t clock_thread;          // the one thread that sleeps
+static bool clock_claimed;
+#endif
+
+static pthread_mutex_t servo_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool servo_enabled[HEADLESS_SERVO_PORTS];
+static int servo_position[HEADLESS_SERVO_PORTS];
+
+// Camera state, only touched by the thread that updates the camera
+static segmenter seg;
+static unsigned char *lut;              // from camera_load_config, NULL for the default colors
+static int lut_channels;
+static const unsigned char *camera_frame;
+static unsigned char *black_frame;      // shown while the backend has no frame
+static int camera_width = HEADLESS_CAMERA_WIDTH, camera_height = HEADLESS_CAMERA_HEIGHT;
+static unsigned long next_frame_time;
+
+static unsigned long monotonic_ms()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+// Setup: pick the backend named by WOMBAT_BACKEND unless the program installed one
+static void setup()
+{
+	start_time = monotonic_ms();
+	const char *seconds = getenv("WOMBAT_RUN_SECONDS");
+	if (seconds) {
+		run_limit = (unsigned long)(atof(seconds) * 1000);
+	}
+	if (!backend) {
+		const char *choice = getenv("WOMBAT_BACKEND");
+		static char name[64];
+		snprintf(name, sizeof(name), "%s", choice ? choice : "script");
+		char *colon = strchr(name, ':');
+		backend_argument = NULL;
+		if (colon) {
+			*colon = '\0';
+			backend_argument = choice + (colon - name) + 1;
+		}
+		backend = strcmp(name, "log") == 0 ? &headless_log_backend
+			: strcmp(name, "sim") == 0 ? &headless_sim_backend : &headless_script_backend;
+		if (strcmp(name, backend->name) != 0) {
+			fprintf(stderr, "headless: unknown backend \"%s\", using %s\n", name, backend->name);
+		}
+	}
+	if (backend->open && !backend->open(backend_argument)) {
+		fprintf(stderr, "headless: %s backend cannot open \"%s\"\n", backend->name,
+				backend_argument ? backend_argument : "");
+		exit(1);
+	}
+	if (!run_limit && backend->duration) {
+		run_limit = backend->duration();
+	}
+}
+
+void headless_set_backend(const headless_backend *chosen, const char *argument)
+{
+	backend = chosen;
+	backend_argument = argument;
+}
+
+// Now: run time, ending the program once it passes WOMBAT_RUN_SECONDS (or the end of a replayed log)
+static unsigned long now()
+{
+	pthread_once(&setup_once, setup);
+#if ROBOT_VIRTUAL_TIME
+	unsigned long time = virtual_time;
+#else
+	unsigned long time = monotonic_ms() - start_time;
+#endif
+	if (run_limit && time >= run_limit) {
+		fflush(stdout);
+		exit(0);
+	}
+	return time;
+}
+
+unsigned long headless_time()
+{
+	return now();
+}
+
+int headless_servo_position(int port)
+{
+	if (port < 0 || port >= HEADLESS_SERVO_PORTS) {
+		return -1;
+	}
+	pthread_mutex_lock(&servo_lock);
+	int position = servo_enabled[port] ? servo_position[port] : -1;
+	pthread_mutex_unlock(&servo_lock);
+	return position;
+}
+
+//==================================//
+//===============TIME===============//
+//==================================//
+
+unsigned long systime()
+{
+	unsigned long time = now(); // sets start_time on the first call
+	return start_time + time;
+}
+
+void msleep(long milliseconds)
+{
+	now();
+#if ROBOT_VIRTUAL_TIME
+	if (!clock_claimed) {
+		clock_thread = pthread_self();
+		clock_claimed = true;
+	} else if (!pthread_equal(clock_thread, pthread_self())) {
+		fprintf(stderr, "headless: a second thread sleeps on the virtual clock\n");
+		exit(1);
+	}
+	if (milliseconds > 0) {
+		virtual_time += milliseconds;
+	}
+#else
+	if (milliseconds > 0) {
+		struct timespec duration = {milliseconds / 1000, (milliseconds % 1000) * 1000000};
+		nanosleep(&duration, NULL);
+	}
+#endif
+	now();
+}
+
+//=====================================//
+//===============SENSORS===============//
+//=====================================//
+
+int analog_et(int port)
+{
+	unsigned long time = now();
+	return backend->analog ? backend->analog(port, time) : 0;
+}
+
+int analog(int port)
+{
+	return analog_et(port);
+}
+
+int digital(int port)
+{
+	unsigned long time = now();
+	return backend->digital ? backend->digital(port, time) : 0;
+}
+
+//====================================//
+//===============SERVOS===============//
+//====================================//
+
+// Servo: change one servo's state and tell the backend about the position it now holds
+static void servo(int port, bool enabled, int position)
+{
+	if (port < 0 || port >= HEADLESS_SERVO_PORTS) {
+		return;
+	}
+	unsigned long time = now();
+	pthread_mutex_lock(&servo_lock);
+	servo_enabled[port] = enabled;
+	servo_position[port] = position;
+	pthread_mutex_unlock(&servo_lock);
+	if (backend->servo) {
+		backend->servo(port, enabled ? position : -1, time);
+	}
+}
+
+void enable_servo(int port)
+{
+	servo(port, true, port >= 0 && port < HEADLESS_SERVO_PORTS ? servo_position[port] : 0);
+}
+
+void disable_servo(int port)
+{
+	servo(port, false, port >= 0 && port < HEADLESS_SERVO_PORTS ? servo_position[port] : 0);
+}
+
+void enable_servos()
+{
+	for (int port = 0; port < HEADLESS_SERVO_PORTS; port++) {
+		enable_servo(port);
+	}
+}
+
+void disable_servos()
+{
+	for (int port = 0; port < HEADLESS_SERVO_PORTS; port++) {
+		disable_servo(port);
+	}
+}
+
+void set_servo_position(int port, int position)
+{
+	if (port < 0 || port >= HEADLESS_SERVO_PORTS) {
+		return;
+	}
+	position = position < 0 ? 0 : position > 2047 ? 2047 : position;
+	servo(port, servo_enabled[port], position);
+}
+
+int get_servo_position(int port)
+{
+	if (port < 0 || port >= HEADLESS_SERVO_PORTS) {
+		return -1;
+	}
+	pthread_mutex_lock(&servo_lock);
+	int position = servo_position[port];
+	pthread_mutex_unlock(&servo_lock);
+	return position;
+}
+
+//====================================//
+//===============CAMERA===============//
+//====================================//
+
+int camera_open()
+{
+	next_frame_time = now();
+	return 1;
+}
+
+int camera_load_config(const char *name)
+{
+	lut_hsv_range ranges[SEG_MAX_CHANNELS];
+	int channels = lut_read_blockz(name, ranges, SEG_MAX_CHANNELS);
+	if (channels <= 0) {
+		return 0; // keep the default red and blue
+	}
+	if (!lut) {
+		lut = malloc(LUT_SIZE);
+		if (!lut) {
+			return 0;
+		}
+	}
+	lut_from_hsv(lut, ranges, channels);
+	lut_channels = channels;
+	if (seg.width) {
+		seg_set_lut(&seg, lut, lut_channels); // otherwise "fit" installs it with the first frame
+	}
+	return 1;
+}
+
+// Fit: make the segmenter (and the black frame) match a frame size; false if out of memory
+static bool fit(int width, int height)
+{
+	if (seg.width == width && seg.height == height) {
+		return true;
+	}
+	seg_free(&seg);
+	free(black_frame);
+	black_frame = calloc((size_t)3 * width * height, 1);
+	if (!black_frame || !seg_init(&seg, width, height)) {
+		return false;
+	}
+	seg_default_colors(&seg);
+	if (lut) {
+		seg_set_lut(&seg, lut, lut_channels);
+	}
+	camera_width = width;
+	camera_height = height;
+	return true;
+}
+
+int camera_update()
+{
+	// Frames come at the camera's rate: wait for the next one like the real camera_update does
+	unsigned long time = now();
+	if ((long)(next_frame_time - time) > 0) {
+		msleep((long)(next_frame_time - time));
+		time = now();
+	}
+	next_frame_time = time + HEADLESS_CAMERA_PERIOD;
+
+	int width = camera_width, height = camera_height;
+	const unsigned char *frame = backend->frame ? backend->frame(time, &width, &height) : NULL;
+	if (!fit(width, height)) {
+		return 0;
+	}
+	camera_frame = frame ? frame : black_frame;
+	seg_process(&seg, camera_frame);
+	return 1;
+}
+
+void camera_close()
+{
+	seg_free(&seg);
+	free(black_frame);
+	black_frame = NULL;
+	camera_frame = NULL;
+}
+
+int get_camera_width()
+{
+	return camera_width;
+}
+
+int get_camera_height()
+{
+	return camera_height;
+}
+
+const unsigned char *get_camera_frame()
+{
+	if (!camera_frame && fit(camera_width, camera_height)) {
+		camera_frame = black_frame;
+	}
+	return camera_frame;
+}
+
+int get_channel_count()
+{
+	return lut ? lut_channels : seg.channel_count;
+}
+
+int get_object_count(int channel)
+{
+	return seg.width ? seg_object_count(&seg, channel) : 0;
+}
+
+rectangle get_object_bbox(int channel, int object)
+{
+	rectangle box = {0, 0, 0, 0};
+	if (seg.width) {
+		seg_rect rect = seg_object_bbox(&seg, channel, object);
+		box = (rectangle){rect.ulx, rect.uly, rect.width, rect.height};
+	}
+	return box;
+}
+
+point2 get_object_centroid(int channel, int object)
+{
+	point2 point = {0, 0};
+	if (seg.width) {
+		seg_point centroid = seg_object_centroid(&seg, channel, object);
+		point = (point2){centroid.x, centroid.y};
+	}
+	return point;
+}
+
+int get_object_area(int channel, int object)
+{
+	return seg.width ? seg_object_area(&seg, channel, object) : 0;
+}
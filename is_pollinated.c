@@ -2,6 +2,8 @@
 #include <stdlib.h>       // General-purpose functions
 #include <stdbool.h>      // Boolean support
 #include <math.h>
+#include "robot-clock.h" // sleeping until the next deadline instead of polling the timer
+#include "servo-cal.h"   // calibrated wheel speed to servo position table
 
 // Define integer keys for each action type
 #define SEEK_LIGHT_TYPE 0
@@ -39,9 +41,23 @@ int hierarchy_length;
 int timer_duration = 500;
 unsigned long start_time = 0;
 bool have_pollen = false;
+servo_table wheels; // servo position for every wheel speed, built by "init_wheels"
+
+// Camera snapshot: every perception function reads the blobs of the current tick from here instead of updating the camera itself
+#define SNAPSHOT_CHANNELS 2 // channel 0 is red, channel 1 is blue
+
+typedef struct frame_snapshot {
+    int count[SNAPSHOT_CHANNELS];        // number of objects seen on each channel
+    rectangle bbox[SNAPSHOT_CHANNELS];   // bounding box of the largest object on each channel
+    point2 centroid[SNAPSHOT_CHANNELS];  // centroid of the largest object on each channel
+    int area[SNAPSHOT_CHANNELS];         // area of the largest object on each channel
+} frame_snapshot;
+
+frame_snapshot frame; // filled once per tick by "capture_frame"
 
 // Function Declarations
 void initialize_camera();
+void capture_frame(); // grab one camera frame and store its blobs in "frame"
 bool search_snapshot(int channel);
 void spin_search();
 void approach_object();
@@ -49,13 +65,14 @@ bool is_pollinated();
 void stop();
 void drive(float left, float right, float delay_seconds);
 bool timer_elapsed();
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high);
+void init_wheels(); // build the wheel table from this robot's calibration
 
 int spiral_length = 1; // Length of the forward movement, increases over time
 int spin_count = 0; // Global variable to track the number of spins
 
 // Main Function
 int main() {    
+    init_wheels();
     enable_servo(LEFT_MOTOR_PIN);
     enable_servo(RIGHT_MOTOR_PIN);
     enable_servo(GRIPPER_PIN);
@@ -66,8 +83,10 @@ int main() {
     initialize_camera();
 
     while (true) {
+        robot_sleep_until(start_time + timer_duration); // the current drive command runs until then
         if (!have_pollen) {
         if (timer_elapsed()) {
+            capture_frame(); // one camera frame per tick
             if (is_pollinated()) {
                 // Object detected, approach it
                 printf("pollinated!!");
@@ -89,14 +108,22 @@ void initialize_camera() {
     camera_open();
 }
 
-// Search Snapshot: Detects objects using the camera
-bool search_snapshot(int channel) {
-    
+// Capture Frame: Updates the camera once and stores the largest object of each channel
+void capture_frame() {
     camera_update();
-    
-    msleep(10);
-    
-    int object_count = get_object_count(channel);
+    for (int channel = 0; channel < SNAPSHOT_CHANNELS; channel++) {
+        frame.count[channel] = get_object_count(channel);
+        if (frame.count[channel] > 0) {
+            frame.bbox[channel] = get_object_bbox(channel, 0);
+            frame.centroid[channel] = get_object_centroid(channel, 0);
+            frame.area[channel] = get_object_area(channel, 0);
+        }
+    }
+}
+
+// Search Snapshot: Detects objects in the current frame
+bool search_snapshot(int channel) {
+    int object_count = frame.count[channel];
     
     if (object_count > 0) {
         printf("found");
@@ -105,20 +132,17 @@ bool search_snapshot(int channel) {
 }
 
 bool is_pollinated() {
-    camera_update();
-    msleep(10);
-
-    int red_count = get_object_count(0);
-    int blue_count = get_object_count(1);
+    int red_count = frame.count[0];
+    int blue_count = frame.count[1];
 
-    if (red_count + blue_count < 1){
+    if (red_count < 1 || blue_count < 1){
         return false;
     }
 
-    int redx  = (get_object_centroid(0, 0)).x ;
-    int redy  = (get_object_centroid(0, 0)).y ;
-    int bluex  = (get_object_centroid(1, 0)).x ;
-    int bluey  = (get_object_centroid(1, 0)).y ;
+    int redx  = frame.centroid[0].x ;
+    int redy  = frame.centroid[0].y ;
+    int bluex  = frame.centroid[1].x ;
+    int bluey  = frame.centroid[1].y ;
     
     int x = redx - bluex;
     int y = redy - bluey;
@@ -159,23 +183,26 @@ void stop() {
 
 // Drive Function: Controls motor speeds
 void drive(float left, float right, float delay_seconds) {
-    float left_speed = map(left, -1.0, 1.0, 0, 2047);
-    float right_speed = map(right, -1.0, 1.0, 2047, 0);
+    int left_speed = (int)(left * SERVO_SPEED_MAX); // per mille
+    int right_speed = (int)(right * SERVO_SPEED_MAX);
 
     timer_duration = (int)(delay_seconds * 1000);
-    start_time = systime();
+    start_time = robot_time();
 
-    set_servo_position(LEFT_MOTOR_PIN, left_speed);
-    set_servo_position(RIGHT_MOTOR_PIN, right_speed);
+    set_servo_position(LEFT_MOTOR_PIN, servo_position(wheels.left, left_speed));
+    set_servo_position(RIGHT_MOTOR_PIN, servo_position(wheels.right, right_speed));
 }
 
 // Timer Elapsed: Checks if specified duration has passed
 bool timer_elapsed() {
-    return (systime() > (start_time + timer_duration));
+    return (long)(robot_time() - (start_time + timer_duration)) >= 0;
 }
 
-// Map Function: Maps one range to another
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high) {
-    return target_range_low + ((value - start_range_low) / (start_range_high - start_range_low)) * (target_range_high - target_range_low);
+// Init Wheels: Builds the wheel table from this robot's calibration
+void init_wheels() {
+    servo_calibration calibration;
+    servo_cal_default(&calibration);
+    servo_cal_load(&calibration, SERVO_CAL_FILE); // this robot's own servos, if it has been calibrated
+    servo_cal_build(&wheels, &calibration);
 }
  
\ No newline at end of file
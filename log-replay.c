@@ -0,0 +1,194 @@
+/*
+Replays a run log recorded on the robot (run-log.h).
+
+Walks every record as fast as the disk delivers it and prints a summary of the run: how many frames, blob results,
+sensor passes, drive commands and notes it holds, over how long, and the replay throughput. With -v every record
+except the raw frames is printed with its time since the start of the run. With -s every frame is segmented again
+with our own pipeline (the default thresholds, or the lookup table given with -l) and compared with the blobs the
+robot recorded for it, which makes a recorded run a regression test for perception changes.
+
+Build and run on any Linux box:
+    gcc -O2 -o log-replay log-replay.c run-log.c color-segment.c color-lut.c blob-label.c -pthread
+    ./log-replay [-v] [-s] [-l color.lut] run.log
+*/
+
+#include "run-log.h"
+#include "color-lut.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CENTROID_TOLERANCE 2 // pixels a re-segmented centroid may move before it counts as a different result
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *type_name(unsigned int type)
+{
+	static const char *names[] = {"?", "frame", "blobs", "sensors", "drive", "note"};
+	return type <= RUN_NOTE ? names[type] : "?";
+}
+
+// Holds: the record's payload is at least "bytes" long, so a damaged record is skipped rather than read past
+static bool holds(const run_record *record, unsigned long long bytes)
+{
+	return record->size >= bytes;
+}
+
+// Print Record: one line per record for -v
+static void print_record(const run_record *record, const void *payload, unsigned long long start)
+{
+	printf("%10.3f  %-8s", (record->time - start) / 1000.0, type_name(record->type));
+	if (record->type == RUN_BLOBS && holds(record, sizeof(run_blobs))) {
+		const run_blobs *blobs = payload;
+		printf(" frame %llu:", blobs->sequence);
+		for (int channel = 0; channel < RUN_LOG_CHANNELS; channel++) {
+			printf(" ch%d %d", channel, blobs->count[channel]);
+			if (blobs->count[channel] > 0) {
+				const seg_blob *largest = &blobs->blobs[channel][0];
+				printf(" (%d,%d area %d)", largest->centroid.x, largest->centroid.y, largest->area);
+			}
+		}
+	} else if (record->type == RUN_SENSORS && holds(record, sizeof(run_sensors))) {
+		const run_sensors *sensors = payload;
+		for (int i = 0; i < sensors->count && i < RUN_LOG_SENSORS; i++) {
+			printf(" %d", sensors->values[i]);
+		}
+	} else if (record->type == RUN_DRIVE && holds(record, sizeof(run_drive))) {
+		const run_drive *drive = payload;
+		printf(" left %.2f right %.2f for %.2f s", drive->left, drive->right, drive->seconds);
+	} else if (record->type == RUN_NOTE) {
+		printf(" %.*s", (int)record->size, (const char *)payload);
+	}
+	printf("\n");
+}
+
+// Same Result: true if the re-segmented channel agrees with the recorded one on the count and the largest blob
+static bool same_result(const seg_channel *now, int count, const seg_blob *recorded)
+{
+	if (now->count != count) {
+		return false;
+	}
+	if (count == 0) {
+		return true;
+	}
+	int dx = now->blobs[0].centroid.x - recorded[0].centroid.x;
+	int dy = now->blobs[0].centroid.y - recorded[0].centroid.y;
+	return abs(dx) <= CENTROID_TOLERANCE && abs(dy) <= CENTROID_TOLERANCE;
+}
+
+int main(int argc, char **argv)
+{
+	bool verbose = false, segment = false;
+	const char *table_path = NULL;
+	const char *path = NULL;
+	for (int arg = 1; arg < argc; arg++) {
+		if (strcmp(argv[arg], "-v") == 0) {
+			verbose = true;
+		} else if (strcmp(argv[arg], "-s") == 0) {
+			segment = true;
+		} else if (strcmp(argv[arg], "-l") == 0 && arg + 1 < argc) {
+			table_path = argv[++arg];
+		} else {
+			path = argv[arg];
+		}
+	}
+	if (!path) {
+		fprintf(stderr, "usage: %s [-v] [-s] [-l color.lut] run.log\n", argv[0]);
+		return 2;
+	}
+
+	run_log_reader reader;
+	if (!run_log_open(&reader, path)) {
+		fprintf(stderr, "%s is not a run log\n", path);
+		return 1;
+	}
+	const unsigned char *table = NULL;
+	int table_channels = 0;
+	if (table_path && !(table = lut_map(table_path, &table_channels))) {
+		fprintf(stderr, "cannot map %s\n", table_path);
+		return 1;
+	}
+
+	segmenter seg;
+	memset(&seg, 0, sizeof(seg));
+	unsigned long long counts[RUN_NOTE + 1] = {0};
+	unsigned long long bytes = 0, first = 0, last = 0;
+	unsigned long long segmented = 0, mismatches = 0, last_frame = 0;
+	double segment_seconds = 0;
+	bool have_frame = false;
+
+	double t0 = now_seconds();
+	const void *payload;
+	const run_record *record;
+	while ((record = run_log_next(&reader, &payload))) {
+		counts[record->type <= RUN_NOTE ? record->type : 0]++;
+		bytes += sizeof(run_record) + record->size;
+		if (first == 0) {
+			first = record->time;
+		}
+		last = record->time;
+		if (verbose && record->type != RUN_FRAME) {
+			print_record(record, payload, reader.header->start_time);
+		}
+		if (!segment) {
+			continue;
+		}
+		const run_frame_header *frame = payload;
+		if (record->type == RUN_FRAME && holds(record, sizeof(run_frame_header)) && frame->width && frame->height
+			&& holds(record, sizeof(run_frame_header) + 3ull * frame->width * frame->height)) {
+			if (seg.width != (int)frame->width || seg.height != (int)frame->height) {
+				seg_free(&seg);
+				if (!seg_init(&seg, frame->width, frame->height)) {
+					fprintf(stderr, "out of memory\n");
+					return 1;
+				}
+				seg_default_colors(&seg);
+				seg_set_lut(&seg, table, table_channels);
+			}
+			double s0 = now_seconds();
+			seg_process(&seg, (const unsigned char *)(frame + 1));
+			segment_seconds += now_seconds() - s0;
+			segmented++;
+			last_frame = frame->sequence;
+			have_frame = true;
+		} else if (record->type == RUN_BLOBS && have_frame && holds(record, sizeof(run_blobs))) {
+			const run_blobs *blobs = payload;
+			if (blobs->sequence != last_frame) {
+				continue;
+			}
+			for (int channel = 0; channel < RUN_LOG_CHANNELS; channel++) {
+				if (!same_result(&seg.channels[channel], blobs->count[channel], blobs->blobs[channel])) {
+					mismatches++;
+					if (verbose) {
+						printf("           frame %llu channel %d: recorded %d blobs, now %d\n", blobs->sequence,
+							   channel, blobs->count[channel], seg.channels[channel].count);
+					}
+				}
+			}
+		}
+	}
+	double seconds = now_seconds() - t0;
+
+	printf("%s: %llu records over %.1f s of run time%s\n", path, reader.record_count, (last - first) / 1000.0,
+		   reader.rebuilt ? " (no index, recording did not stop cleanly)" : "");
+	for (unsigned int type = RUN_FRAME; type <= RUN_NOTE; type++) {
+		printf("  %-8s %llu\n", type_name(type), counts[type]);
+	}
+	printf("  replayed %.1f MB in %.3f s (%.1f MB/s, %.1f frames/s)\n", bytes / 1e6, seconds, bytes / 1e6 / seconds,
+		   counts[RUN_FRAME] / seconds);
+	if (segment) {
+		printf("  segmented %llu frames at %.1f frames/s, %llu channel results differ from the recording\n", segmented,
+			   segmented / (segment_seconds > 0 ? segment_seconds : 1), mismatches);
+	}
+
+	seg_free(&seg);
+	lut_unmap(table);
+	run_log_close(&reader);
+	return mismatches > 0;
+}
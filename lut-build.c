@@ -0,0 +1,129 @@
+/*
+Builds the RGB to color-channel lookup table the robot maps at startup (color-lut.h).
+
+The table starts from blockz.conf (-b, its HSV channels) or, without it, from our default red/blue thresholds.
+Labelled calibration captures then overrule it wherever they have enough samples: each capture is a binary PPM frame
+followed by a binary PGM of the same size whose pixels are 0 for background, 1 for red, 2 for blue and 255 for
+"don't know" (paint it in any image editor over a copy of the frame).
+
+Build and run on any Linux box:
+    gcc -O2 -o lut-build lut-build.c color-lut.c color-segment.c blob-label.c frame-file.c
+    ./lut-build [-b blockz.conf] [-o color.lut] [-n min_samples] [-s min_share_percent] [frame.ppm labels.pgm ...]
+Copy the output next to the robot program; camera-thread.c picks it up when it opens the camera.
+*/
+
+#include "color-lut.h"
+#include "frame-file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_OUTPUT "color.lut"
+#define DEFAULT_MIN_SAMPLES 4   // a cell needs this many labelled pixels before the calibration decides it
+#define DEFAULT_MIN_SHARE 50    // percent of a cell's labelled pixels a channel needs to own the cell
+
+// Count Cells: number of table cells that have the channel's bit set
+static int count_cells(const unsigned char *lut, int channel)
+{
+	int cells = 0;
+	for (int cell = 0; cell < LUT_SIZE; cell++) {
+		cells += (lut[cell] >> channel) & 1;
+	}
+	return cells;
+}
+
+int main(int argc, char **argv)
+{
+	const char *output = DEFAULT_OUTPUT;
+	const char *blockz = NULL;
+	int min_samples = DEFAULT_MIN_SAMPLES;
+	int min_share = DEFAULT_MIN_SHARE;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; arg++) {
+		if (arg + 1 >= argc) {
+			fprintf(stderr, "missing value for %s\n", argv[arg]);
+			return 1;
+		}
+		switch (argv[arg][1]) {
+		case 'o': output = argv[++arg]; break;
+		case 'b': blockz = argv[++arg]; break;
+		case 'n': min_samples = atoi(argv[++arg]); break;
+		case 's': min_share = atoi(argv[++arg]); break;
+		default:
+			fprintf(stderr, "usage: %s [-b blockz.conf] [-o color.lut] [-n min_samples] [-s min_share] "
+							"[frame.ppm labels.pgm ...]\n", argv[0]);
+			return 1;
+		}
+	}
+	if ((argc - arg) % 2 != 0) {
+		fprintf(stderr, "every calibration frame needs a label image\n");
+		return 1;
+	}
+
+	static unsigned char lut[LUT_SIZE];
+	int channels;
+	if (blockz) {
+		lut_hsv_range ranges[SEG_MAX_CHANNELS];
+		channels = lut_read_blockz(blockz, ranges, SEG_MAX_CHANNELS);
+		if (channels <= 0) {
+			fprintf(stderr, "no HSV channels in %s\n", blockz);
+			return 1;
+		}
+		lut_from_hsv(lut, ranges, channels);
+		for (int channel = 0; channel < channels; channel++) {
+			printf("channel %d from %s: hue %d-%d, saturation %d-%d, value %d-%d\n", channel, blockz,
+				   ranges[channel].bottom[0], ranges[channel].top[0], ranges[channel].bottom[1],
+				   ranges[channel].top[1], ranges[channel].bottom[2], ranges[channel].top[2]);
+		}
+	} else {
+		segmenter defaults; // only for its colors, nothing is allocated
+		memset(&defaults, 0, sizeof(defaults));
+		seg_default_colors(&defaults);
+		channels = defaults.channel_count;
+		lut_from_colors(lut, defaults.colors, channels);
+		printf("starting from the default red/blue thresholds\n");
+	}
+
+	if (arg < argc) {
+		lut_votes *votes = malloc(sizeof(lut_votes));
+		if (!votes) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		lut_votes_init(votes, channels);
+		for (; arg + 1 < argc; arg += 2) {
+			int width, height, label_width, label_height;
+			unsigned char *bgr = frame_load_ppm(argv[arg], &width, &height);
+			unsigned char *labels = frame_load_pgm(argv[arg + 1], &label_width, &label_height);
+			if (!bgr || !labels || width != label_width || height != label_height) {
+				fprintf(stderr, "cannot use %s with %s\n", argv[arg], argv[arg + 1]);
+				free(bgr);
+				free(labels);
+				free(votes);
+				return 1;
+			}
+			lut_votes_add(votes, bgr, labels, width * height);
+			free(bgr);
+			free(labels);
+		}
+		unsigned char before[LUT_SIZE];
+		memcpy(before, lut, LUT_SIZE);
+		lut_from_votes(lut, votes, min_samples, min_share);
+		int changed = 0;
+		for (int cell = 0; cell < LUT_SIZE; cell++) {
+			changed += lut[cell] != before[cell];
+		}
+		printf("calibration changed %d of %d cells\n", changed, LUT_SIZE);
+		free(votes);
+	}
+
+	for (int channel = 0; channel < channels; channel++) {
+		printf("channel %d: %d cells\n", channel, count_cells(lut, channel));
+	}
+	if (!lut_save(output, lut, channels)) {
+		fprintf(stderr, "cannot write %s\n", output);
+		return 1;
+	}
+	printf("wrote %s\n", output);
+	return 0;
+}
@@ -0,0 +1,145 @@
+/*
+Simulated missions (see mission.h).
+
+The program is started with posix_spawn rather than fork and exec, since the tools call this from many threads at
+once and a forked child of a threaded process may not call anything that allocates before it execs. Its stdout goes
+to /dev/null and its stderr into a pipe, which is read until it closes or the wall-clock limit runs out. The pipe is
+close-on-exec, so a mission started at the same time from another thread does not inherit it and hold it open.
+*/
+
+#define _GNU_SOURCE     // pipe2
+
+#include "mission.h"
+#include <fcntl.h>      // open, O_CLOEXEC
+#include <poll.h>       // waiting on the pipe with a time limit
+#include <signal.h>     // kill
+#include <spawn.h>      // posix_spawn
+#include <stdio.h>      // snprintf, sscanf
+#include <stdlib.h>     // malloc, free
+#include <string.h>     // strncmp, strstr
+#include <sys/wait.h>   // waitpid
+#include <time.h>       // clock_gettime
+#include <unistd.h>     // pipe, close, read
+
+#define MISSION_OUTPUT 4096 // bytes of stderr kept; the summary is the last line
+
+extern char **environ;
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Environment: ours with the simulator's variables added in front (a later duplicate is ignored by getenv)
+static char **environment(const mission *run, char *backend, char *seconds, char *tuning)
+{
+	int count = 0;
+	while (environ[count]) {
+		count++;
+	}
+	char **env = malloc((count + 4) * sizeof(char *));
+	if (!env) {
+		return NULL;
+	}
+	int n = 0;
+	env[n++] = backend;
+	env[n++] = seconds;
+	if (run->tuning) {
+		env[n++] = tuning;
+	}
+	for (int i = 0; i < count; i++) {
+		if (strncmp(environ[i], "WOMBAT_", 7) != 0 && strncmp(environ[i], "ROBOT_TUNING=", 13) != 0) {
+			env[n++] = environ[i];
+		}
+	}
+	env[n] = NULL;
+	return env;
+}
+
+// Parse: the simulator's summary line; false if there is none
+static bool parse(const char *output, mission_result *result)
+{
+	const char *line = NULL;
+	for (const char *at = strstr(output, "sim: "); at; at = strstr(at + 1, "sim: ")) {
+		line = at;
+	}
+	return line && sscanf(line, "sim: %lf s, %lf m driven, %d bumps, %d picked up, %*d put down, %d pollinations, "
+						  "%*d of %*d flowers pollinated, %lf%% of the arena covered", &result->seconds,
+						  &result->meters, &result->bumps, &result->pickups, &result->pollinations,
+						  &result->coverage) == 6;
+}
+
+void mission_run(const mission *run, mission_result *result)
+{
+	memset(result, 0, sizeof(*result));
+	result->status = MISSION_FAILED;
+
+	char backend[64], seconds[64], tuning[1024];
+	snprintf(backend, sizeof(backend), "WOMBAT_BACKEND=sim:%u", run->seed);
+	snprintf(seconds, sizeof(seconds), "WOMBAT_RUN_SECONDS=%g", run->seconds);
+	snprintf(tuning, sizeof(tuning), "ROBOT_TUNING=%s", run->tuning ? run->tuning : "");
+	char **env = environment(run, backend, seconds, tuning);
+	int output[2];
+	if (!env || pipe2(output, O_CLOEXEC) != 0) {
+		free(env);
+		return;
+	}
+
+	posix_spawn_file_actions_t actions;
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+	posix_spawn_file_actions_adddup2(&actions, output[1], STDERR_FILENO);
+	posix_spawn_file_actions_addclose(&actions, output[0]);
+	posix_spawn_file_actions_addclose(&actions, output[1]);
+	char *argv[] = {(char *)run->program, NULL};
+	pid_t child;
+	int spawned = posix_spawn(&child, run->program, &actions, NULL, argv, env);
+	posix_spawn_file_actions_destroy(&actions);
+	close(output[1]);
+	free(env);
+	if (spawned != 0) {
+		close(output[0]);
+		return;
+	}
+
+	char text[MISSION_OUTPUT];
+	size_t length = 0;
+	double deadline = now_seconds() + run->timeout;
+	bool timed_out = false;
+	while (true) {
+		double left = deadline - now_seconds();
+		struct pollfd wait = {output[0], POLLIN, 0};
+		if (left <= 0 || poll(&wait, 1, (int)(left * 1000) + 1) == 0) {
+			timed_out = true;
+			break;
+		}
+		char chunk[512];
+		ssize_t got = read(output[0], chunk, sizeof(chunk));
+		if (got <= 0) {
+			break; // the program exited (or closed stderr)
+		}
+		if (length + got >= sizeof(text)) {
+			// keep the tail, where the summary is
+			size_t keep = sizeof(text) / 2;
+			memmove(text, text + length - keep, keep);
+			length = keep;
+		}
+		memcpy(text + length, chunk, got);
+		length += got;
+	}
+	close(output[0]);
+	if (timed_out) {
+		kill(child, SIGKILL);
+	}
+	int status;
+	waitpid(child, &status, 0);
+	text[length] = '\0';
+
+	if (timed_out) {
+		result->status = MISSION_TIMED_OUT;
+	} else if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && parse(text, result)) {
+		result->status = MISSION_DONE;
+	}
+}
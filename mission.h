@@ -0,0 +1,44 @@
+/*
+Simulated missions for the off-robot tools.
+
+A mission is one run of a robot program built for the virtual clock (make sim) against the arena simulator
+(headless/backend-sim.c): a seeded arena, a length in simulated seconds, and the tuning overrides the program reads
+from ROBOT_TUNING (tuning.h). Each mission is its own process, so a program that never returns from main, crashes
+or hangs cannot take the tool down with it; a mission that runs past its wall-clock limit is killed and reported as
+timed out. The result comes from the one-line summary the simulator prints at exit.
+*/
+
+#ifndef MISSION_H
+#define MISSION_H
+
+#include <stdbool.h> // Boolean support
+
+#define MISSION_PROGRAM "build/sim/ethology-code"
+#define MISSION_SECONDS 600      // simulated seconds per mission (ten minutes)
+#define MISSION_TIMEOUT 30       // wall-clock seconds before a mission counts as hung
+
+#define MISSION_DONE 0
+#define MISSION_TIMED_OUT 1      // killed at the wall-clock limit
+#define MISSION_FAILED 2         // could not start, crashed, or printed no summary
+
+typedef struct mission {
+	const char *program;     // robot program built with make sim
+	unsigned int seed;       // arena seed (WOMBAT_BACKEND=sim:<seed>)
+	double seconds;          // simulated seconds to run
+	double timeout;          // wall-clock seconds allowed
+	const char *tuning;      // "name=value,..." for ROBOT_TUNING, or NULL
+} mission;
+
+typedef struct mission_result {
+	int status;              // MISSION_DONE, MISSION_TIMED_OUT or MISSION_FAILED
+	double seconds;          // simulated seconds the mission ran
+	double meters;           // distance driven
+	int bumps;               // collisions with walls
+	int pickups;
+	int pollinations;        // objects put down next to one of the other color
+	double coverage;         // percent of the arena the robot's center passed through
+} mission_result;
+
+void mission_run(const mission *run, mission_result *result);
+
+#endif
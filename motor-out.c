@@ -0,0 +1,120 @@
+/*
+Motor output (see motor-out.h).
+*/
+
+#include "motor-out.h"
+#include "robot-clock.h" // robot_time
+#include <kipr/wombat.h> // set_servo_position
+
+typedef struct motor_pin {
+	bool known;              // "position" has been written since motor_out_init
+	int position;            // last position written
+	unsigned long written;   // robot_time of that write
+	bool pending;            // a changed position is waiting for the interval
+	int next;                // the position waiting
+} motor_pin;
+
+static motor_pin pins[MOTOR_PINS];
+static int min_interval = MOTOR_INTERVAL;
+static motor_stats stats;
+static unsigned long rate_time;      // robot_time of the previous motor_skipped_per_second
+static unsigned long rate_skipped;   // skipped writes counted at that time
+
+void motor_out_init(int interval)
+{
+	for (int pin = 0; pin < MOTOR_PINS; pin++) {
+		pins[pin].known = false;
+		pins[pin].pending = false;
+	}
+	min_interval = interval > 0 ? interval : 0;
+	stats.written = stats.unchanged = stats.coalesced = 0;
+	rate_time = robot_time();
+	rate_skipped = 0;
+}
+
+// Write: send a position to the servo and remember it
+static void write_pin(motor_pin *motor, int pin, int position, unsigned long now)
+{
+	set_servo_position(pin, position);
+	motor->known = true;
+	motor->position = position;
+	motor->written = now;
+	motor->pending = false;
+	stats.written++;
+}
+
+// Set: "now" skips the interval check
+static void set(int pin, int position, bool now)
+{
+	if (pin < 0 || pin >= MOTOR_PINS) {
+		set_servo_position(pin, position); // not ours to track
+		return;
+	}
+	motor_pin *motor = &pins[pin];
+	if (motor->pending) {
+		stats.coalesced++; // the waiting position is replaced either way
+		motor->pending = false;
+	}
+	if (motor->known && motor->position == position) {
+		stats.unchanged++;
+		return;
+	}
+	unsigned long time = robot_time();
+	if (!now && motor->known && time - motor->written < (unsigned long)min_interval) {
+		motor->pending = true;
+		motor->next = position;
+		return;
+	}
+	write_pin(motor, pin, position, time);
+}
+
+void motor_set(int pin, int position)
+{
+	set(pin, position, false);
+}
+
+void motor_set_now(int pin, int position)
+{
+	set(pin, position, true);
+}
+
+void motor_flush()
+{
+	unsigned long time = robot_time();
+	for (int pin = 0; pin < MOTOR_PINS; pin++) {
+		motor_pin *motor = &pins[pin];
+		if (motor->pending && time - motor->written >= (unsigned long)min_interval) {
+			write_pin(motor, pin, motor->next, time);
+		}
+	}
+}
+
+bool motor_flush_deadline(unsigned long *deadline)
+{
+	bool any = false;
+	for (int pin = 0; pin < MOTOR_PINS; pin++) {
+		if (pins[pin].pending) {
+			unsigned long due = pins[pin].written + min_interval;
+			if ((long)(due - *deadline) < 0) { // never move the caller's deadline later
+				*deadline = due;
+			}
+			any = true;
+		}
+	}
+	return any;
+}
+
+void motor_stats_read(motor_stats *out)
+{
+	*out = stats;
+}
+
+float motor_skipped_per_second()
+{
+	unsigned long time = robot_time();
+	unsigned long skipped = stats.unchanged + stats.coalesced;
+	float rate = time > rate_time ? (skipped - rate_skipped) * 1000.0f / (time - rate_time) : 0;
+	rate_time = time;
+	rate_skipped = skipped;
+	return rate;
+}
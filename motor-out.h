@@ -0,0 +1,37 @@
+/*
+Motor output for the pollinator robots.
+
+The behaviors issue drive commands far more often than the servos can follow: spin_search() asks for a new command
+every 2 ms and centering every 20 ms, mostly with the positions the servos already have. This layer keeps the last
+position written to each pin and drops writes that would not change it. A changed position that arrives sooner than
+the minimum interval after the previous write to that pin is held back, and only the newest one is written when the
+interval is up, so a burst of commands costs one servo update. The writes that never reached set_servo_position are
+counted so a run can report how many per second were saved.
+
+Held-back positions are written by motor_flush(), which the control loop calls every tick; motor_flush_deadline()
+tells the loop how long it may sleep before the next one is due. Called from the control loop only.
+*/
+
+#ifndef MOTOR_OUT_H
+#define MOTOR_OUT_H
+
+#include <stdbool.h> // Boolean support
+
+#define MOTOR_PINS 4          // servo ports on the Wombat
+#define MOTOR_INTERVAL 20     // default minimum ms between writes to one pin (one servo frame at 50 Hz)
+
+typedef struct motor_stats {
+	unsigned long written;    // set_servo_position calls made
+	unsigned long unchanged;  // writes dropped because the pin already had that position
+	unsigned long coalesced;  // positions replaced by a newer one before they were written
+} motor_stats;
+
+void motor_out_init(int interval);          // forget all positions; "interval" is the minimum ms between writes to a pin
+void motor_set(int pin, int position);      // request a servo position (written now, later or not at all)
+void motor_set_now(int pin, int position);  // write at once if it changes anything, ignoring the interval (e.g. stop)
+void motor_flush();                         // write held-back positions whose interval is up
+bool motor_flush_deadline(unsigned long *deadline); // pull "deadline" (robot_time) in to the next held-back write; false if none
+void motor_stats_read(motor_stats *stats);  // counters since motor_out_init
+float motor_skipped_per_second();           // writes dropped or coalesced per second since the previous call
+
+#endif
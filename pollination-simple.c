@@ -3,6 +3,9 @@
 #include <stdlib.h>       // General-purpose functions
 #include <stdbool.h>      // Boolean support
 #include <math.h>
+#include "robot-clock.h" // sleeping until the next deadline instead of polling the timer
+#include "motor-out.h"   // drops servo writes that would not change anything
+#include "servo-cal.h"   // calibrated wheel speed to servo position table
 
 // Define integer keys for each action type
 #define SEEK_LIGHT_TYPE 0
@@ -30,6 +33,8 @@
 #define GRIPPER_OPEN_POSITION 0
 #define GRIPPER_CLOSED_POSITION 1023
 
+#define FORWARD_SPEED 300 // per mille of full speed for "forward", the same on every calibrated robot
+
 // Global Variables
 int hierarchy_length;
 int timer_duration = 500;
@@ -42,15 +47,30 @@ int right_ir_value, left_ir_value, back_bump_left_value, back_bump_center_value,
 // threshold values
 int avoid_threshold = 1600;	   // the absolute difference between IR readings has to be above this for the avoid action
 
+// Camera snapshot: every perception function reads the blobs of the current tick from here instead of updating the camera itself
+#define SNAPSHOT_CHANNELS 2 // channel 0 is red, channel 1 is blue
+
+typedef struct frame_snapshot {
+    int count[SNAPSHOT_CHANNELS];        // number of objects seen on each channel
+    rectangle bbox[SNAPSHOT_CHANNELS];   // bounding box of the largest object on each channel
+    point2 centroid[SNAPSHOT_CHANNELS];  // centroid of the largest object on each channel
+    int area[SNAPSHOT_CHANNELS];         // area of the largest object on each channel
+} frame_snapshot;
+
+frame_snapshot frame; // filled once per tick by "capture_frame"
+
 // Function Declarations
 void initialize_camera();
+void capture_frame(); // grab one camera frame and store its blobs in "frame"
 bool search_snapshot(int channel);
 void spin_search();
-void approach_object();
+void approach_object(int channel);
 void stop();
 void drive(float left, float right, float delay_seconds);
+void drive_q(int left, int right, int milliseconds); // drive with speeds in per mille (-1000 .. 1000), integer only
+void set_wheels(int left, int right); // set both wheel speeds (per mille) without touching the timer
+void init_wheels(); // build the wheel table from this robot's calibration
 bool timer_elapsed();
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high);
 bool is_pollinated();
 void approach_drop();
 void forward();
@@ -61,6 +81,8 @@ bool is_back_bump();							 // return true if one of the back bumpers was hit
 void escape_back(); //initialize escape back function
 void avoid(); //initialize avoid function
 
+servo_table wheels; // servo position for every wheel speed, built by "init_wheels"
+
 int spiral_length = 1; // Length of the forward movement, increases over time
 int spin_count = 0; // Global variable to track the number of spins
 
@@ -72,6 +94,8 @@ int main() {
     enable_servo(LEFT_MOTOR_PIN);
     enable_servo(RIGHT_MOTOR_PIN);
     enable_servo(GRIPPER_PIN);
+    motor_out_init(0); // the blocking sequences below sleep with msleep, so nothing may be held back for later
+    init_wheels();
 
     unsigned long no_pollen_timer = systime(); // Timer to track time spent without finding pollen
    
@@ -80,6 +104,7 @@ int main() {
     initialize_camera();
 
 while (true) {
+    robot_sleep_until(start_time + timer_duration); // the current drive command runs until then
     if (timer_elapsed()) {
         read_sensors(); // Read all sensors and set global variables of their readouts
 
@@ -96,6 +121,7 @@ while (true) {
                     dance(); // Perform the dance
                     no_pollen_timer = systime(); // Reset timer after dance
                 } else {
+                    capture_frame(); // one camera frame for every perception check below
                     if (is_pollinated()) {
                         // Object detected, approach it
                         printf("pollinated!!");
@@ -140,11 +166,22 @@ void initialize_camera() {
     camera_open();
 }
 
-// Search Snapshot: Detects objects using the camera
-bool search_snapshot(int channel) {
+// Capture Frame: Updates the camera once and stores the largest object of each channel
+void capture_frame() {
     camera_update();
-    msleep(10);
-    int object_count = get_object_count(channel);
+    for (int channel = 0; channel < SNAPSHOT_CHANNELS; channel++) {
+        frame.count[channel] = get_object_count(channel);
+        if (frame.count[channel] > 0) {
+            frame.bbox[channel] = get_object_bbox(channel, 0);
+            frame.centroid[channel] = get_object_centroid(channel, 0);
+            frame.area[channel] = get_object_area(channel, 0);
+        }
+    }
+}
+
+// Search Snapshot: Detects objects in the current frame
+bool search_snapshot(int channel) {
+    int object_count = frame.count[channel];
     if (object_count > 0){
         printf("found");
     }
@@ -153,20 +190,17 @@ bool search_snapshot(int channel) {
 
 // Is pollinated Boolean loop : checks if the flower the camera sees has pollen on it
 bool is_pollinated() {
-    camera_update();
-    msleep(10);
-
-    int red_count = get_object_count(0);
-    int blue_count = get_object_count(1);
+    int red_count = frame.count[0];
+    int blue_count = frame.count[1];
 
-    if (red_count + blue_count < 1){
+    if (red_count < 1 || blue_count < 1){
         return false;
     }
 
-    int redx  = (get_object_centroid(0, 0)).x ;
-    int redy  = (get_object_centroid(0, 0)).y ;
-    int bluex  = (get_object_centroid(1, 0)).x ;
-    int bluey  = (get_object_centroid(1, 0)).y ;
+    int redx  = frame.centroid[0].x ;
+    int redy  = frame.centroid[0].y ;
+    int bluex  = frame.centroid[1].x ;
+    int bluey  = frame.centroid[1].y ;
     
     int x = redx - bluex;
     int y = redy - bluey;
@@ -209,19 +243,21 @@ void spin_search() {
 }
 
 // Approach Object: Drives forward until the object is no longer visible, then closes gripper
-void approach_object(channel) {
+void approach_object(int channel) {
     stop(); // Stop once the object is no longer visible
-    set_servo_position(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Open the gripper
+    motor_set(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Open the gripper
     msleep(1000); // Wait for the gripper to open
+    capture_frame();
     while (search_snapshot(channel)) {
         forward(); // Drive forward while object is visible
         msleep(50);
+        capture_frame();
     }
     // Object no longer visible, so stop immediately
     stop();
     msleep(1000);  // Now the robot is stationary during this wait
     
-    set_servo_position(GRIPPER_PIN, GRIPPER_CLOSED_POSITION); // Close the gripper
+    motor_set(GRIPPER_PIN, GRIPPER_CLOSED_POSITION); // Close the gripper
     have_pollen = true;
     msleep(1000); // Wait for the gripper to open
     
@@ -229,13 +265,15 @@ void approach_object(channel) {
 
 void approach_drop() {
         stop(); // Stop once the object is no longer visible
+        capture_frame();
         while (search_snapshot(1)) {
         forward(); // Drive forward while object is visible
         msleep(500);
+        capture_frame();
     }
         stop();
     msleep(1000); // Wait for the gripper to open
-    set_servo_position(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Close the gripper
+    motor_set(GRIPPER_PIN, GRIPPER_OPEN_POSITION); // Close the gripper
     have_pollen = false;  
     msleep(1000); // Wait for the gripper to open
     drive(-1.0, -1.0, 0.2);
@@ -250,12 +288,11 @@ void stop() {
 }
 
 void stop_plain() {
-    set_servo_position(LEFT_MOTOR_PIN, 0);
-    set_servo_position(RIGHT_MOTOR_PIN, 0);
+    motor_set_now(LEFT_MOTOR_PIN, 0);
+    motor_set_now(RIGHT_MOTOR_PIN, 0);
 }
 void forward() {
-    set_servo_position(LEFT_MOTOR_PIN, 1200);
-    set_servo_position(RIGHT_MOTOR_PIN, 800);
+    set_wheels(FORWARD_SPEED, FORWARD_SPEED);
 }
 
 //Avoid function
@@ -283,20 +320,37 @@ void escape_back()
 // Drive Function: Controls motor speeds
 
 void drive(float left, float right, float delay_seconds) {
-    float left_speed = map(left, -1.0, 1.0, 0, 2047);
-    float right_speed = map(right, -1.0, 1.0, 2047, 0);
+    drive_q((int)(left * SERVO_SPEED_MAX), (int)(right * SERVO_SPEED_MAX), (int)(delay_seconds * 1000));
+}
+
+void drive_q(int left, int right, int milliseconds) {
+    timer_duration = milliseconds;
+    start_time = robot_time();
+
+    set_wheels(left, right);
+}
 
-    timer_duration = (int)(delay_seconds * 1000);
-    start_time = systime();
+void set_wheels(int left, int right) {
+    if (left == 0 && right == 0) { // a stop goes out at once, never held back for the interval
+        motor_set_now(LEFT_MOTOR_PIN, servo_position(wheels.left, 0));
+        motor_set_now(RIGHT_MOTOR_PIN, servo_position(wheels.right, 0));
+        return;
+    }
+    motor_set(LEFT_MOTOR_PIN, servo_position(wheels.left, left));
+    motor_set(RIGHT_MOTOR_PIN, servo_position(wheels.right, right));
+}
 
-    set_servo_position(LEFT_MOTOR_PIN, left_speed);
-    set_servo_position(RIGHT_MOTOR_PIN, right_speed);
+void init_wheels() {
+    servo_calibration calibration;
+    servo_cal_default(&calibration);
+    servo_cal_load(&calibration, SERVO_CAL_FILE); // this robot's own servos, if it has been calibrated
+    servo_cal_build(&wheels, &calibration);
 }
 
 // Timer Elapsed: Checks if specified duration has passed
 
 bool timer_elapsed() {
-    return (systime() > (start_time + timer_duration));
+    return (long)(robot_time() - (start_time + timer_duration)) >= 0;
 }
 
 //reads all of the sensors
@@ -327,9 +381,4 @@ bool is_back_bump()
 	return (back_bump_left_value == 1 || back_bump_center_value == 1 || back_bump_right_value == 1); // return true if one of the back bump values is 1, otherwise false
 }
 
-// Map Function: Maps one range to another
-
-float map(float value, float start_range_low, float start_range_high, float target_range_low, float target_range_high) {
-    return target_range_low + ((value - start_range_low) / (start_range_high - start_range_low)) * (target_range_high - target_range_low);
-}
  
\ No newline at end of file
@@ -0,0 +1,99 @@
+/*
+Red/blue proximity test (see pollination.h).
+*/
+
+#include "pollination.h"
+
+void find_pollinated(const seg_point *red, int red_count, const seg_point *blue, int blue_count, int radius,
+					 int width, int height, pollination_result *result)
+{
+	if (red_count > POLL_MAX_FLOWERS) red_count = POLL_MAX_FLOWERS;
+	if (blue_count > POLL_MAX_FLOWERS) blue_count = POLL_MAX_FLOWERS;
+	int radius_sq = radius * radius;
+
+	// grid of cells at least "radius" wide, so any blue within the radius is in the 3x3 cells around a red blob
+	int cell = radius > 0 ? radius : 1;
+	int columns = (width + cell - 1) / cell;
+	int rows = (height + cell - 1) / cell;
+	while (columns * rows > POLL_MAX_CELLS) {
+		cell *= 2;
+		columns = (width + cell - 1) / cell;
+		rows = (height + cell - 1) / cell;
+	}
+	if (columns < 1) columns = 1; // unknown frame size: one cell, plain all-pairs test
+	if (rows < 1) rows = 1;
+
+	// counting sort of the blue blobs by cell: cell_start[c] .. cell_start[c + 1] indexes into "order"
+	int cell_start[POLL_MAX_CELLS + 1] = {0};
+	int blue_cell[POLL_MAX_FLOWERS];
+	int order[POLL_MAX_FLOWERS];
+	for (int b = 0; b < blue_count; b++) {
+		int cx = blue[b].x / cell, cy = blue[b].y / cell;
+		if (cx < 0) cx = 0;
+		if (cy < 0) cy = 0;
+		if (cx >= columns) cx = columns - 1;
+		if (cy >= rows) cy = rows - 1;
+		blue_cell[b] = cy * columns + cx;
+		cell_start[blue_cell[b] + 1]++;
+	}
+	for (int c = 0; c < columns * rows; c++) {
+		cell_start[c + 1] += cell_start[c];
+	}
+	int fill[POLL_MAX_CELLS];
+	for (int c = 0; c < columns * rows; c++) {
+		fill[c] = cell_start[c];
+	}
+	for (int b = 0; b < blue_count; b++) {
+		order[fill[blue_cell[b]]++] = b;
+	}
+
+	result->flower_count = red_count;
+	result->pollinated_count = 0;
+	result->pair_count = 0;
+	for (int r = 0; r < red_count; r++) {
+		int rx = red[r].x / cell, ry = red[r].y / cell; // clamped like the blue cells, or pairs outside the grid are lost
+		if (rx < 0) rx = 0;
+		if (ry < 0) ry = 0;
+		if (rx >= columns) rx = columns - 1;
+		if (ry >= rows) ry = rows - 1;
+		int best = -1, best_sq = 0;
+		for (int cy = ry - 1; cy <= ry + 1; cy++) {
+			for (int cx = rx - 1; cx <= rx + 1; cx++) {
+				if (cx < 0 || cy < 0 || cx >= columns || cy >= rows) {
+					continue;
+				}
+				int c = cy * columns + cx;
+				for (int k = cell_start[c]; k < cell_start[c + 1]; k++) {
+					int b = order[k];
+					int dx = red[r].x - blue[b].x;
+					int dy = red[r].y - blue[b].y;
+					int distance_sq = dx * dx + dy * dy;
+					if (distance_sq >= radius_sq) {
+						continue;
+					}
+					flower_pair *pair = &result->pairs[result->pair_count++];
+					pair->red = r;
+					pair->blue = b;
+					pair->distance_sq = distance_sq;
+					if (best < 0 || distance_sq < best_sq) {
+						best = b;
+						best_sq = distance_sq;
+					}
+				}
+			}
+		}
+		result->nearest_blue[r] = best;
+		result->pollinated[r] = best >= 0;
+		result->pollinated_count += best >= 0;
+	}
+}
+
+int first_unpollinated(const pollination_result *result)
+{
+	for (int r = 0; r < result->flower_count; r++) {
+		if (!result->pollinated[r]) {
+			return r;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,39 @@
+/*
+Red/blue proximity test for the pollinator robots.
+
+A red flower counts as pollinated when a blue blob (pollen) lies within "radius" pixels of its centroid. Every red blob
+is tested against every blue blob in one call, with integer squared distances, and blue blobs are bucketed into a
+coarse grid of radius-sized image cells so each red blob only looks at the 3x3 cells around it.
+*/
+
+#ifndef POLLINATION_H
+#define POLLINATION_H
+
+#include "color-segment.h" // seg_point, SEG_MAX_BLOBS
+#include <stdbool.h>       // Boolean support
+
+#define POLL_MAX_FLOWERS SEG_MAX_BLOBS  // red and blue blobs considered per frame
+#define POLL_MAX_CELLS 64               // grid cells; the cell size grows if the image would need more
+
+typedef struct flower_pair {
+	int red, blue;           // blob indices (0 = largest)
+	int distance_sq;         // squared pixel distance between their centroids
+} flower_pair;
+
+typedef struct pollination_result {
+	int flower_count;                        // red blobs tested
+	int pollinated_count;                    // red blobs with pollen nearby
+	bool pollinated[POLL_MAX_FLOWERS];       // per red blob
+	int nearest_blue[POLL_MAX_FLOWERS];      // closest blue blob within the radius, -1 if none
+	int pair_count;
+	flower_pair pairs[POLL_MAX_FLOWERS * POLL_MAX_FLOWERS]; // every red/blue pair within the radius
+} pollination_result;
+
+// Find Pollinated: test all red blobs against all blue blobs of a width x height image
+void find_pollinated(const seg_point *red, int red_count, const seg_point *blue, int blue_count, int radius,
+					 int width, int height, pollination_result *result);
+
+// First Unpollinated: index of the first (largest) red blob without pollen, -1 if every flower is pollinated
+int first_unpollinated(const pollination_result *result);
+
+#endif
@@ -0,0 +1,111 @@
+/*
+Deadline sleeping (see robot-clock.h).
+
+The sleep is a condition wait against an absolute CLOCK_MONOTONIC deadline, so it can be both timed and woken. A wake
+that arrives while nobody sleeps is remembered and ends the next sleep at once; the loop then simply finds nothing new
+and sleeps again.
+
+In a ROBOT_VIRTUAL_TIME build everything runs on the control loop's thread, so the sleep is a plain msleep() on the
+Wombat clock and a wake can only come from the loop itself.
+*/
+
+#include "robot-clock.h"
+
+#if ROBOT_VIRTUAL_TIME
+#include <kipr/wombat.h> // systime, msleep
+
+static bool wake_pending;
+
+unsigned long robot_time()
+{
+	return systime();
+}
+
+unsigned long long robot_time_us()
+{
+	return (unsigned long long)systime() * 1000;
+}
+
+bool robot_sleep_until(unsigned long deadline)
+{
+	if (wake_pending) {
+		wake_pending = false;
+		return false;
+	}
+	long remaining = (long)(deadline - systime());
+	if (remaining <= 0) {
+		return true;
+	}
+	msleep(remaining < ROBOT_VIRTUAL_STEP ? remaining : ROBOT_VIRTUAL_STEP);
+	return (long)(systime() - deadline) >= 0;
+}
+
+void robot_wake()
+{
+	wake_pending = true;
+}
+
+#else
+#include <pthread.h>  // condition wait
+#include <time.h>     // clock_gettime
+
+static pthread_mutex_t sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sleep_wake;
+static pthread_once_t sleep_once = PTHREAD_ONCE_INIT;
+static bool wake_pending;
+
+// Init Wake: the condition variable has to time out on the monotonic clock, not the wall clock
+static void init_wake()
+{
+	pthread_condattr_t attributes;
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&sleep_wake, &attributes);
+	pthread_condattr_destroy(&attributes);
+}
+
+unsigned long robot_time()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+unsigned long long robot_time_us()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+bool robot_sleep_until(unsigned long deadline)
+{
+	pthread_once(&sleep_once, init_wake);
+	struct timespec until;
+	until.tv_sec = deadline / 1000;
+	until.tv_nsec = (long)(deadline % 1000) * 1000000;
+
+	pthread_mutex_lock(&sleep_lock);
+	bool reached = false;
+	while (!wake_pending) {
+		if ((long)(robot_time() - deadline) >= 0) {
+			reached = true;
+			break;
+		}
+		pthread_cond_timedwait(&sleep_wake, &sleep_lock, &until);
+	}
+	wake_pending = false;
+	pthread_mutex_unlock(&sleep_lock);
+	return reached;
+}
+
+void robot_wake()
+{
+	pthread_once(&sleep_once, init_wake);
+	pthread_mutex_lock(&sleep_lock);
+	wake_pending = true;
+	pthread_cond_signal(&sleep_wake);
+	pthread_mutex_unlock(&sleep_lock);
+}
+
+#endif
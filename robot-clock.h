@@ -0,0 +1,34 @@
+/*
+Deadline sleeping for the pollinator robots' control loops.
+
+The main loops used to spin on timer_elapsed(), comparing systime() against the end of the current drive command
+millions of times per command and keeping a whole core busy. Instead the loop now sleeps until the command's deadline,
+an absolute time on the monotonic clock, so waking early or more than once does not move the deadline, and the core is
+free for the camera in between. drive() times each command from when it is issued, so a late wake-up does delay the
+commands after it by that much. Other threads (camera capture, sensor sampling) call robot_wake() when something the loop
+should look at arrives, which ends the sleep early.
+
+Simulation builds set ROBOT_VIRTUAL_TIME to 1. Then there are no capture or sampling threads (camera-thread.c and
+sensor-thread.c read the camera and the pins on the control loop when they are due), robot_time() is systime(), and a
+sleep is an msleep() of at most ROBOT_VIRTUAL_STEP, so the loop still looks at its sensors as often as the camera would
+have woken it. The headless library (headless/) advances its clock only when the program sleeps, which makes a run as
+fast as the CPU allows and the same every time.
+*/
+
+#ifndef ROBOT_CLOCK_H
+#define ROBOT_CLOCK_H
+
+#include <stdbool.h> // Boolean support
+
+#ifndef ROBOT_VIRTUAL_TIME
+#define ROBOT_VIRTUAL_TIME 0
+#endif
+
+#define ROBOT_VIRTUAL_STEP 33 // longest single sleep in a ROBOT_VIRTUAL_TIME build (one camera frame)
+
+unsigned long robot_time();                      // milliseconds on the monotonic clock (same scale as systime())
+unsigned long long robot_time_us();              // microseconds on the same clock, for timestamping sensor samples
+bool robot_sleep_until(unsigned long deadline);  // sleep until "deadline" (robot_time) or robot_wake(); true at the deadline
+void robot_wake();                               // end the current (or next) robot_sleep_until early, from any thread
+
+#endif
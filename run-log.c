@@ -0,0 +1,338 @@
+/*
+Run recording (see run-log.h).
+
+Writers from the capture thread and the control loop take one mutex per record. The mutex is only touched while
+recording; run_log_active() is a plain atomic load, so a robot that is not recording pays nothing but that check.
+*/
+
+#include "run-log.h"
+#include <fcntl.h>       // open
+#include <pthread.h>     // record lock
+#include <stdatomic.h>   // recording flag
+#include <stdlib.h>      // malloc, free
+#include <string.h>      // memcpy, strlen
+#include <sys/mman.h>    // mmap
+#include <sys/stat.h>    // fstat
+#include <unistd.h>      // ftruncate, close
+
+#define ALIGN8(n) (((n) + 7) & ~(size_t)7)
+#define FIRST_RECORD ALIGN8(sizeof(run_log_header))
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_bool recording;
+static int log_fd = -1;
+static unsigned char *log_map;           // the file, mapped read/write
+static size_t log_mapped;                // bytes mapped (and the file's size while recording)
+static unsigned long long *log_index;    // offset of every record so far
+static unsigned long long log_index_capacity;
+
+//=====================================//
+//==============RECORDING==============//
+//=====================================//
+
+// Map: resize the file and map it again; false if the disk or the address space is full
+static bool map(size_t length)
+{
+	if (ftruncate(log_fd, (off_t)length) != 0) {
+		return false;
+	}
+	void *mapped = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, log_fd, 0);
+	if (mapped == MAP_FAILED) {
+		return false;
+	}
+	if (log_map) {
+		munmap(log_map, log_mapped);
+	}
+	log_map = mapped;
+	log_mapped = length;
+	return true;
+}
+
+bool run_log_start(const char *path, unsigned long long start_time)
+{
+	pthread_mutex_lock(&log_lock);
+	if (atomic_load(&recording)) {
+		pthread_mutex_unlock(&log_lock);
+		return false;
+	}
+	log_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (log_fd < 0 || !map(RUN_LOG_INITIAL)) {
+		if (log_fd >= 0) {
+			close(log_fd);
+			log_fd = -1;
+		}
+		pthread_mutex_unlock(&log_lock);
+		return false;
+	}
+	run_log_header *header = (run_log_header *)log_map;
+	memcpy(header->magic, RUN_LOG_MAGIC, 4);
+	header->version = RUN_LOG_VERSION;
+	header->end = FIRST_RECORD;
+	header->index_offset = 0;
+	header->record_count = 0;
+	header->start_time = start_time;
+	log_index = NULL;
+	log_index_capacity = 0;
+	atomic_store(&recording, true);
+	pthread_mutex_unlock(&log_lock);
+	return true;
+}
+
+void run_log_stop()
+{
+	pthread_mutex_lock(&log_lock);
+	if (!atomic_exchange(&recording, false)) {
+		pthread_mutex_unlock(&log_lock);
+		return;
+	}
+	run_log_header *header = (run_log_header *)log_map;
+	size_t index_bytes = header->record_count * sizeof(unsigned long long);
+	size_t length = header->end + index_bytes;
+	if (length <= log_mapped || map(length)) {
+		header = (run_log_header *)log_map;
+		memcpy(log_map + header->end, log_index, index_bytes);
+		header->index_offset = header->end;
+	} else {
+		length = header->end; // no room for the index, the reader walks the records instead
+	}
+	msync(log_map, length, MS_SYNC);
+	munmap(log_map, log_mapped);
+	if (ftruncate(log_fd, (off_t)length) != 0) {
+		// the file keeps its preallocated tail, the header still says where the log ends
+	}
+	close(log_fd);
+	log_fd = -1;
+	log_map = NULL;
+	log_mapped = 0;
+	free(log_index);
+	log_index = NULL;
+	pthread_mutex_unlock(&log_lock);
+}
+
+bool run_log_active()
+{
+	return atomic_load_explicit(&recording, memory_order_relaxed);
+}
+
+// Append Parts: one record whose payload is two pieces laid end to end
+static void append_parts(unsigned int type, unsigned long long time, const void *first, size_t first_size,
+						 const void *second, size_t second_size)
+{
+	if (!run_log_active()) {
+		return;
+	}
+	pthread_mutex_lock(&log_lock);
+	if (!atomic_load_explicit(&recording, memory_order_relaxed)) {
+		pthread_mutex_unlock(&log_lock);
+		return;
+	}
+	run_log_header *header = (run_log_header *)log_map;
+	size_t offset = header->end;
+	size_t length = ALIGN8(sizeof(run_record) + first_size + second_size);
+	if (offset + length > log_mapped) {
+		size_t grown = log_mapped * 2;
+		while (grown < offset + length) {
+			grown *= 2;
+		}
+		if (!map(grown)) {
+			pthread_mutex_unlock(&log_lock);
+			return; // disk full: keep what we have, drop this record
+		}
+		header = (run_log_header *)log_map;
+	}
+	if (header->record_count == log_index_capacity) {
+		unsigned long long capacity = log_index_capacity ? 2 * log_index_capacity : 4096;
+		unsigned long long *index = realloc(log_index, capacity * sizeof(unsigned long long));
+		if (!index) {
+			pthread_mutex_unlock(&log_lock);
+			return;
+		}
+		log_index = index;
+		log_index_capacity = capacity;
+	}
+
+	run_record *record = (run_record *)(log_map + offset);
+	record->type = type;
+	record->size = (unsigned int)(first_size + second_size);
+	record->time = time;
+	memcpy(record + 1, first, first_size);
+	if (second_size) {
+		memcpy((unsigned char *)(record + 1) + first_size, second, second_size);
+	}
+	log_index[header->record_count++] = offset;
+	atomic_thread_fence(memory_order_release);
+	header->end = offset + length; // the record is complete, a reader may see it now
+	pthread_mutex_unlock(&log_lock);
+}
+
+void run_log_append(unsigned int type, unsigned long long time, const void *payload, size_t size)
+{
+	append_parts(type, time, payload, size, NULL, 0);
+}
+
+void run_log_frame(unsigned long long time, unsigned long long sequence, const unsigned char *bgr, int width, int height)
+{
+	run_frame_header frame = {sequence, (unsigned int)width, (unsigned int)height};
+	append_parts(RUN_FRAME, time, &frame, sizeof(frame), bgr, (size_t)3 * width * height);
+}
+
+void run_log_blobs(unsigned long long time, const run_blobs *blobs)
+{
+	append_parts(RUN_BLOBS, time, blobs, sizeof(*blobs), NULL, 0);
+}
+
+void run_log_sensors(unsigned long long time, const int *values, int count)
+{
+	run_sensors sensors;
+	memset(&sensors, 0, sizeof(sensors));
+	sensors.count = count < RUN_LOG_SENSORS ? count : RUN_LOG_SENSORS;
+	memcpy(sensors.values, values, sensors.count * sizeof(int));
+	append_parts(RUN_SENSORS, time, &sensors, sizeof(sensors), NULL, 0);
+}
+
+void run_log_drive(unsigned long long time, float left, float right, float seconds)
+{
+	run_drive drive = {left, right, seconds};
+	append_parts(RUN_DRIVE, time, &drive, sizeof(drive), NULL, 0);
+}
+
+void run_log_note(unsigned long long time, const char *text)
+{
+	char note[RUN_LOG_NOTE] = {0};
+	strncpy(note, text, RUN_LOG_NOTE - 1);
+	append_parts(RUN_NOTE, time, note, strlen(note) + 1, NULL, 0);
+}
+
+//=====================================//
+//===============READING===============//
+//=====================================//
+
+// Valid Record: a record header and its whole payload at "offset" lie inside the records written before "end"
+static bool valid_record(const run_log_reader *reader, unsigned long long offset)
+{
+	unsigned long long end = reader->header->end;
+	if (offset < FIRST_RECORD || offset % 8 != 0 || offset > end || end - offset < sizeof(run_record)) {
+		return false;
+	}
+	const run_record *record = (const run_record *)(reader->data + offset);
+	return record->size <= end - offset - sizeof(run_record);
+}
+
+// Valid Index: the index lies inside the file and every offset in it points at a valid record
+static bool valid_index(const run_log_reader *reader)
+{
+	const run_log_header *header = reader->header;
+	if (header->index_offset == 0 || header->index_offset % 8 != 0 || header->index_offset > reader->length
+		|| header->record_count > (reader->length - header->index_offset) / sizeof(unsigned long long)) {
+		return false;
+	}
+	const unsigned long long *offsets = (const unsigned long long *)(reader->data + header->index_offset);
+	for (unsigned long long i = 0; i < header->record_count; i++) {
+		if (!valid_record(reader, offsets[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Walk: rebuild the index of a log that was not stopped cleanly; false if out of memory
+static bool walk(run_log_reader *reader)
+{
+	unsigned long long capacity = 4096, count = 0;
+	unsigned long long *offsets = malloc(capacity * sizeof(unsigned long long));
+	unsigned long long end = reader->header->end;
+	for (unsigned long long offset = FIRST_RECORD; offsets && offset < end;) {
+		if (!valid_record(reader, offset)) {
+			break; // torn record at the end
+		}
+		const run_record *record = (const run_record *)(reader->data + offset);
+		unsigned long long next = offset + ALIGN8(sizeof(run_record) + record->size);
+		if (count == capacity) {
+			capacity *= 2;
+			unsigned long long *grown = realloc(offsets, capacity * sizeof(unsigned long long));
+			if (!grown) {
+				free(offsets);
+				return false;
+			}
+			offsets = grown;
+		}
+		offsets[count++] = offset;
+		offset = next;
+	}
+	if (!offsets) {
+		return false;
+	}
+	reader->offsets = offsets;
+	reader->record_count = count;
+	reader->rebuilt = true;
+	return true;
+}
+
+bool run_log_open(run_log_reader *reader, const char *path)
+{
+	memset(reader, 0, sizeof(*reader));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	void *data = MAP_FAILED;
+	if (fstat(fd, &info) == 0 && (size_t)info.st_size >= FIRST_RECORD) {
+		data = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (data == MAP_FAILED) {
+		return false;
+	}
+	reader->data = data;
+	reader->length = info.st_size;
+	reader->header = data;
+	const run_log_header *header = reader->header;
+	if (memcmp(header->magic, RUN_LOG_MAGIC, 4) != 0 || header->version != RUN_LOG_VERSION
+		|| header->end > reader->length) {
+		run_log_close(reader);
+		return false;
+	}
+	// A log that was torn or damaged gets its index rebuilt from the records, so every offset read later is valid
+	if (valid_index(reader)) {
+		reader->offsets = (const unsigned long long *)(reader->data + header->index_offset);
+		reader->record_count = header->record_count;
+	} else if (!walk(reader)) {
+		run_log_close(reader);
+		return false;
+	}
+	madvise((void *)reader->data, reader->length, MADV_SEQUENTIAL); // replay reads front to back
+	return true;
+}
+
+void run_log_close(run_log_reader *reader)
+{
+	if (reader->rebuilt) {
+		free((void *)reader->offsets);
+	}
+	if (reader->data) {
+		munmap((void *)reader->data, reader->length);
+	}
+	memset(reader, 0, sizeof(*reader));
+}
+
+const run_record *run_log_record(const run_log_reader *reader, unsigned long long index, const void **payload)
+{
+	if (index >= reader->record_count) {
+		return NULL;
+	}
+	const run_record *record = (const run_record *)(reader->data + reader->offsets[index]); // checked by run_log_open
+	if (payload) {
+		*payload = record + 1;
+	}
+	return record;
+}
+
+const run_record *run_log_next(run_log_reader *reader, const void **payload)
+{
+	const run_record *record = run_log_record(reader, reader->next, payload);
+	if (record) {
+		reader->next++;
+	}
+	return record;
+}
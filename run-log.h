@@ -0,0 +1,102 @@
+/*
+Run recording for the pollinator robots.
+
+While recording, every camera frame, its blob results, each read_sensors() pass, every drive() command and short
+notes (what used to be printf("found") / printf("nearby")) are appended to one binary log file, so a field run can be
+replayed and benchmarked offline (log-replay.c).
+
+The file is memory-mapped and only ever appended to: a fixed header, then the records, each with its own small header,
+and finally an index of record offsets written when recording stops. The header's "end" is advanced after every
+complete record, so a run that crashes or is switched off still leaves a readable log; without an index the reader
+rebuilds it by walking the records. Nothing here needs the Wombat, so the reader also runs on a plain Linux box.
+*/
+
+#ifndef RUN_LOG_H
+#define RUN_LOG_H
+
+#include "color-segment.h" // seg_blob, SEG_MAX_BLOBS
+#include <stdbool.h>       // Boolean support
+#include <stddef.h>        // size_t
+
+#define RUN_LOG_MAGIC "PLOG"
+#define RUN_LOG_VERSION 1
+#define RUN_LOG_CHANNELS 2        // blob channels per record (0 = red, 1 = blue)
+#define RUN_LOG_SENSORS 8         // sensor values per record
+#define RUN_LOG_NOTE 64           // longest note, including the terminating zero
+#define RUN_LOG_INITIAL (64 << 20) // bytes mapped when recording starts; the file grows by doubling
+
+enum run_record_type {
+	RUN_FRAME = 1,   // run_frame_header followed by width * height * 3 BGR bytes
+	RUN_BLOBS,       // run_blobs
+	RUN_SENSORS,     // run_sensors
+	RUN_DRIVE,       // run_drive
+	RUN_NOTE,        // zero-terminated text
+};
+
+typedef struct run_log_header {
+	char magic[4];
+	unsigned int version;
+	unsigned long long end;          // offset just past the last complete record
+	unsigned long long index_offset; // where the index starts, 0 if recording did not stop cleanly
+	unsigned long long record_count; // records in the index
+	unsigned long long start_time;   // systime() when recording started
+} run_log_header;
+
+// Every record starts 8-byte aligned with this header
+typedef struct run_record {
+	unsigned int type;               // run_record_type
+	unsigned int size;               // payload bytes following this header
+	unsigned long long time;         // systime() when it was recorded
+} run_record;
+
+typedef struct run_frame_header {
+	unsigned long long sequence;     // camera frame number, matches the run_blobs of the same frame
+	unsigned int width, height;
+} run_frame_header;
+
+typedef struct run_blobs {
+	unsigned long long sequence;
+	int count[RUN_LOG_CHANNELS];
+	seg_blob blobs[RUN_LOG_CHANNELS][SEG_MAX_BLOBS]; // largest first, only the first count (at most SEG_MAX_BLOBS) valid
+} run_blobs;
+
+typedef struct run_sensors {
+	int count;
+	int values[RUN_LOG_SENSORS];
+} run_sensors;
+
+typedef struct run_drive {
+	float left, right;               // as passed to drive()
+	float seconds;
+} run_drive;
+
+// RECORDING (one log per process; every call is safe from any thread and does nothing while not recording)
+bool run_log_start(const char *path, unsigned long long start_time);  // false if the file could not be created
+void run_log_stop();                                                  // write the index and close the file
+bool run_log_active();
+void run_log_append(unsigned int type, unsigned long long time, const void *payload, size_t size);
+void run_log_frame(unsigned long long time, unsigned long long sequence, const unsigned char *bgr, int width, int height);
+void run_log_blobs(unsigned long long time, const run_blobs *blobs);
+void run_log_sensors(unsigned long long time, const int *values, int count);
+void run_log_drive(unsigned long long time, float left, float right, float seconds);
+void run_log_note(unsigned long long time, const char *text);
+
+// READING
+typedef struct run_log_reader {
+	const unsigned char *data;       // the whole file, mapped read-only
+	size_t length;
+	const run_log_header *header;
+	const unsigned long long *offsets; // offset of every record (the file's index, or rebuilt by walking the records)
+	bool rebuilt;                    // offsets were allocated because the log has no index or a damaged one
+	unsigned long long record_count;
+	unsigned long long next;         // record run_log_next returns next
+} run_log_reader;
+
+bool run_log_open(run_log_reader *reader, const char *path);  // false if the file is missing or not a run log
+void run_log_close(run_log_reader *reader);
+// Next: the next record and its payload (pointing into the mapped file), NULL at the end of the log. Every record and
+// its record->size payload bytes lie inside the file; whether the payload is as long as its type needs is up to the caller.
+const run_record *run_log_next(run_log_reader *reader, const void **payload);
+const run_record *run_log_record(const run_log_reader *reader, unsigned long long index, const void **payload);
+
+#endif
@@ -0,0 +1,99 @@
+/*
+Incremental sensor filters (see sensor-filter.h).
+*/
+
+#include "sensor-filter.h"
+
+void median5_init(median5 *filter)
+{
+	filter->count = 0;
+	filter->next = 0;
+}
+
+// Sort 2: put the smaller of two values in "a"
+#define SORT2(a, b) do { if ((a) > (b)) { int swap = (a); (a) = (b); (b) = swap; } } while (0)
+
+int median5_update(median5 *filter, int sample)
+{
+	filter->window[filter->next] = sample;
+	filter->next = filter->next == 4 ? 0 : filter->next + 1;
+	if (filter->count < 5) {
+		filter->count++;
+		if (filter->count < 5) {
+			return sample; // not enough history yet to vote a spike out
+		}
+	}
+	// Median of five with a fixed network of seven compare-exchanges
+	int a = filter->window[0], b = filter->window[1], c = filter->window[2], d = filter->window[3], e = filter->window[4];
+	SORT2(a, b);
+	SORT2(d, e);
+	SORT2(a, d); // a is now the smallest of a, b, d, e and drops out
+	SORT2(b, e); // e is now the largest of b, d, e and drops out
+	SORT2(c, b);
+	SORT2(d, c);
+	SORT2(c, b); // c is the median of b, c, d
+	return c;
+}
+
+void ema_init(ema *filter, float alpha)
+{
+	filter->alpha = alpha;
+	filter->value = 0;
+	filter->primed = false;
+}
+
+float ema_update(ema *filter, float sample)
+{
+	if (!filter->primed) {
+		filter->value = sample;
+		filter->primed = true;
+	} else {
+		filter->value += filter->alpha * (sample - filter->value);
+	}
+	return filter->value;
+}
+
+void hysteresis_init(hysteresis *comparator, int margin)
+{
+	comparator->margin = margin;
+	comparator->above = false;
+}
+
+bool hysteresis_update(hysteresis *comparator, int value, int threshold)
+{
+	if (comparator->above) {
+		comparator->above = value >= threshold - comparator->margin;
+	} else {
+		comparator->above = value > threshold;
+	}
+	return comparator->above;
+}
+
+void debounce_init(debounce *input, int limit)
+{
+	input->limit = limit > 0 ? limit : 1;
+	input->level = 0;
+	input->state = false;
+}
+
+bool debounce_update(debounce *input, bool pressed)
+{
+	if (pressed) {
+		if (input->level < input->limit) {
+			input->level++;
+		}
+	} else if (input->level > 0) {
+		input->level--;
+	}
+	if (input->level == input->limit) {
+		input->state = true;
+	} else if (input->level == 0) {
+		input->state = false;
+	}
+	return input->state;
+}
+
+bool debounce_settling(const debounce *input)
+{
+	return input->state ? input->level < input->limit : input->level > 0;
+}
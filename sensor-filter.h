@@ -0,0 +1,57 @@
+/*
+Incremental filters for the pollinator robots' sensor streams.
+
+Single raw samples are noisy: one IR spike is enough to trigger avoid() and its 0.9 s turn, and a bumper contact
+bounces for a few milliseconds. These filters are fed every sample of a sensor (see sensor-thread.h) and each update
+costs constant time with no allocation, so they can run at the full sampling rate:
+
+    median5     running median of the last five samples, removes single-sample spikes
+    ema         exponential moving average, smooths what is left
+    hysteresis  threshold comparator that only turns off again a margin below the threshold
+    debounce    integrator for a digital input, changes state only after it has held for a number of samples
+
+All of them are plain structs that can be declared static and zero-initialized before the first *_init call.
+*/
+
+#ifndef SENSOR_FILTER_H
+#define SENSOR_FILTER_H
+
+#include <stdbool.h> // Boolean support
+
+typedef struct median5 {
+	int window[5]; // last five samples, oldest overwritten first
+	int count;     // samples seen, up to 5
+	int next;      // slot for the next sample
+} median5;
+
+typedef struct ema {
+	float alpha;   // weight of the newest sample (0..1]
+	float value;
+	bool primed;   // false until the first sample, which is taken as is
+} ema;
+
+typedef struct hysteresis {
+	int margin;    // the value has to fall this far below the threshold before the comparator turns off
+	bool above;
+} hysteresis;
+
+typedef struct debounce {
+	int limit;     // samples the input has to hold before the state follows it
+	int level;     // integrator, 0 .. limit
+	bool state;
+} debounce;
+
+void median5_init(median5 *filter);
+int median5_update(median5 *filter, int sample);          // add a sample, returns the median of the last five
+
+void ema_init(ema *filter, float alpha);
+float ema_update(ema *filter, float sample);               // add a sample, returns the new average
+
+void hysteresis_init(hysteresis *comparator, int margin);
+bool hysteresis_update(hysteresis *comparator, int value, int threshold); // true above "threshold" until below it by "margin"
+
+void debounce_init(debounce *input, int limit);
+bool debounce_update(debounce *input, bool pressed);       // add a sample, returns the debounced state
+bool debounce_settling(const debounce *input);             // true while the input disagrees with the state it reports
+
+#endif
@@ -0,0 +1,207 @@
+/*
+Background sensor sampling (see sensor-thread.h).
+
+Every slot of the ring has its own version counter (a seqlock). Sample n goes into slot n % SENSOR_RING; while it is
+being written the slot's version is 2n - 1, and 2n once it is complete. A reader that wants sample n checks for 2n
+before and after copying, so it notices both a write in progress and a slot that the writer has since reused for a
+newer sample. The writer never waits for readers.
+
+A ROBOT_VIRTUAL_TIME build (see robot-clock.h) has no sampling thread: the readers take one pass over the pins
+themselves when a period has gone by since the last one, and a bumper change needs no wake because the loop is the
+one reading it.
+*/
+
+#include "sensor-thread.h"
+#include "robot-clock.h" // sample times, waking the control loop on a bump
+#include <kipr/wombat.h> // analog_et, digital
+#include <pthread.h>     // sampling thread
+#include <stdatomic.h>   // lock-free publishing
+#include <time.h>        // clock_nanosleep
+
+typedef struct sensor_slot {
+	atomic_ullong version;  // 2n once sample n is complete, odd while it is being written
+	sensor_sample sample;
+} sensor_slot;
+
+static sensor_slot ring[SENSOR_RING];
+static atomic_ullong published;         // number of the newest complete sample
+static atomic_bool running;
+static sensor_pin sampled_pins[SENSOR_MAX_PINS];
+static int pin_count;
+static long period_ns;
+#if !ROBOT_VIRTUAL_TIME
+static pthread_t sampling_thread;
+#endif
+
+// Publish: write sample "sample->sequence" into its slot and then make it the newest one
+static void publish(const sensor_sample *sample)
+{
+	unsigned long long n = sample->sequence;
+	sensor_slot *slot = &ring[n % SENSOR_RING];
+
+	atomic_store_explicit(&slot->version, 2 * n - 1, memory_order_relaxed); // mark the slot as being written
+	atomic_thread_fence(memory_order_release);
+	slot->sample = *sample;
+	atomic_store_explicit(&slot->version, 2 * n, memory_order_release);   // slot is consistent again
+
+	atomic_store_explicit(&published, n, memory_order_release);
+}
+
+// Read Sample: copy sample "n" if the ring still holds it
+static bool read_sample(unsigned long long n, sensor_sample *sample)
+{
+	const sensor_slot *slot = &ring[n % SENSOR_RING];
+	if (atomic_load_explicit(&slot->version, memory_order_acquire) != 2 * n) {
+		return false; // being written, or already reused for a newer sample
+	}
+	*sample = slot->sample;
+	atomic_thread_fence(memory_order_acquire);
+	return atomic_load_explicit(&slot->version, memory_order_relaxed) == 2 * n;
+}
+
+// Sample: read every pin once and publish the pass; true if a digital pin changed since "previous"
+static bool sample_pins(sensor_sample *sample, const sensor_sample *previous)
+{
+	sample->sequence++;
+	sample->time = robot_time_us();
+	bool bumped = false;
+	for (int i = 0; i < pin_count; i++) {
+		if (sampled_pins[i].kind == SENSOR_DIGITAL) {
+			sample->values[i] = digital(sampled_pins[i].pin);
+			bumped |= sample->sequence > 1 && sample->values[i] != previous->values[i];
+		} else {
+			sample->values[i] = analog_et(sampled_pins[i].pin);
+		}
+	}
+	publish(sample);
+	return bumped;
+}
+
+// Start Ring: empty the ring for a new run
+static void start_ring(const sensor_pin *pins, int count, int rate)
+{
+	pin_count = count < SENSOR_MAX_PINS ? count : SENSOR_MAX_PINS;
+	for (int i = 0; i < pin_count; i++) {
+		sampled_pins[i] = pins[i];
+	}
+	period_ns = 1000000000L / rate;
+	for (int i = 0; i < SENSOR_RING; i++) {
+		atomic_store(&ring[i].version, 0);
+	}
+	atomic_store(&published, 0);
+}
+
+#if ROBOT_VIRTUAL_TIME
+static sensor_sample sampled;            // the pass the control loop took last
+static unsigned long long next_sample;   // robot_time_us() at which the next pass is due
+
+// Sample Due: no sampling thread, so the readers take a pass themselves once a period has gone by
+static void sample_due()
+{
+	if (atomic_load(&running) && robot_time_us() >= next_sample) {
+		sensor_sample previous = sampled;
+		sample_pins(&sampled, &previous);
+		next_sample = sampled.time + period_ns / 1000;
+	}
+}
+
+bool sensor_thread_start(const sensor_pin *pins, int count, int rate)
+{
+	if (atomic_load(&running) || count < 1 || rate < 1) {
+		return false;
+	}
+	start_ring(pins, count, rate);
+	sampled = (sensor_sample){0};
+	next_sample = 0;
+	atomic_store(&running, true);
+	return true;
+}
+
+void sensor_thread_stop()
+{
+	atomic_store(&running, false);
+}
+#else
+#define sample_due()
+
+// Sampling Loop: read every pin once per period until stopped; the period is kept against absolute deadlines so a
+// slow pass does not shift the ones after it
+static void *sampling_loop(void *unused)
+{
+	(void)unused;
+	sensor_sample sample = {0};
+	sensor_sample previous = {0};
+	struct timespec next;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (atomic_load_explicit(&running, memory_order_relaxed)) {
+		if (sample_pins(&sample, &previous)) {
+			robot_wake(); // a bumper changed, the control loop should not wait for its deadline
+		}
+		previous = sample;
+
+		next.tv_nsec += period_ns;
+		while (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+	return NULL;
+}
+
+bool sensor_thread_start(const sensor_pin *pins, int count, int rate)
+{
+	if (atomic_load(&running) || count < 1 || rate < 1) {
+		return false;
+	}
+	start_ring(pins, count, rate);
+	atomic_store(&running, true);
+	if (pthread_create(&sampling_thread, NULL, sampling_loop, NULL) != 0) {
+		atomic_store(&running, false);
+		return false;
+	}
+	return true;
+}
+
+void sensor_thread_stop()
+{
+	if (atomic_exchange(&running, false)) {
+		pthread_join(sampling_thread, NULL);
+	}
+}
+#endif
+
+bool sensor_latest(sensor_sample *sample)
+{
+	sample_due();
+	while (true) {
+		unsigned long long n = atomic_load_explicit(&published, memory_order_acquire);
+		if (n == 0) {
+			return false;
+		}
+		if (read_sample(n, sample)) {
+			return true;
+		}
+		// the writer lapped the whole ring during the copy; the newest sample is a later one now
+	}
+}
+
+int sensor_history(sensor_sample *samples, int count)
+{
+	return sensor_history_since(0, samples, count);
+}
+
+int sensor_history_since(unsigned long long after, sensor_sample *samples, int count)
+{
+	sample_due();
+	unsigned long long newest = atomic_load_explicit(&published, memory_order_acquire);
+	int copied = 0;
+	while (copied < count && copied < SENSOR_RING && newest - copied > after) {
+		if (!read_sample(newest - copied, &samples[copied])) {
+			break; // older samples have been overwritten
+		}
+		copied++;
+	}
+	return copied;
+}
@@ -0,0 +1,46 @@
+/*
+Background sensor sampling for the pollinator robots.
+
+A sampling thread reads the IR, photo and bumper pins at a fixed rate and publishes every pass, stamped with the
+monotonic time in microseconds, into a ring of the last SENSOR_RING samples. The control loop takes the newest sample
+with "sensor_latest" instead of doing ten analog_et/digital calls inline each tick, and filters can look back over the
+history with "sensor_history" without reading the pins again. There is one writer and any number of readers; none of
+them ever takes a lock.
+
+A change on any digital pin (a bumper) wakes the control loop (robot_wake), so it reacts to a bump without waiting for
+the current drive command to run out.
+*/
+
+#ifndef SENSOR_THREAD_H
+#define SENSOR_THREAD_H
+
+#include <stdbool.h> // Boolean support
+
+#define SENSOR_MAX_PINS 16  // pins sampled per pass
+#define SENSOR_RING 256     // samples kept (power of two); half a second of history at 500 Hz
+#define SENSOR_RATE 500     // default passes per second
+
+#define SENSOR_ANALOG 0     // read with analog_et
+#define SENSOR_DIGITAL 1    // read with digital
+
+typedef struct sensor_pin {
+	int kind;  // SENSOR_ANALOG or SENSOR_DIGITAL
+	int pin;
+} sensor_pin;
+
+// One pass over all pins, published as a whole so readers never mix two passes
+typedef struct sensor_sample {
+	unsigned long long sequence;  // pass number, increases by one for every published pass (0 = no sample yet)
+	unsigned long long time;      // robot_time_us() when the pass started
+	int values[SENSOR_MAX_PINS];  // in the order the pins were given to sensor_thread_start
+} sensor_sample;
+
+// Start: sample "pins" (at most SENSOR_MAX_PINS) "rate" times per second; false if the thread could not be started
+bool sensor_thread_start(const sensor_pin *pins, int count, int rate);
+void sensor_thread_stop();                      // stop the sampling thread and wait for it to exit
+
+bool sensor_latest(sensor_sample *sample);      // copy the newest sample without blocking; false if there is none yet
+int sensor_history(sensor_sample *samples, int count); // copy up to "count" samples, newest first; returns how many
+int sensor_history_since(unsigned long long after, sensor_sample *samples, int count); // only samples newer than "after"
+
+#endif
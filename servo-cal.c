@@ -0,0 +1,91 @@
+/*
+Wheel calibration (see servo-cal.h).
+*/
+
+#include "servo-cal.h"
+#include <ctype.h>   // isspace
+#include <stdio.h>   // fopen, fgets
+#include <string.h>  // strcmp
+
+void servo_cal_default(servo_calibration *cal)
+{
+	servo_wheel wheel = {SERVO_STOP_LOW, SERVO_STOP_HIGH, SERVO_POSITION_MAX, 0, 1000};
+	cal->left = wheel;
+	wheel.forward_full = 0;
+	wheel.reverse_full = SERVO_POSITION_MAX;
+	cal->right = wheel;
+}
+
+// Field: the calibration value a key names, NULL if none
+static int *field(servo_calibration *cal, const char *key)
+{
+	static const char *names[] = {"stop_low", "stop_high", "forward_full", "reverse_full", "trim"};
+	servo_wheel *wheel;
+	if (strncmp(key, "left_", 5) == 0) {
+		wheel = &cal->left;
+		key += 5;
+	} else if (strncmp(key, "right_", 6) == 0) {
+		wheel = &cal->right;
+		key += 6;
+	} else {
+		return NULL;
+	}
+	int *fields[] = {&wheel->stop_low, &wheel->stop_high, &wheel->forward_full, &wheel->reverse_full, &wheel->trim};
+	for (int i = 0; i < 5; i++) {
+		if (strcmp(key, names[i]) == 0) {
+			return fields[i];
+		}
+	}
+	return NULL;
+}
+
+bool servo_cal_load(servo_calibration *cal, const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		return false;
+	}
+	char line[256];
+	while (fgets(line, sizeof(line), file)) {
+		char key[128];
+		int value;
+		if (sscanf(line, " %127[^= \t] = %d", key, &value) != 2 || key[0] == '#') {
+			continue;
+		}
+		int *target = field(cal, key);
+		if (target) {
+			*target = value;
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+// Build Wheel: positions for all speeds of one wheel, integer math only
+static void build_wheel(short *positions, const servo_wheel *wheel)
+{
+	int center = (wheel->stop_low + wheel->stop_high) / 2;
+	for (int speed = -SERVO_SPEED_MAX; speed <= SERVO_SPEED_MAX; speed++) {
+		int trimmed = speed * wheel->trim / 1000;
+		if (trimmed > SERVO_SPEED_MAX) {
+			trimmed = SERVO_SPEED_MAX;
+		} else if (trimmed < -SERVO_SPEED_MAX) {
+			trimmed = -SERVO_SPEED_MAX;
+		}
+		int position = center;
+		if (trimmed != 0) {
+			int full = trimmed > 0 ? wheel->forward_full : wheel->reverse_full;
+			int magnitude = trimmed > 0 ? trimmed : -trimmed;
+			// Start at the edge of the dead band on the side of "full", so the smallest speed already turns the wheel
+			int edge = full > center ? wheel->stop_high + 1 : wheel->stop_low - 1;
+			position = edge + (full - edge) * magnitude / SERVO_SPEED_MAX;
+		}
+		positions[speed + SERVO_SPEED_MAX] = (short)position;
+	}
+}
+
+void servo_cal_build(servo_table *table, const servo_calibration *cal)
+{
+	build_wheel(table->left, &cal->left);
+	build_wheel(table->right, &cal->right);
+}
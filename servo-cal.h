@@ -0,0 +1,61 @@
+/*
+Per-robot wheel calibration for the pollinator robots.
+
+The wheels are continuous-rotation servos, and no two of them agree on where "stopped" is or how fast a given
+position turns them. drive() used to map the speed linearly onto 0..2047 with float math, which puts zero at 1023
+(outside the ~1044-1055 band in which the servos actually stop), and forward() wrote hand-tuned positions that differed
+per robot. Here each wheel has a calibration: its dead band, the positions for full speed in either direction (so
+forward and reverse can have different gains) and a trim that slows the stronger wheel. From it a lookup table is built
+once at startup, and a speed in per mille (-1000 .. 1000, positive is forward) becomes a servo position with one array
+read and no float math.
+
+The defaults below fit an uncalibrated robot; a robot with different servos keeps its own values in SERVO_CAL_FILE.
+*/
+
+#ifndef SERVO_CAL_H
+#define SERVO_CAL_H
+
+#include <stdbool.h> // Boolean support
+
+#define SERVO_SPEED_MAX 1000          // full speed (per mille)
+#define SERVO_CAL_FILE "servo.cal"    // per-robot calibration, "left_stop_low = 1044" lines; missing keys keep the default
+
+// Defaults: the servo stops between SERVO_STOP_LOW and SERVO_STOP_HIGH; the left wheel turns forward towards 2047 and
+// the right wheel (mounted the other way round) towards 0
+#define SERVO_STOP_LOW 1044
+#define SERVO_STOP_HIGH 1055
+#define SERVO_POSITION_MAX 2047
+
+typedef struct servo_wheel {
+	int stop_low, stop_high;  // dead band: the wheel does not turn between these positions
+	int forward_full;         // position for full speed forward
+	int reverse_full;         // position for full speed backward
+	int trim;                 // per mille of the requested speed this wheel actually gets (1000 = none)
+} servo_wheel;
+
+typedef struct servo_calibration {
+	servo_wheel left, right;
+} servo_calibration;
+
+// Lookup table: position for every speed from -SERVO_SPEED_MAX to SERVO_SPEED_MAX
+typedef struct servo_table {
+	short left[2 * SERVO_SPEED_MAX + 1];
+	short right[2 * SERVO_SPEED_MAX + 1];
+} servo_table;
+
+void servo_cal_default(servo_calibration *cal);
+bool servo_cal_load(servo_calibration *cal, const char *path); // override from a file; false if it cannot be read
+void servo_cal_build(servo_table *table, const servo_calibration *cal);
+
+// Servo Position: position for "speed" (per mille, clamped) from one wheel's table
+static inline int servo_position(const short *wheel, int speed)
+{
+	if (speed > SERVO_SPEED_MAX) {
+		speed = SERVO_SPEED_MAX;
+	} else if (speed < -SERVO_SPEED_MAX) {
+		speed = -SERVO_SPEED_MAX;
+	}
+	return wheel[speed + SERVO_SPEED_MAX];
+}
+
+#endif
@@ -0,0 +1,618 @@
+/*
+Many-robot arena simulator (see swarm-sim.h).
+
+The robot's body and sensors are those of the single-robot backend (headless/backend-sim.c): the IR sensors are two
+rays 30 degrees either side of the heading that see walls and other robots, the camera sees the nearest flower of the
+wanted color inside its field of view, and the gripper reaches 15 cm past the front of the robot.
+*/
+
+#include "swarm-sim.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SWARM_RADIUS 12.0f        // cm
+#define SWARM_WHEEL_BASE 16.0f    // cm between the wheels
+#define SWARM_SPEED 30.0f         // cm/s at full speed
+
+#define SWARM_IR_ANGLE 0.52f      // rad either side of the heading the IR sensors look (30 degrees)
+#define SWARM_IR_RANGE 40.0f      // cm past the front of the robot an IR sensor sees
+#define SWARM_IR_AVOID 15.0f      // cm at which the robot turns away from what an IR sensor sees
+#define SWARM_CAMERA_FOV 1.05f    // rad of horizontal field of view (60 degrees)
+#define SWARM_CAMERA_RANGE 150.0f // cm the camera can still make out a flower at
+#define SWARM_GRIP_REACH 15.0f    // cm past the front of the robot the gripper can take a flower from
+#define SWARM_POLLINATED 30.0f    // cm between a flower and pollen for the flower to count as pollinated
+
+#define SWARM_ESCAPE_TIME 400     // ms of backing off after a bump or a drop
+#define SWARM_AVOID_TIME 300      // ms of turning away from an IR contact
+
+#define SWARM_DROP -2             // request: put down the flower in the gripper
+
+enum {
+	MODE_SEARCH_TURN,             // spin in place looking for a flower
+	MODE_SEARCH_LEG,              // then drive straight for a while
+	MODE_AVOID,                   // turning away from something an IR sensor sees
+	MODE_ESCAPE                   // backing off a bump
+};
+
+enum {
+	PHASE_SENSE,
+	PHASE_MOVE
+};
+
+static float random_unit(unsigned int *state)
+{
+	return (float)rand_r(state) / RAND_MAX;
+}
+
+static float wrap_angle(float angle)
+{
+	while (angle > (float)M_PI) {
+		angle -= 2 * (float)M_PI;
+	}
+	while (angle < -(float)M_PI) {
+		angle += 2 * (float)M_PI;
+	}
+	return angle;
+}
+
+//===================================//
+//================GRID===============//
+//===================================//
+
+static bool grid_init(swarm_grid *grid, const swarm *world, int count)
+{
+	grid->cells_x = (int)ceilf(world->width / SWARM_CELL);
+	grid->cells_y = (int)ceilf(world->height / SWARM_CELL);
+	grid->start = calloc((size_t)grid->cells_x * grid->cells_y + 1, sizeof(int));
+	grid->items = calloc(count > 0 ? count : 1, sizeof(int));
+	grid->cell = calloc(count > 0 ? count : 1, sizeof(int));
+	return grid->start && grid->items && grid->cell;
+}
+
+static void grid_free(swarm_grid *grid)
+{
+	free(grid->start);
+	free(grid->items);
+	free(grid->cell);
+}
+
+static int cell_x(const swarm_grid *grid, float x)
+{
+	int cell = (int)(x / SWARM_CELL);
+	return cell < 0 ? 0 : cell >= grid->cells_x ? grid->cells_x - 1 : cell;
+}
+
+static int cell_y(const swarm_grid *grid, float y)
+{
+	int cell = (int)(y / SWARM_CELL);
+	return cell < 0 ? 0 : cell >= grid->cells_y ? grid->cells_y - 1 : cell;
+}
+
+// Grid Build: counting sort of "count" points into their cells, skipping those whose "skip" entry is set (>= 0)
+static void grid_build(swarm_grid *grid, const float *x, const float *y, int count, const int *skip)
+{
+	int cells = grid->cells_x * grid->cells_y;
+	memset(grid->start, 0, (cells + 1) * sizeof(int));
+	for (int i = 0; i < count; i++) {
+		int cell = skip && skip[i] >= 0 ? -1 : cell_y(grid, y[i]) * grid->cells_x + cell_x(grid, x[i]);
+		grid->cell[i] = cell;
+		if (cell >= 0) {
+			grid->start[cell]++;
+		}
+	}
+	for (int cell = 1; cell <= cells; cell++) {
+		grid->start[cell] += grid->start[cell - 1]; // end of each cell
+	}
+	for (int i = count - 1; i >= 0; i--) {
+		if (grid->cell[i] >= 0) {
+			grid->items[--grid->start[grid->cell[i]]] = i; // leaves start[cell] at the cell's first item
+		}
+	}
+}
+
+// Grid Range: the cells (inclusive) that hold every point within "reach" of (x, y)
+static void grid_range(const swarm_grid *grid, float x, float y, float reach, int *x0, int *x1, int *y0, int *y1)
+{
+	*x0 = cell_x(grid, x - reach);
+	*x1 = cell_x(grid, x + reach);
+	*y0 = cell_y(grid, y - reach);
+	*y1 = cell_y(grid, y + reach);
+}
+
+//===================================//
+//==============SENSING==============//
+//===================================//
+
+// Ray: cm from the robot's edge to the first wall or robot along "angle", up to SWARM_IR_RANGE
+static float ray(const swarm *world, int robot, float angle)
+{
+	float x = world->x[robot], y = world->y[robot];
+	float dx = cosf(angle), dy = sinf(angle);
+	float nearest = SWARM_RADIUS + SWARM_IR_RANGE;
+	if (dx > 0) {
+		nearest = fminf(nearest, (world->width - x) / dx);
+	} else if (dx < 0) {
+		nearest = fminf(nearest, -x / dx);
+	}
+	if (dy > 0) {
+		nearest = fminf(nearest, (world->height - y) / dy);
+	} else if (dy < 0) {
+		nearest = fminf(nearest, -y / dy);
+	}
+
+	const swarm_grid *grid = &world->robot_grid;
+	int x0, x1, y0, y1;
+	grid_range(grid, x, y, 2 * SWARM_RADIUS + SWARM_IR_RANGE, &x0, &x1, &y0, &y1);
+	for (int cy = y0; cy <= y1; cy++) {
+		for (int cx = x0; cx <= x1; cx++) {
+			int cell = cy * grid->cells_x + cx;
+			for (int k = grid->start[cell]; k < grid->start[cell + 1]; k++) {
+				int other = grid->items[k];
+				if (other == robot) {
+					continue;
+				}
+				float ox = world->x[other] - x, oy = world->y[other] - y;
+				float along = ox * dx + oy * dy;
+				float across = ox * ox + oy * oy - along * along;
+				if (along <= 0 || across >= SWARM_RADIUS * SWARM_RADIUS) {
+					continue;
+				}
+				nearest = fminf(nearest, along - sqrtf(SWARM_RADIUS * SWARM_RADIUS - across));
+			}
+		}
+	}
+	return nearest - SWARM_RADIUS;
+}
+
+// Camera: nearest flower of the wanted color in the field of view, or -1; its distance and bearing
+static int camera(const swarm *world, int robot, float *distance, float *bearing)
+{
+	const swarm_grid *grid = &world->flower_grid;
+	float x = world->x[robot], y = world->y[robot], heading = world->heading[robot];
+	float dx = cosf(heading), dy = sinf(heading), cone = cosf(SWARM_CAMERA_FOV / 2);
+	bool carrying = world->held[robot] >= 0;
+	int best = -1;
+	float best_squared = SWARM_CAMERA_RANGE * SWARM_CAMERA_RANGE;
+	int x0, x1, y0, y1;
+	grid_range(grid, x, y, SWARM_CAMERA_RANGE, &x0, &x1, &y0, &y1);
+	for (int cy = y0; cy <= y1; cy++) {
+		for (int cx = x0; cx <= x1; cx++) {
+			int cell = cy * grid->cells_x + cx;
+			for (int k = grid->start[cell]; k < grid->start[cell + 1]; k++) {
+				int flower = grid->items[k];
+				bool wanted = carrying ? world->color[flower] == SWARM_BLUE
+									   : world->color[flower] == SWARM_RED && !world->pollinated[flower];
+				if (!wanted) {
+					continue;
+				}
+				float fx = world->flower_x[flower] - x, fy = world->flower_y[flower] - y;
+				float squared = fx * fx + fy * fy;
+				float along = fx * dx + fy * dy;
+				if (squared < best_squared && along > 0 && along * along >= cone * cone * squared) {
+					best = flower;
+					best_squared = squared;
+				}
+			}
+		}
+	}
+	if (best >= 0) {
+		*distance = sqrtf(best_squared);
+		*bearing = wrap_angle(atan2f(world->flower_y[best] - y, world->flower_x[best] - x) - heading);
+	}
+	return best;
+}
+
+//===================================//
+//=============CONTROLLER============//
+//===================================//
+
+static void drive(swarm *world, int robot, float left, float right)
+{
+	world->left[robot] = left * SWARM_SPEED;
+	world->right[robot] = right * SWARM_SPEED;
+}
+
+// Decide: one control tick of the ethology behaviors, highest first: escape, avoid, approach and grab or drop, search
+static void decide(swarm *world, int robot)
+{
+	world->request[robot] = -1;
+	int *timer = &world->timer[robot];
+	unsigned char *mode = &world->mode[robot];
+
+	if (world->touching[robot] && *mode != MODE_ESCAPE) {
+		float swerve = random_unit(&world->random[robot]) < 0.5f ? 0.3f : -0.3f;
+		*mode = MODE_ESCAPE;
+		*timer = SWARM_ESCAPE_TIME;
+		drive(world, robot, -0.6f + swerve, -0.6f - swerve);
+		return;
+	}
+	if (*mode == MODE_ESCAPE || *mode == MODE_AVOID) {
+		*timer -= SWARM_STEP;
+		if (*timer > 0) {
+			return; // keep the maneuver's wheel speeds
+		}
+		*mode = MODE_SEARCH_TURN;
+		*timer = 500 + rand_r(&world->random[robot]) % 1500;
+	}
+
+	float heading = world->heading[robot];
+	float right_ir = ray(world, robot, heading - SWARM_IR_ANGLE), left_ir = ray(world, robot, heading + SWARM_IR_ANGLE);
+	if (left_ir < SWARM_IR_AVOID || right_ir < SWARM_IR_AVOID) {
+		*mode = MODE_AVOID;
+		*timer = SWARM_AVOID_TIME;
+		if (left_ir < right_ir) {
+			drive(world, robot, 0.5f, -0.5f); // turn right
+		} else {
+			drive(world, robot, -0.5f, 0.5f);
+		}
+		return;
+	}
+
+	float distance, bearing;
+	int flower = camera(world, robot, &distance, &bearing);
+	if (flower >= 0) {
+		if (distance < SWARM_RADIUS + SWARM_GRIP_REACH && fabsf(bearing) < SWARM_IR_ANGLE) {
+			world->request[robot] = world->held[robot] >= 0 ? SWARM_DROP : flower;
+			drive(world, robot, 0, 0);
+			return;
+		}
+		float turn = bearing / (SWARM_CAMERA_FOV / 2); // -1 .. 1, positive to the left
+		drive(world, robot, 1 - 0.8f * turn, 1 + 0.8f * turn);
+		return;
+	}
+
+	*timer -= SWARM_STEP;
+	if (*timer <= 0) {
+		*mode = *mode == MODE_SEARCH_TURN ? MODE_SEARCH_LEG : MODE_SEARCH_TURN;
+		*timer = (*mode == MODE_SEARCH_TURN ? 500 : 1000) + rand_r(&world->random[robot]) % 2000;
+	}
+	if (*mode == MODE_SEARCH_TURN) {
+		drive(world, robot, -0.4f, 0.4f);
+	} else {
+		drive(world, robot, 1, 1);
+	}
+}
+
+//===================================//
+//==============PHYSICS==============//
+//===================================//
+
+// Move: drive for one step, then push out of walls and other robots (as they were at the start of the step)
+static void move(swarm *world, int robot, swarm_totals *totals)
+{
+	float dt = SWARM_STEP / 1000.0f;
+	float left = world->left[robot], right = world->right[robot];
+	float speed = (left + right) / 2, heading = world->heading[robot];
+	float x = world->x[robot] + speed * cosf(heading) * dt;
+	float y = world->y[robot] + speed * sinf(heading) * dt;
+	world->next_heading[robot] = wrap_angle(heading + (right - left) / SWARM_WHEEL_BASE * dt);
+	totals->distance += fabsf(speed) * dt;
+
+	bool touching = false;
+	const swarm_grid *grid = &world->robot_grid;
+	int x0, x1, y0, y1;
+	grid_range(grid, x, y, 2 * SWARM_RADIUS, &x0, &x1, &y0, &y1);
+	for (int cy = y0; cy <= y1; cy++) {
+		for (int cx = x0; cx <= x1; cx++) {
+			int cell = cy * grid->cells_x + cx;
+			for (int k = grid->start[cell]; k < grid->start[cell + 1]; k++) {
+				int other = grid->items[k];
+				if (other == robot) {
+					continue;
+				}
+				float ox = x - world->x[other], oy = y - world->y[other];
+				float apart = sqrtf(ox * ox + oy * oy);
+				if (apart >= 2 * SWARM_RADIUS) {
+					continue;
+				}
+				// Each robot of the pair takes half of the overlap
+				float push = (2 * SWARM_RADIUS - apart) / 2;
+				if (apart > 0.001f) {
+					x += ox / apart * push;
+					y += oy / apart * push;
+				} else {
+					x += robot < other ? -push : push;
+				}
+				touching = true;
+				if (robot < other) {
+					totals->contacts++;
+				}
+			}
+		}
+	}
+
+	float low = SWARM_RADIUS, high_x = world->width - SWARM_RADIUS, high_y = world->height - SWARM_RADIUS;
+	if (x < low || x > high_x || y < low || y > high_y) {
+		x = fminf(fmaxf(x, low), high_x);
+		y = fminf(fmaxf(y, low), high_y);
+		touching = true;
+		totals->bumps++;
+	}
+	world->next_x[robot] = x;
+	world->next_y[robot] = y;
+	world->touching[robot] = touching;
+}
+
+//===================================//
+//===============STEP================//
+//===================================//
+
+static void run_slice(swarm_thread *member)
+{
+	swarm *world = member->world;
+	int begin = (int)((long)world->count * member->index / world->threads);
+	int end = (int)((long)world->count * (member->index + 1) / world->threads);
+	for (int robot = begin; robot < end; robot++) {
+		if (world->phase == PHASE_SENSE) {
+			decide(world, robot);
+		} else {
+			move(world, robot, &member->totals);
+		}
+	}
+}
+
+static void *team_worker(void *argument)
+{
+	swarm_thread *member = argument;
+	swarm *world = member->world;
+	pthread_mutex_lock(&world->start_lock); // held by swarm_init until the barriers are ready
+	pthread_mutex_unlock(&world->start_lock);
+	for (;;) {
+		pthread_barrier_wait(&world->phase_start);
+		if (world->quit) {
+			return NULL;
+		}
+		run_slice(member);
+		pthread_barrier_wait(&world->phase_done);
+	}
+}
+
+// Run Phase: every thread steps its slice of the robots; the barriers order the phases' memory for all of them
+static void run_phase(swarm *world, int phase)
+{
+	world->phase = phase;
+	if (world->threads > 1) {
+		pthread_barrier_wait(&world->phase_start);
+	}
+	run_slice(&world->team[0]);
+	if (world->threads > 1) {
+		pthread_barrier_wait(&world->phase_done);
+	}
+}
+
+// Front: where the gripper holds a flower
+static void front(const swarm *world, int robot, float *x, float *y)
+{
+	*x = world->x[robot] + (SWARM_RADIUS + 5) * cosf(world->heading[robot]);
+	*y = world->y[robot] + (SWARM_RADIUS + 5) * sinf(world->heading[robot]);
+}
+
+// Next To Pollen: a blue within SWARM_POLLINATED of (x, y)
+static bool next_to_pollen(const swarm *world, float x, float y)
+{
+	const swarm_grid *grid = &world->flower_grid;
+	int x0, x1, y0, y1;
+	grid_range(grid, x, y, SWARM_POLLINATED, &x0, &x1, &y0, &y1);
+	for (int cy = y0; cy <= y1; cy++) {
+		for (int cx = x0; cx <= x1; cx++) {
+			int cell = cy * grid->cells_x + cx;
+			for (int k = grid->start[cell]; k < grid->start[cell + 1]; k++) {
+				int flower = grid->items[k];
+				if (world->color[flower] == SWARM_BLUE
+					&& hypotf(world->flower_x[flower] - x, world->flower_y[flower] - y) < SWARM_POLLINATED) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+// Settle: grabs and drops in robot order; a flower two robots reach in the same step goes to the first
+static void settle(swarm *world)
+{
+	swarm_totals *totals = &world->totals;
+	for (int robot = 0; robot < world->count; robot++) {
+		int request = world->request[robot];
+		if (request == SWARM_DROP) {
+			int flower = world->held[robot];
+			front(world, robot, &world->flower_x[flower], &world->flower_y[flower]);
+			world->holder[flower] = -1;
+			world->held[robot] = -1;
+			if (!world->pollinated[flower] && next_to_pollen(world, world->flower_x[flower], world->flower_y[flower])) {
+				world->pollinated[flower] = 1;
+				totals->pollinations++;
+			}
+			world->mode[robot] = MODE_ESCAPE;
+			world->timer[robot] = SWARM_ESCAPE_TIME;
+			world->left[robot] = world->right[robot] = -0.6f * SWARM_SPEED;
+		} else if (request >= 0) {
+			if (world->holder[request] < 0) {
+				world->holder[request] = robot;
+				world->held[robot] = request;
+				totals->grabs++;
+			} else {
+				totals->lost++;
+			}
+		}
+	}
+	for (int robot = 0; robot < world->count; robot++) {
+		int flower = world->held[robot];
+		if (flower >= 0) {
+			front(world, robot, &world->flower_x[flower], &world->flower_y[flower]);
+		}
+	}
+}
+
+void swarm_step(swarm *world)
+{
+	run_phase(world, PHASE_SENSE);
+	run_phase(world, PHASE_MOVE);
+
+	float *swap;
+	swap = world->x, world->x = world->next_x, world->next_x = swap;
+	swap = world->y, world->y = world->next_y, world->next_y = swap;
+	swap = world->heading, world->heading = world->next_heading, world->next_heading = swap;
+	for (int t = 0; t < world->threads; t++) {
+		swarm_totals *share = &world->team[t].totals;
+		world->totals.bumps += share->bumps;
+		world->totals.contacts += share->contacts;
+		world->totals.distance += share->distance;
+		memset(share, 0, sizeof(*share));
+	}
+
+	settle(world);
+	grid_build(&world->robot_grid, world->x, world->y, world->count, NULL);
+	grid_build(&world->flower_grid, world->flower_x, world->flower_y, world->flower_count, world->holder);
+	world->time += SWARM_STEP;
+}
+
+//===================================//
+//===============SETUP===============//
+//===================================//
+
+// Place: robots on a jittered lattice, so none overlap however many there are; flowers anywhere
+static bool place(swarm *world, unsigned int seed)
+{
+	int columns = (int)ceilf(sqrtf(world->count * world->width / world->height));
+	int rows = (world->count + columns - 1) / columns;
+	float spacing_x = world->width / columns, spacing_y = world->height / rows;
+	float play_x = (spacing_x - 2 * SWARM_RADIUS) / 2 - 1, play_y = (spacing_y - 2 * SWARM_RADIUS) / 2 - 1;
+	if (play_x < 0 || play_y < 0) {
+		return false; // too many robots for the arena
+	}
+	for (int robot = 0; robot < world->count; robot++) {
+		world->x[robot] = (robot % columns + 0.5f) * spacing_x + (2 * random_unit(&seed) - 1) * play_x;
+		world->y[robot] = (robot / columns + 0.5f) * spacing_y + (2 * random_unit(&seed) - 1) * play_y;
+		world->heading[robot] = wrap_angle(random_unit(&seed) * 2 * (float)M_PI);
+		world->held[robot] = -1;
+		world->request[robot] = -1;
+		world->timer[robot] = rand_r(&seed) % 1000;
+		world->random[robot] = rand_r(&seed);
+	}
+	for (int flower = 0; flower < world->flower_count; flower++) {
+		world->flower_x[flower] = 20 + random_unit(&seed) * (world->width - 40);
+		world->flower_y[flower] = 20 + random_unit(&seed) * (world->height - 40);
+		world->color[flower] = flower % 3 == 2 ? SWARM_BLUE : SWARM_RED;
+		world->holder[flower] = -1;
+	}
+	return true;
+}
+
+bool swarm_init(swarm *world, int robots, int flowers, float width, float height, unsigned int seed, int threads)
+{
+	memset(world, 0, sizeof(*world));
+	world->width = width;
+	world->height = height;
+	world->count = robots;
+	world->flower_count = flowers;
+	world->threads = threads < 1 ? 1 : threads > SWARM_MAX_THREADS ? SWARM_MAX_THREADS : threads;
+	if (robots < 1 || flowers < 0 || width < 4 * SWARM_RADIUS || height < 4 * SWARM_RADIUS) {
+		return false;
+	}
+
+	size_t n = robots, f = flowers > 0 ? flowers : 1;
+	world->x = calloc(n, sizeof(float));
+	world->y = calloc(n, sizeof(float));
+	world->heading = calloc(n, sizeof(float));
+	world->next_x = calloc(n, sizeof(float));
+	world->next_y = calloc(n, sizeof(float));
+	world->next_heading = calloc(n, sizeof(float));
+	world->left = calloc(n, sizeof(float));
+	world->right = calloc(n, sizeof(float));
+	world->timer = calloc(n, sizeof(int));
+	world->mode = calloc(n, 1);
+	world->touching = calloc(n, 1);
+	world->held = calloc(n, sizeof(int));
+	world->request = calloc(n, sizeof(int));
+	world->random = calloc(n, sizeof(unsigned int));
+	world->flower_x = calloc(f, sizeof(float));
+	world->flower_y = calloc(f, sizeof(float));
+	world->color = calloc(f, 1);
+	world->pollinated = calloc(f, 1);
+	world->holder = calloc(f, sizeof(int));
+	if (!world->x || !world->y || !world->heading || !world->next_x || !world->next_y || !world->next_heading
+		|| !world->left || !world->right || !world->timer || !world->mode || !world->touching || !world->held
+		|| !world->request || !world->random || !world->flower_x || !world->flower_y || !world->color
+		|| !world->pollinated || !world->holder || !grid_init(&world->robot_grid, world, robots)
+		|| !grid_init(&world->flower_grid, world, flowers) || !place(world, seed)) {
+		swarm_free(world);
+		return false;
+	}
+	grid_build(&world->robot_grid, world->x, world->y, world->count, NULL);
+	grid_build(&world->flower_grid, world->flower_x, world->flower_y, world->flower_count, world->holder);
+
+	int started = 1;
+	for (int t = 0; t < world->threads; t++) {
+		world->team[t].world = world;
+		world->team[t].index = t;
+	}
+	if (world->threads > 1) {
+		pthread_mutex_init(&world->start_lock, NULL);
+		pthread_mutex_lock(&world->start_lock);
+		for (; started < world->threads; started++) {
+			if (pthread_create(&world->team[started].thread, NULL, team_worker, &world->team[started]) != 0) {
+				break;
+			}
+		}
+		// The barriers count on every member, so they are sized for the threads that did start
+		world->quit = started < world->threads;
+		pthread_barrier_init(&world->phase_start, NULL, started);
+		pthread_barrier_init(&world->phase_done, NULL, started);
+		pthread_mutex_unlock(&world->start_lock);
+		if (world->quit) {
+			// Release the workers that did start (they see "quit" at the first barrier), then tear the team down here
+			if (started > 1) {
+				pthread_barrier_wait(&world->phase_start);
+			}
+			for (int t = 1; t < started; t++) {
+				pthread_join(world->team[t].thread, NULL);
+			}
+			pthread_barrier_destroy(&world->phase_start);
+			pthread_barrier_destroy(&world->phase_done);
+			pthread_mutex_destroy(&world->start_lock);
+			world->threads = 1; // nothing left for swarm_free to stop
+			swarm_free(world);
+			return false;
+		}
+	}
+	return true;
+}
+
+void swarm_free(swarm *world)
+{
+	if (world->threads > 1 && world->team[0].world) {
+		world->quit = true;
+		pthread_barrier_wait(&world->phase_start);
+		for (int t = 1; t < world->threads; t++) {
+			pthread_join(world->team[t].thread, NULL);
+		}
+		pthread_barrier_destroy(&world->phase_start);
+		pthread_barrier_destroy(&world->phase_done);
+		pthread_mutex_destroy(&world->start_lock);
+	}
+	world->team[0].world = NULL;
+	free(world->x);
+	free(world->y);
+	free(world->heading);
+	free(world->next_x);
+	free(world->next_y);
+	free(world->next_heading);
+	free(world->left);
+	free(world->right);
+	free(world->timer);
+	free(world->mode);
+	free(world->touching);
+	free(world->held);
+	free(world->request);
+	free(world->random);
+	free(world->flower_x);
+	free(world->flower_y);
+	free(world->color);
+	free(world->pollinated);
+	free(world->holder);
+	grid_free(&world->robot_grid);
+	grid_free(&world->flower_grid);
+	memset(world, 0, sizeof(*world));
+}
@@ -0,0 +1,99 @@
+/*
+Many-robot arena simulator, for what the pollinator robots do to each other: keeping clear of each other by IR and
+racing for the same flower.
+
+The single-robot backend (headless/backend-sim.c) runs one real robot program per process, which cannot put hundreds
+of robots in one arena. Here every robot runs a built-in controller with the ethology robot's behaviors instead
+(escape a bump, avoid by IR, approach the flower the camera sees, grab it, carry it to pollen, search), on the same
+body: wheel speed, radius, IR cone and range, camera field of view and gripper reach.
+
+The robots are kept as a structure of arrays (one array of x, one of y, ...), so a phase that looks at one field of
+every robot runs through memory in order. Robots and flowers are sorted into a uniform grid every step (a counting
+sort, no allocation), and every query (robot against robot for collisions and IR, robot against flowers for the
+camera) only looks at the grid cells within range, so a step costs about the same per robot however many there are.
+
+A step has two parallel phases, each over a contiguous slice of robots per thread: sense and decide, then move and
+collide. Both read only the positions at the start of the step and write only their own robot, so the threads need no
+locks. Grabs and drops, where robots compete for the same flower, are settled after the phases in robot order, so a
+run is the same whatever the number of threads.
+*/
+
+#ifndef SWARM_SIM_H
+#define SWARM_SIM_H
+
+#include <pthread.h>  // thread team
+#include <stdbool.h>  // Boolean support
+
+#define SWARM_STEP 10               // ms of simulated time per step
+#define SWARM_MAX_THREADS 64
+#define SWARM_CELL 50.0f            // cm per side of a grid cell
+
+#define SWARM_RED 0
+#define SWARM_BLUE 1
+
+typedef struct swarm_grid {
+	int cells_x, cells_y;
+	int *start;                     // cells_x * cells_y + 1 offsets into "items"
+	int *items;                     // indices, grouped by cell
+	int *cell;                      // cell of each index, -1 if it is not in the grid
+} swarm_grid;
+
+typedef struct swarm_totals {
+	long bumps;                     // steps a robot spent pressed against a wall
+	long contacts;                  // steps a pair of robots spent touching
+	long grabs, lost, pollinations; // flowers taken, grabs lost to another robot, flowers pollinated
+	double distance;                // cm driven by all robots
+} swarm_totals;
+
+struct swarm;
+
+typedef struct swarm_thread {
+	struct swarm *world;
+	int index;                      // slice of the robots this thread steps
+	pthread_t thread;
+	swarm_totals totals;            // this step's share, folded into the world's after the step
+} swarm_thread;
+
+typedef struct swarm {
+	float width, height;            // cm
+	unsigned long time;             // ms simulated
+
+	// Robots, one entry per robot in each array
+	int count;
+	float *x, *y, *heading;         // pose at the start of the step
+	float *next_x, *next_y, *next_heading;
+	float *left, *right;            // wheel speeds (cm/s)
+	int *timer;                     // ms left of the current maneuver
+	unsigned char *mode;            // controller state
+	unsigned char *touching;        // pressed against a wall or another robot during the last step
+	int *held;                      // flower in the gripper, -1 if none
+	int *request;                   // flower to grab this step, -1 if none
+	unsigned int *random;           // per-robot random state, so the threads never share one
+
+	// Flowers (red) and pollen (blue)
+	int flower_count;
+	float *flower_x, *flower_y;
+	unsigned char *color;
+	unsigned char *pollinated;      // red flower that has had pollen next to it
+	int *holder;                    // robot holding it, -1 if none
+
+	swarm_grid robot_grid, flower_grid;
+	swarm_totals totals;
+
+	// Thread team: the calling thread and threads - 1 workers, which meet at the barriers once per phase
+	int threads;
+	int phase;
+	bool quit;
+	swarm_thread team[SWARM_MAX_THREADS];
+	pthread_barrier_t phase_start, phase_done;
+	pthread_mutex_t start_lock;     // keeps the workers off the barriers until they are set up
+} swarm;
+
+// Init: an arena of "width" x "height" cm with "robots" robots and "flowers" flowers and pollen (two red to one
+// blue), placed at random from "seed", stepped by "threads" threads. False if out of memory or no thread would start.
+bool swarm_init(swarm *world, int robots, int flowers, float width, float height, unsigned int seed, int threads);
+
+void swarm_step(swarm *world);      // SWARM_STEP ms more
+void swarm_free(swarm *world);      // stop the threads and free everything
+
+#endif
@@ -0,0 +1,117 @@
+/*
+Swarm simulation: many pollinator robots in one arena (swarm-sim.h).
+
+Runs "robots" robots for a stretch of simulated time and reports what they got done together (flowers pollinated,
+grabs lost to another robot that reached the same flower first, robot-to-robot contacts and wall bumps) and how fast
+the simulation ran against the real clock. The arena grows with the swarm, -a square meters per robot, and there are
+-f flowers and pollen per robot, so the density the robots meet stays the same.
+
+With -S the run is repeated for a growing swarm (10 to 3000 robots), one line each, to show that the cost per robot
+stays flat: the real-time factor should fall about in proportion to the number of robots.
+
+Build and run on any Linux box (from the top of the repository):
+    make swarm
+    build/swarm [-n robots] [-s seconds] [-j threads] [-a area] [-f flowers] [-r seed] [-S]
+*/
+
+#include "swarm-sim.h"
+#include "work-pool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ROBOTS 200
+#define DEFAULT_SECONDS 60
+#define DEFAULT_AREA 1.0     // square meters of arena per robot
+#define DEFAULT_FLOWERS 3.0  // flowers and pollen per robot (two red to one blue)
+
+typedef struct swarm_run {
+	double wall;             // seconds it took
+	swarm_totals totals;
+} swarm_run;
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Simulate: one swarm of "robots" for "seconds"; false if it could not be set up
+static bool simulate(int robots, double seconds, int threads, double area, double flowers, unsigned int seed,
+					 swarm_run *run)
+{
+	static swarm world;
+	float side = (float)sqrt(robots * area) * 100; // cm
+	if (!swarm_init(&world, robots, (int)lround(robots * flowers), side, side, seed, threads)) {
+		return false;
+	}
+	long steps = (long)(seconds * 1000 / SWARM_STEP);
+	double t0 = now_seconds();
+	for (long step = 0; step < steps; step++) {
+		swarm_step(&world);
+	}
+	run->wall = now_seconds() - t0;
+	run->totals = world.totals;
+	swarm_free(&world);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int robots = DEFAULT_ROBOTS, threads = work_pool_cores();
+	double seconds = DEFAULT_SECONDS, area = DEFAULT_AREA, flowers = DEFAULT_FLOWERS;
+	unsigned int seed = 1;
+	bool scale = false;
+	for (int arg = 1; arg < argc; arg++) {
+		const char *option = argv[arg];
+		bool has_value = arg + 1 < argc;
+		if (strcmp(option, "-n") == 0 && has_value) {
+			robots = atoi(argv[++arg]);
+		} else if (strcmp(option, "-s") == 0 && has_value) {
+			seconds = atof(argv[++arg]);
+		} else if (strcmp(option, "-j") == 0 && has_value) {
+			threads = atoi(argv[++arg]);
+		} else if (strcmp(option, "-a") == 0 && has_value) {
+			area = atof(argv[++arg]);
+		} else if (strcmp(option, "-f") == 0 && has_value) {
+			flowers = atof(argv[++arg]);
+		} else if (strcmp(option, "-r") == 0 && has_value) {
+			seed = (unsigned int)strtoul(argv[++arg], NULL, 10);
+		} else if (strcmp(option, "-S") == 0) {
+			scale = true;
+		} else {
+			fprintf(stderr, "usage: %s [-n robots] [-s seconds] [-j threads] [-a area] [-f flowers] [-r seed] [-S]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if (robots < 1 || seconds <= 0 || area <= 0 || flowers < 0) {
+		fprintf(stderr, "robots, seconds and area have to be positive\n");
+		return 2;
+	}
+	threads = threads < 1 ? 1 : threads > SWARM_MAX_THREADS ? SWARM_MAX_THREADS : threads;
+
+	static const int sizes[] = {10, 30, 100, 300, 1000, 3000};
+	int runs = scale ? (int)(sizeof(sizes) / sizeof(sizes[0])) : 1;
+	printf("%.0f simulated seconds, %.1f m2 and %.1f flowers per robot, %d threads\n", seconds, area, flowers,
+		   threads);
+	printf("robots  real-time factor  us/robot-step  pollinations/min  lost grabs  contact s/min  bump s/min\n");
+	for (int r = 0; r < runs; r++) {
+		int count = scale ? sizes[r] : robots;
+		swarm_run run;
+		if (!simulate(count, seconds, threads, area, flowers, seed, &run)) {
+			fprintf(stderr, "cannot set up %d robots\n", count);
+			return 1;
+		}
+		double minutes = seconds / 60, steps = seconds * 1000 / SWARM_STEP;
+		// Contacts and bumps are counted per step, so they come out as seconds spent touching per simulated minute
+		printf("%6d  %16.1f  %13.3f  %16.1f  %10ld  %13.1f  %10.1f\n", count, seconds / run.wall,
+			   run.wall * 1e6 / (steps * count), run.totals.pollinations / minutes, run.totals.lost,
+			   run.totals.contacts * (SWARM_STEP / 1000.0) / minutes, run.totals.bumps * (SWARM_STEP / 1000.0) / minutes);
+		fflush(stdout);
+	}
+	return 0;
+}
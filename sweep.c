@@ -0,0 +1,321 @@
+/*
+Monte Carlo parameter sweep over simulated missions.
+
+Runs the robot program (built with make sim) through many seeded missions in the arena simulator, each configuration
+of tunable parameters (tuning.h) against the same arena seeds, and ranks the configurations by pollinations per
+simulated minute with a 95% confidence interval. Collisions and missions that timed out or failed are reported for
+every configuration. The missions run as separate processes, spread over all cores by a work-stealing pool
+(work-pool.h), so a ten-minute mission costs a fraction of a second of one core.
+
+Parameters are given as name=values:
+    avoid_threshold=1600,6000      try each listed value
+    spin_limit=3:9                 draw a whole number from 3 to 9 for each configuration
+With only lists every combination is tried (the grid); as soon as one range is given, -c configurations are drawn at
+random instead, each parameter from its range or list, and a draw that repeats an earlier configuration is drawn again.
+
+Build and run on any Linux box (from the top of the repository, after make sim):
+    make sweep
+    build/sweep [-j workers] [-n seeds] [-c configs] [-s seconds] [-w timeout] [-k top] [-r seed] [-p program] \
+        avoid_threshold=1600,6000 spin_limit=3:9 spiral_step=1:3
+*/
+
+#include "mission.h"
+#include "work-pool.h"
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_PARAMS 16
+#define MAX_VALUES 64           // values in one list
+#define MAX_GRID 100000         // most configurations a grid may have
+#define DEFAULT_SEEDS 16
+#define DEFAULT_CONFIGS 64
+#define DEFAULT_TOP 10
+#define MAX_REJECTS 10000       // duplicate draws in a row before the random configurations are taken as all there are
+
+typedef struct sweep_param {
+	char name[64];
+	bool range;                 // lo:hi rather than a list
+	int low, high;
+	int values[MAX_VALUES];
+	int value_count;
+} sweep_param;
+
+typedef struct sweep_config {
+	int values[MAX_PARAMS];
+	char tuning[512];           // ROBOT_TUNING for this configuration
+	// results, under results_lock
+	int missions, timeouts, failures, bumps;
+	double sum, sum_squares;    // pollinations per simulated minute
+	double minutes;
+} sweep_config;
+
+typedef struct sweep {
+	sweep_param params[MAX_PARAMS];
+	int param_count;
+	sweep_config *configs;
+	int config_count;
+	int seeds;
+	double seconds, timeout;
+	const char *program;
+	pthread_mutex_t results_lock;
+	int done, total;
+} sweep;
+
+static double now_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Parse Param: "name=a,b,c" or "name=lo:hi"; false if it is neither
+static bool parse_param(const char *text, sweep_param *param)
+{
+	const char *equals = strchr(text, '=');
+	if (!equals || equals == text || equals - text >= (int)sizeof(param->name)) {
+		return false;
+	}
+	memset(param, 0, sizeof(*param));
+	memcpy(param->name, text, equals - text);
+	const char *values = equals + 1;
+	if (strchr(values, ':')) {
+		param->range = true;
+		return sscanf(values, "%d:%d", &param->low, &param->high) == 2 && param->low <= param->high;
+	}
+	while (*values && param->value_count < MAX_VALUES) {
+		char *end;
+		param->values[param->value_count++] = (int)strtol(values, &end, 10);
+		if (end == values || (*end != ',' && *end != '\0')) {
+			return false;
+		}
+		values = *end ? end + 1 : end;
+	}
+	return param->value_count > 0;
+}
+
+// Describe: the configuration's "name=value,..." string, which is also its ROBOT_TUNING
+static void describe(const sweep *run, sweep_config *config)
+{
+	size_t length = 0;
+	config->tuning[0] = '\0';
+	for (int p = 0; p < run->param_count; p++) {
+		length += snprintf(config->tuning + length, sizeof(config->tuning) - length, "%s%s=%d", p ? "," : "",
+						   run->params[p].name, config->values[p]);
+		if (length >= sizeof(config->tuning)) {
+			break;
+		}
+	}
+}
+
+// Seen: whether one of the first "count" configurations already has these values
+static bool seen(const sweep *run, int count, const int *values)
+{
+	for (int c = 0; c < count; c++) {
+		if (memcmp(run->configs[c].values, values, run->param_count * sizeof(int)) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Make Configs: the whole grid when every parameter is a list, otherwise "count" random draws; either way no
+// configuration appears twice (a list may repeat a value, and a draw may repeat an earlier one)
+static bool make_configs(sweep *run, int count, unsigned int seed)
+{
+	bool random = false;
+	long grid = 1, space = 1; // configurations in the grid of lists, and in all of the lists and ranges
+	for (int p = 0; p < run->param_count; p++) {
+		const sweep_param *param = &run->params[p];
+		random |= param->range;
+		grid *= param->range ? 1 : param->value_count;
+		grid = grid > MAX_GRID ? MAX_GRID + 1 : grid;
+		space *= param->range ? (long)param->high - param->low + 1 : param->value_count;
+		space = space > MAX_GRID ? MAX_GRID + 1 : space;
+	}
+	if (!random && grid > MAX_GRID) {
+		fprintf(stderr, "the grid has more than %d configurations, give a range to sample it instead\n", MAX_GRID);
+		return false;
+	}
+	int wanted = !random ? (int)grid : count < space ? count : (int)space;
+	run->configs = calloc(wanted, sizeof(sweep_config));
+	if (!run->configs) {
+		return false;
+	}
+	int made = 0;
+	for (int c = 0, rejects = 0; c < (random ? INT_MAX : wanted) && made < wanted && rejects < MAX_REJECTS; c++) {
+		sweep_config *config = &run->configs[made];
+		int index = c; // position in the grid, one list at a time
+		for (int p = 0; p < run->param_count; p++) {
+			const sweep_param *param = &run->params[p];
+			if (param->range) {
+				config->values[p] = param->low + rand_r(&seed) % (param->high - param->low + 1);
+			} else if (random) {
+				config->values[p] = param->values[rand_r(&seed) % param->value_count];
+			} else {
+				config->values[p] = param->values[index % param->value_count];
+				index /= param->value_count;
+			}
+		}
+		if (seen(run, made, config->values)) {
+			rejects += random; // the grid just moves on to its next point
+			continue;
+		}
+		rejects = 0;
+		describe(run, config);
+		made++;
+	}
+	if (random && made < count) {
+		fprintf(stderr, "only %d distinct configurations, sweeping those\n", made);
+	}
+	run->config_count = made;
+	return true;
+}
+
+// Mission: one job of the pool; job = config * seeds + seed, so every configuration sees the same arenas
+static void run_mission(int job, void *context)
+{
+	sweep *run = context;
+	sweep_config *config = &run->configs[job / run->seeds];
+	mission settings = {run->program, (unsigned int)(job % run->seeds) + 1, run->seconds, run->timeout,
+						config->tuning};
+	mission_result result;
+	mission_run(&settings, &result);
+
+	pthread_mutex_lock(&run->results_lock);
+	config->missions++;
+	if (result.status == MISSION_TIMED_OUT) {
+		config->timeouts++;
+	} else if (result.status == MISSION_FAILED) {
+		config->failures++;
+	} else {
+		double minutes = result.seconds / 60;
+		double rate = minutes > 0 ? result.pollinations / minutes : 0;
+		config->sum += rate;
+		config->sum_squares += rate * rate;
+		config->minutes += minutes;
+		config->bumps += result.bumps;
+	}
+	run->done++;
+	if (run->done % 100 == 0 || run->done == run->total) {
+		fprintf(stderr, "\r%d of %d missions", run->done, run->total);
+	}
+	pthread_mutex_unlock(&run->results_lock);
+}
+
+static int completed(const sweep_config *config)
+{
+	return config->missions - config->timeouts - config->failures;
+}
+
+static double mean(const sweep_config *config)
+{
+	int n = completed(config);
+	return n > 0 ? config->sum / n : 0;
+}
+
+// Margin: half width of the 95% confidence interval of the mean (Student's t for small samples)
+static double margin(const sweep_config *config)
+{
+	static const double t95[] = {0, 12.71, 4.30, 3.18, 2.78, 2.57, 2.45, 2.36, 2.31, 2.26, 2.23, 2.20, 2.18, 2.16,
+								 2.14, 2.13, 2.12, 2.11, 2.10, 2.09, 2.09, 2.08, 2.07, 2.07, 2.06, 2.06, 2.06, 2.05,
+								 2.05, 2.05, 2.04};
+	int n = completed(config);
+	if (n < 2) {
+		return INFINITY;
+	}
+	double m = config->sum / n;
+	double variance = (config->sum_squares - n * m * m) / (n - 1);
+	double t = n - 1 < (int)(sizeof(t95) / sizeof(t95[0])) ? t95[n - 1] : 1.96;
+	return t * sqrt(variance > 0 ? variance : 0) / sqrt(n);
+}
+
+// By Score: best mean first; ties go to the narrower interval
+static int by_score(const void *a, const void *b)
+{
+	const sweep_config *x = a, *y = b;
+	double mx = mean(x), my = mean(y);
+	if (mx != my) {
+		return mx > my ? -1 : 1;
+	}
+	double wx = margin(x), wy = margin(y);
+	return wx < wy ? -1 : wx > wy;
+}
+
+int main(int argc, char **argv)
+{
+	static sweep run;
+	run.seeds = DEFAULT_SEEDS;
+	run.seconds = MISSION_SECONDS;
+	run.timeout = MISSION_TIMEOUT;
+	run.program = MISSION_PROGRAM;
+	int workers = work_pool_cores(), configs = DEFAULT_CONFIGS, top = DEFAULT_TOP;
+	unsigned int seed = 1;
+	for (int arg = 1; arg < argc; arg++) {
+		const char *option = argv[arg];
+		bool has_value = arg + 1 < argc;
+		if (strcmp(option, "-j") == 0 && has_value) {
+			workers = atoi(argv[++arg]);
+		} else if (strcmp(option, "-n") == 0 && has_value) {
+			run.seeds = atoi(argv[++arg]);
+		} else if (strcmp(option, "-c") == 0 && has_value) {
+			configs = atoi(argv[++arg]);
+		} else if (strcmp(option, "-s") == 0 && has_value) {
+			run.seconds = atof(argv[++arg]);
+		} else if (strcmp(option, "-w") == 0 && has_value) {
+			run.timeout = atof(argv[++arg]);
+		} else if (strcmp(option, "-k") == 0 && has_value) {
+			top = atoi(argv[++arg]);
+		} else if (strcmp(option, "-r") == 0 && has_value) {
+			seed = (unsigned int)strtoul(argv[++arg], NULL, 10);
+		} else if (strcmp(option, "-p") == 0 && has_value) {
+			run.program = argv[++arg];
+		} else if (option[0] != '-' && run.param_count < MAX_PARAMS
+				   && parse_param(option, &run.params[run.param_count])) {
+			run.param_count++;
+		} else {
+			fprintf(stderr, "usage: %s [-j workers] [-n seeds] [-c configs] [-s seconds] [-w timeout] [-k top] "
+					"[-r seed] [-p program] name=a,b,c | name=lo:hi ...\n", argv[0]);
+			return 2;
+		}
+	}
+	if (run.seeds < 1 || configs < 1 || !make_configs(&run, configs, seed)) {
+		return 1;
+	}
+
+	pthread_mutex_init(&run.results_lock, NULL);
+	run.total = run.config_count * run.seeds;
+	printf("%d configurations x %d seeds of %.0f simulated seconds on %d workers (%s)\n", run.config_count,
+		   run.seeds, run.seconds, workers, run.program);
+	double t0 = now_seconds();
+	if (!work_pool_run(workers, run.total, run_mission, &run)) {
+		fprintf(stderr, "cannot start the workers\n");
+		return 1;
+	}
+	double seconds = now_seconds() - t0;
+	fprintf(stderr, "\n");
+
+	double simulated = 0;
+	int failed = 0;
+	for (int c = 0; c < run.config_count; c++) {
+		simulated += run.configs[c].minutes;
+		failed += run.configs[c].timeouts + run.configs[c].failures;
+	}
+	printf("%d missions in %.1f s (%.1f missions/s, %.0f simulated minutes per wall second), %d timed out or "
+		   "failed\n\n", run.total, seconds, run.total / seconds, simulated / seconds, failed);
+
+	qsort(run.configs, run.config_count, sizeof(sweep_config), by_score);
+	printf("rank  pollinations/min (95%% CI)  bumps/min  timeouts  failed  parameters\n");
+	for (int c = 0; c < run.config_count && c < top; c++) {
+		const sweep_config *config = &run.configs[c];
+		printf("%4d  %7.3f +- %-7.3f          %9.2f  %8d  %6d  %s\n", c + 1, mean(config), margin(config),
+			   config->minutes > 0 ? config->bumps / config->minutes : 0.0, config->timeouts, config->failures,
+			   config->tuning[0] ? config->tuning : "(defaults)");
+	}
+	free(run.configs);
+	return failed == run.total;
+}
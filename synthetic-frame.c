@@ -0,0 +1,90 @@
+/*
+Synthetic camera frames (see synthetic-frame.h).
+*/
+
+#include "synthetic-frame.h"
+
+// Next Random: small linear congruential generator so frames do not depend on the C library's rand()
+static unsigned int next_random(unsigned int *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+// Paint Disc: fill a circle with a color plus a little per-pixel noise
+static void paint_disc(unsigned char *bgr, int width, int height, int cx, int cy, int radius,
+					   const unsigned char color[3], unsigned int *state)
+{
+	for (int y = cy - radius; y <= cy + radius; y++) {
+		for (int x = cx - radius; x <= cx + radius; x++) {
+			if (x < 0 || y < 0 || x >= width || y >= height) {
+				continue;
+			}
+			if ((x - cx) * (x - cx) + (y - cy) * (y - cy) > radius * radius) {
+				continue;
+			}
+			unsigned char *px = bgr + 3 * (y * width + x);
+			for (int k = 0; k < 3; k++) {
+				int value = color[k] + (int)(next_random(state) % 21) - 10;
+				px[k] = value < 0 ? 0 : value > 255 ? 255 : value;
+			}
+		}
+	}
+}
+
+// Paint Floor: dull grey-green noise over the whole frame
+static void paint_floor(unsigned char *bgr, int width, int height, unsigned int *state)
+{
+	for (int i = 0; i < width * height; i++) {
+		int base = 70 + (int)(next_random(state) % 40);
+		bgr[3 * i] = base - 10;
+		bgr[3 * i + 1] = base + 10;
+		bgr[3 * i + 2] = base - 5;
+	}
+}
+
+static const unsigned char flower_red[3] = {40, 40, 200};   // BGR
+static const unsigned char pollen_blue[3] = {190, 60, 40};  // BGR
+
+void synth_frame(unsigned char *bgr, int width, int height, unsigned int seed)
+{
+	unsigned int state = seed * 2654435761u + 1;
+	paint_floor(bgr, width, height, &state);
+
+	int flowers = 1 + next_random(&state) % 4;
+	for (int f = 0; f < flowers; f++) {
+		int radius = height / 16 + next_random(&state) % (height / 8);
+		int cx = next_random(&state) % width;
+		int cy = next_random(&state) % height;
+		paint_disc(bgr, width, height, cx, cy, radius, flower_red, &state);
+		if (next_random(&state) % 2) {
+			// pollen sitting on the flower
+			paint_disc(bgr, width, height, cx + radius / 2, cy, radius / 3 + 1, pollen_blue, &state);
+		}
+	}
+	int drops = next_random(&state) % 3;
+	for (int d = 0; d < drops; d++) {
+		int radius = height / 12 + next_random(&state) % (height / 10);
+		paint_disc(bgr, width, height, next_random(&state) % width, next_random(&state) % height, radius, pollen_blue, &state);
+	}
+}
+
+void synth_empty_frame(unsigned char *bgr, int width, int height, unsigned int seed)
+{
+	unsigned int state = seed * 2654435761u + 1;
+	paint_floor(bgr, width, height, &state);
+}
+
+void synth_approach_frame(unsigned char *bgr, int width, int height, int step)
+{
+	unsigned int state = step + 1;
+	paint_floor(bgr, width, height, &state);
+
+	int radius = height / 20 + step / 8;
+	if (radius > height / 3) {
+		radius = height / 3;
+	}
+	int cx = width / 4 + (step * 3) % (width / 2); // drifts right a few pixels per frame, then jumps back
+	int cy = height / 2 + (step % 20) - 10;
+	paint_disc(bgr, width, height, cx, cy, radius, flower_red, &state);
+}
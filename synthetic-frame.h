@@ -0,0 +1,20 @@
+/*
+Synthetic camera frames for benchmarking the perception code off the robot.
+
+Frames are interleaved BGR like KIPR get_camera_frame(): a noisy grey-green floor with a few red and blue discs
+("flowers" and "pollen") scattered on it. The same seed always produces the same frame.
+*/
+
+#ifndef SYNTHETIC_FRAME_H
+#define SYNTHETIC_FRAME_H
+
+void synth_frame(unsigned char *bgr, int width, int height, unsigned int seed);
+
+// Empty Frame: just the floor, what the camera sees during most of a spin search
+void synth_empty_frame(unsigned char *bgr, int width, int height, unsigned int seed);
+
+// Approach Frame: one red flower that drifts across the view and grows as if the robot were driving at it;
+// "step" is the frame number within the approach
+void synth_approach_frame(unsigned char *bgr, int width, int height, int step);
+
+#endif
@@ -0,0 +1,52 @@
+/*
+Tunable parameters (see tuning.h).
+*/
+
+#include "tuning.h"
+#include <stdbool.h> // Boolean support
+#include <stdio.h>   // fopen, fgets
+#include <stdlib.h>  // getenv, exit
+#include <string.h>  // strcmp, strchr
+
+// Set: give the parameter called "name" its new value; false if the table has no such parameter
+static bool set(const tuning_param *params, int count, const char *name, int value)
+{
+	for (int i = 0; i < count; i++) {
+		if (strcmp(params[i].name, name) == 0) {
+			*params[i].value = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+int tuning_load(const tuning_param *params, int count)
+{
+	int loaded = 0;
+	char name[128];
+	int value;
+	FILE *file = fopen(TUNING_FILE, "r");
+	if (file) {
+		char line[256];
+		while (fgets(line, sizeof(line), file)) {
+			if (sscanf(line, " %127[^= \t] = %d", name, &value) == 2 && name[0] != '#') {
+				loaded += set(params, count, name, value);
+			}
+		}
+		fclose(file);
+	}
+	const char *overrides = getenv(TUNING_ENV);
+	while (overrides && *overrides) {
+		if (sscanf(overrides, " %127[^=,] = %d", name, &value) == 2) {
+			if (!set(params, count, name, value)) {
+				// asked for by name, so a misspelling must not pass for a run with the defaults
+				fprintf(stderr, "%s: unknown parameter \"%s\"\n", TUNING_ENV, name);
+				exit(2);
+			}
+			loaded++;
+		}
+		overrides = strchr(overrides, ',');
+		overrides = overrides ? overrides + 1 : NULL;
+	}
+	return loaded;
+}
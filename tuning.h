@@ -0,0 +1,28 @@
+/*
+Tunable parameters for the pollinator robots.
+
+Thresholds and timings such as the avoid threshold or how many spins come before the spiral leg used to be constants
+that differed from file to file, and trying another value meant editing and rebuilding. A program now lists its
+tunable globals in a tuning_param table and calls tuning_load once at startup: values from TUNING_FILE ("name = value"
+lines, like servo.cal) replace the compiled-in defaults, and the TUNING_ENV environment variable ("name=value,..."),
+which the sweep tool sets for every simulated mission, replaces those again. Unknown names in the file are ignored, so
+one file can serve several programs; an unknown name in TUNING_ENV ends the program with an error, so a sweep over a
+misspelled parameter fails its missions instead of ranking runs that all used the defaults.
+*/
+
+#ifndef TUNING_H
+#define TUNING_H
+
+#define TUNING_FILE "tuning.cfg"
+#define TUNING_ENV "ROBOT_TUNING"
+
+typedef struct tuning_param {
+	const char *name;
+	int *value;     // the global the parameter sets
+} tuning_param;
+
+// Load: set every parameter that TUNING_FILE or TUNING_ENV names; returns how many values were set. Exits (status 2)
+// if TUNING_ENV names a parameter that is not in "params".
+int tuning_load(const tuning_param *params, int count);
+
+#endif
@@ -0,0 +1,111 @@
+/*
+Visual servoing (see visual-servo.h).
+*/
+
+#include "visual-servo.h"
+
+void pid_init(pid_controller *pid, float kp, float ki, float kd, float out_min, float out_max)
+{
+	pid->kp = kp;
+	pid->ki = ki;
+	pid->kd = kd;
+	pid_reset(pid);
+	pid_set_limits(pid, out_min, out_max);
+}
+
+void pid_set_limits(pid_controller *pid, float out_min, float out_max)
+{
+	pid->out_min = out_min;
+	pid->out_max = out_max;
+	// The integral alone may drive the output to its limit and no further
+	float span = out_max > -out_min ? out_max : -out_min;
+	pid->integral_limit = pid->ki > 0 ? span / pid->ki : 0;
+	if (pid->integral > pid->integral_limit) {
+		pid->integral = pid->integral_limit;
+	} else if (pid->integral < -pid->integral_limit) {
+		pid->integral = -pid->integral_limit;
+	}
+}
+
+void pid_reset(pid_controller *pid)
+{
+	pid->integral = 0;
+	pid->previous_error = 0;
+	pid->time = 0;
+}
+
+float pid_update(pid_controller *pid, float error, unsigned long time)
+{
+	float seconds = pid->time != 0 && time > pid->time ? (time - pid->time) / 1000.0f : 0;
+	float derivative = seconds > 0 ? (error - pid->previous_error) / seconds : 0;
+	float integral = pid->integral + error * seconds;
+	if (integral > pid->integral_limit) {
+		integral = pid->integral_limit;
+	} else if (integral < -pid->integral_limit) {
+		integral = -pid->integral_limit;
+	}
+
+	float output = pid->kp * error + pid->ki * integral + pid->kd * derivative;
+	bool saturated = output > pid->out_max || output < pid->out_min;
+	if (output > pid->out_max) {
+		output = pid->out_max;
+	} else if (output < pid->out_min) {
+		output = pid->out_min;
+	}
+	// Anti-windup: while the output is saturated, only integrate errors that pull it back from the limit
+	if (!saturated || (error > 0) != (output > 0)) {
+		pid->integral = integral;
+	}
+	pid->previous_error = error;
+	pid->time = time;
+	return output;
+}
+
+void visual_servo_defaults(visual_servo_config *config, int grasp_area)
+{
+	config->steer_kp = SERVO_STEER_KP;
+	config->steer_ki = SERVO_STEER_KI;
+	config->steer_kd = SERVO_STEER_KD;
+	config->max_turn = SERVO_STEER_MAX;
+	config->approach_kp = SERVO_APPROACH_KP;
+	config->approach_min = SERVO_APPROACH_MIN;
+	config->approach_max = SERVO_APPROACH_MAX;
+	config->grasp_area = grasp_area;
+}
+
+void visual_servo_init(visual_servo *servo, const visual_servo_config *config)
+{
+	servo->grasp_area = config->grasp_area > 0 ? config->grasp_area : 1;
+	pid_init(&servo->steer, config->steer_kp, config->steer_ki, config->steer_kd, 0, 0);
+	visual_servo_set_max_turn(servo, config->max_turn);
+	pid_init(&servo->approach, config->approach_kp, 0, 0, config->approach_min, config->approach_max);
+}
+
+void visual_servo_set_max_turn(visual_servo *servo, int max_turn)
+{
+	servo->max_turn = max_turn > 0 ? max_turn : 0;
+	pid_set_limits(&servo->steer, -servo->max_turn, servo->max_turn);
+}
+
+void visual_servo_reset(visual_servo *servo)
+{
+	pid_reset(&servo->steer);
+	pid_reset(&servo->approach);
+}
+
+bool visual_servo_update(visual_servo *servo, int x, int area, int width, unsigned long time, int *left, int *right)
+{
+	float half = width > 1 ? width / 2.0f : 1;
+	float offset = (x - half) / half; // negative: target left of the middle
+	float size_error = 1.0f - (float)area / servo->grasp_area;
+	bool reached = size_error <= 0;
+
+	float turn = pid_update(&servo->steer, offset, time); // limited to max_turn by the controller's output range
+	float forward = reached ? 0 : pid_update(&servo->approach, size_error, time);
+	float heading = offset < 0 ? -offset : offset;
+	forward *= heading < 1 ? 1 - heading : 0; // turn towards a target far off to the side before driving at it
+
+	*left = (int)(forward + turn);
+	*right = (int)(forward - turn);
+	return reached;
+}
@@ -0,0 +1,69 @@
+/*
+Visual servoing for the pollinator robots' approach.
+
+Centering used to be bang-bang (a fixed +-0.07 turn until the target was within +-35 pixels of the middle), followed by
+a stop and an open-loop forward() until the target dropped out of view. This controller does both at once: every frame
+it steers in proportion to the target's horizontal offset from the middle of the image and drives forward in proportion
+to how much smaller the target still looks than it does when it is within reach of the gripper. Forward speed is also
+scaled down while the heading error is large, so a target far off to the side is turned towards before it is driven at.
+
+Both loops are PID controllers with gains from a visual_servo_config, which starts out with the defaults below. Their
+integrators are clamped and stop integrating while the output is saturated (anti-windup), so a long turn does not leave
+a large correction stored up that overshoots once the target is centered. The turn is limited to max_turn, which
+visual_servo_set_max_turn changes between updates together with the steering controller's output range, so the
+anti-windup keeps working at the new limit.
+*/
+
+#ifndef VISUAL_SERVO_H
+#define VISUAL_SERVO_H
+
+#include <stdbool.h> // Boolean support
+
+// Default gains: speeds in per mille of full speed (see servo-cal.h) per unit of normalized error
+#define SERVO_STEER_KP 300.0f     // turn for a target at the edge of the image
+#define SERVO_STEER_KI 60.0f      // per second of sustained offset
+#define SERVO_STEER_KD 20.0f      // per unit change of offset per second
+#define SERVO_STEER_MAX 250       // largest turn correction
+#define SERVO_APPROACH_KP 400.0f  // forward speed for a target that still looks tiny
+#define SERVO_APPROACH_MIN 80     // slowest forward speed, so the robot never stalls short of the target
+#define SERVO_APPROACH_MAX 400    // fastest forward speed
+
+typedef struct pid_controller {
+	float kp, ki, kd;
+	float integral;          // sum of error * seconds, clamped to +-integral_limit
+	float integral_limit;
+	float previous_error;
+	unsigned long time;      // ms of the previous update, 0 before the first
+	float out_min, out_max;  // output is clamped to this range
+} pid_controller;
+
+typedef struct visual_servo_config {
+	float steer_kp, steer_ki, steer_kd;
+	int max_turn;            // steering limit in per mille
+	float approach_kp;
+	int approach_min, approach_max; // forward speed range in per mille
+	int grasp_area;          // pixels the target covers when the gripper can close on it
+} visual_servo_config;
+
+typedef struct visual_servo {
+	pid_controller steer;    // error: horizontal offset, -1 (left edge) .. 1 (right edge)
+	pid_controller approach; // error: 1 - area / grasp_area, 1 for a tiny target and 0 once it is within reach
+	int grasp_area;          // pixels the target covers when the gripper can close on it
+	int max_turn;            // steering limit in per mille (the steer output range); change with visual_servo_set_max_turn
+} visual_servo;
+
+void pid_init(pid_controller *pid, float kp, float ki, float kd, float out_min, float out_max);
+void pid_reset(pid_controller *pid);
+void pid_set_limits(pid_controller *pid, float out_min, float out_max); // new output range, integral limit to match
+float pid_update(pid_controller *pid, float error, unsigned long time); // "time" in ms
+
+void visual_servo_defaults(visual_servo_config *config, int grasp_area); // default gains and the given grasp area
+void visual_servo_init(visual_servo *servo, const visual_servo_config *config);
+void visual_servo_set_max_turn(visual_servo *servo, int max_turn); // steering limit in per mille, from the next update
+void visual_servo_reset(visual_servo *servo); // forget integrators and history before a new approach
+
+// Update: wheel speeds (per mille) for a target at "x" with "area" pixels in an image "width" pixels wide at "time" ms;
+// true once the target is within reach
+bool visual_servo_update(visual_servo *servo, int x, int area, int width, unsigned long time, int *left, int *right);
+
+#endif
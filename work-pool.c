@@ -0,0 +1,116 @@
+/*
+Work-stealing pool (see work-pool.h).
+*/
+
+#include "work-pool.h"
+#include <pthread.h>   // workers
+#include <stdlib.h>    // malloc, free
+#include <unistd.h>    // sysconf
+
+typedef struct work_deque {
+	pthread_mutex_t lock;
+	int *jobs;
+	int front, back;        // jobs[front .. back - 1] are still to do
+} work_deque;
+
+typedef struct work_pool {
+	work_deque deques[WORK_POOL_MAX];
+	int workers;
+	work_function work;
+	void *context;
+} work_pool;
+
+typedef struct work_worker {
+	work_pool *pool;
+	int index;
+} work_worker;
+
+int work_pool_cores()
+{
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	return cores < 1 ? 1 : cores > WORK_POOL_MAX ? WORK_POOL_MAX : (int)cores;
+}
+
+// Take: the next job from the back of our own deque (true) or the front of someone else's (false); -1 if none
+static int take(work_deque *deque, bool own)
+{
+	pthread_mutex_lock(&deque->lock);
+	int job = -1;
+	if (deque->front < deque->back) {
+		job = own ? deque->jobs[--deque->back] : deque->jobs[deque->front++];
+	}
+	pthread_mutex_unlock(&deque->lock);
+	return job;
+}
+
+// Next Job: our own work first, then steal, starting with the worker after us so thieves spread out
+static int next_job(work_pool *pool, int index)
+{
+	int job = take(&pool->deques[index], true);
+	for (int i = 1; job < 0 && i < pool->workers; i++) {
+		job = take(&pool->deques[(index + i) % pool->workers], false);
+	}
+	return job;
+}
+
+static void *work_loop(void *argument)
+{
+	work_worker *worker = argument;
+	int job;
+	while ((job = next_job(worker->pool, worker->index)) >= 0) {
+		worker->pool->work(job, worker->pool->context);
+	}
+	return NULL;
+}
+
+bool work_pool_run(int workers, int count, work_function work, void *context)
+{
+	workers = workers < 1 ? 1 : workers > WORK_POOL_MAX ? WORK_POOL_MAX : workers;
+	work_pool *pool = malloc(sizeof(work_pool));
+	int *jobs = malloc((count > 0 ? count : 1) * sizeof(int));
+	work_worker *crew = malloc(workers * sizeof(work_worker));
+	pthread_t *threads = malloc(workers * sizeof(pthread_t));
+	if (!pool || !jobs || !crew || !threads) {
+		free(pool);
+		free(jobs);
+		free(crew);
+		free(threads);
+		return false;
+	}
+	pool->workers = workers;
+	pool->work = work;
+	pool->context = context;
+
+	// Deal the jobs round-robin, each deque getting a contiguous stretch of "jobs" to hold them
+	int start = 0;
+	for (int w = 0; w < workers; w++) {
+		work_deque *deque = &pool->deques[w];
+		pthread_mutex_init(&deque->lock, NULL);
+		deque->jobs = jobs + start;
+		deque->front = 0;
+		deque->back = 0;
+		for (int job = w; job < count; job += workers) {
+			deque->jobs[deque->back++] = job;
+		}
+		start += deque->back;
+	}
+
+	int started = 0;
+	for (; started < workers; started++) {
+		crew[started] = (work_worker){pool, started};
+		if (pthread_create(&threads[started], NULL, work_loop, &crew[started]) != 0) {
+			break;
+		}
+	}
+	for (int w = 0; w < started; w++) { // workers that did start steal the jobs of any that did not
+		pthread_join(threads[w], NULL);
+	}
+	for (int w = 0; w < workers; w++) {
+		pthread_mutex_destroy(&pool->deques[w].lock);
+	}
+	free(pool);
+	free(jobs);
+	free(crew);
+	free(threads);
+	return started > 0;
+}
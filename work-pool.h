@@ -0,0 +1,25 @@
+/*
+Work-stealing pool for the off-robot tools that run many independent jobs (sweep, the hierarchy optimizer).
+
+The jobs, numbered 0 .. count - 1, are dealt out round-robin onto one deque per worker thread. A worker takes jobs
+from the back of its own deque and, when that is empty, steals from the front of another worker's, so a worker that
+drew a run of short jobs helps out the ones that drew long ones instead of sitting idle at the end. The deques have a
+lock each; the jobs these tools run are whole simulated missions, far longer than any lock.
+*/
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdbool.h> // Boolean support
+
+#define WORK_POOL_MAX 256   // most worker threads
+
+typedef void (*work_function)(int job, void *context);
+
+int work_pool_cores();      // cores online, the default number of workers
+
+// Run: call "work(job, context)" for every job from "workers" threads; returns once all jobs are done.
+// Returns false if no thread could be started (then nothing has run).
+bool work_pool_run(int workers, int count, work_function work, void *context);
+
+#endif